@@ -7,16 +7,17 @@
  * than uninformed alternatives. Dependent variable: wall-clock execution time.
  *
  * ARCHITECTURE:
- *   Phase 1: External profiling pass (count call targets via IR traversal + interpreter)
+ *   Phase 1: External profiling pass (instrumented interpreter run, static fallback)
  *   Phase 2: Price-guided MIR_CALL -> MIR_INLINE mutation (between load and link)
  *   Phase 3: JIT compilation + timed execution
  *
- * 5 EXPERIMENTAL CONDITIONS:
+ * 6 EXPERIMENTAL CONDITIONS:
  *   1. No inlining       - All calls remain MIR_CALL (lower bound)
  *   2. Blind inline-all  - All MIR_CALL -> MIR_INLINE (upper bound)
  *   3. Random 50%        - Randomly convert half ("any inlining helps" control)
  *   4. Shadow-price      - NUM-predicted threshold formula (hypothesis)
  *   5. Inverted-price    - Hot->LOW threshold, cold->HIGH (killer control)
+ *   6. Knapsack          - Global growth budget, dual-priced (--budget N)
  *
  * BUILD (Linux/WSL2):
  *   gcc -O2 -DNDEBUG -I. num_experiment.c mir.c mir-gen.c -o num_experiment -lm -ldl -lpthread
@@ -25,17 +26,49 @@
  *   - MIR_gen_init(ctx)                    [1-arg version, newer API]
  *   - MIR_gen_set_optimize_level(ctx, 2)   [2-arg version, newer API]
  *   - MIR_link(ctx, MIR_set_gen_interface, NULL)
+ *   - MIR_link(ctx, MIR_set_lazy_gen_interface, NULL) + MIR_gen(ctx, item)
+ *     [per-function compile, used for compile-cost accounting]
+ *   - MIR_init2(NULL, &code_alloc)         [custom code allocator, --huge-code]
  *   - driver_item->addr for function pointer extraction
  *   - DLIST_HEAD/DLIST_NEXT/DLIST_TAIL for item traversal
  *   - item->item_type == MIR_func_item, item->u.func->name
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  /* pthread_setaffinity_np, CPU_SET */
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <stdint.h>
 #include <math.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define HAVE_RDTSCP 1
+#endif
 #include "mir.h"
 #include "mir-gen.h"
 
@@ -46,11 +79,22 @@
 /* MIR native thresholds (from mir.c lines 3851-3864) */
 #define MIR_CALL_INLINE_THRESHOLD   50   /* MIR_MAX_INSNS_FOR_CALL_INLINE */
 #define MIR_INLINE_THRESHOLD       200   /* MIR_MAX_INSNS_FOR_INLINE */
+#define MIR_CALLER_GROWTH_PCT      150   /* MIR_MAX_FUNC_INLINE_GROWTH */
+#define MIR_CALLER_GROWTH_FLOOR    200   /* MIR_MAX_CALLER_SIZE_FOR_ANY_GROWTH_INLINE */
 
 /* Experiment parameters */
 #define NUM_RUNS         20       /* Runs per condition for statistical robustness */
 #define WARMUP_ITERS     1000     /* Warmup iterations before timing */
 #define BENCH_N          100000000LL  /* Main benchmark iteration count */
+#define PROFILE_N        10000LL  /* Training input for the interpreted telemetry run */
+#define PROFILE_THREADS  1        /* Default telemetry workers (--profile-threads) */
+#define CACHE_LINE       64       /* Counter shard padding, bytes */
+
+/* Static frequency estimator (profile_module) */
+#define STATIC_LOOP_WEIGHT  10.0   /* Per loop nesting level */
+#define STATIC_BRANCH_PROB  0.5    /* Fall-through of an unrecognised guard */
+#define STATIC_FREQ_SCALE   1000.0 /* Fixed-point scale for call_count */
+#define STATIC_FREQ_MAX     1e12   /* Clamp on weights and frequencies (x SCALE fits u64) */
 
 /* Shadow price formula bounds (from dossier Section 4.3) */
 #define SCALE_FLOOR      0.1
@@ -58,53 +102,313 @@
 #define THRESHOLD_FLOOR  5
 /* THRESHOLD_CEIL = MIR_INLINE_THRESHOLD (200) */
 
+/* Parameter sweep (--sweep); the four constants above become its axes */
+#define SWEEP_RUNS        5       /* Timed runs per grid point */
+#define SWEEP_MAX_POINTS  4096    /* Grid size limit */
+#define SWEEP_THREADS     0       /* Workers (--sweep-threads); 0 = online cores - 1 */
+
+/* Knapsack condition (COND_KNAPSACK) */
+#define KNAPSACK_BUDGET   400     /* Default module-wide growth budget, insns (--budget) */
+#define CALL_SAVINGS_INSNS  8     /* Est. insns saved per executed call: call/ret, arg moves, frame */
+#define BRANCH_FOLD_SAVINGS 2     /* Est. insns saved per executed call per folded branch: cmp + jcc */
+#define KNAPSACK_BISECT_ITERS 50  /* Bisection steps on the budget price mu */
+
+/* Register-pressure model (--pressure-cost) */
+#define PRESSURE_COST     0       /* Insns per live register over PRESSURE_REGS; 0 = off */
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define PRESSURE_REGS     24      /* Allocatable GPRs, approx.: x0-x28 less MIR's temporaries */
+#else
+#define PRESSURE_REGS     12      /* Allocatable GPRs, approx.: x86-64 less rsp, rbp, temporaries */
+#endif
+
+/* Code layout (--layout, --huge-code) */
+#define LAYOUT_HOT_PRICE  0.05    /* Shadow price at or above which code is laid out hot */
+#define LAYOUT_PAGE       4096    /* Page size of the hot-footprint report */
+#define HUGE_CODE_PAGE    ((size_t)2 << 20)  /* Huge-page block behind each code region */
+
+/* Iterative dual ascent (--iterative) */
+#define ITER_MAX_ROUNDS   8       /* Default round limit (--rounds) */
+#define ITER_RUNS         5       /* Timed runs per round */
+#define ITER_STEP         0.5     /* Subgradient / benefit step size */
+#define ITER_NOISE        0.01    /* Relative time change treated as noise */
+#define ITER_MU_TOL       1e-3    /* Convergence tolerance on mu */
+
+/* Adaptive harness (--adaptive) */
+#define MAX_RUNS          200     /* Capacity of condition_result_t.times[] (--max-runs) */
+#define ADAPT_MIN_RUNS    10      /* Runs before the stopping rule is checked */
+#define ADAPT_CI_TARGET   0.005   /* Stop at 95% CI width / median below this (--ci) */
+#define WARMUP_WINDOW     3       /* Warmup calls that must agree ... */
+#define WARMUP_TOL        0.05    /* ... to within this relative spread */
+#define WARMUP_MAX        50      /* Give up on stability after this many calls */
+#define OUTLIER_K         3.0     /* Trim runs beyond K scaled MADs from the median */
+#define BOOTSTRAP_RESAMPLES 2000  /* Resamples for the median CI */
+
+/* Compile-cost accounting */
+#define MAX_CODE_FUNCS    16      /* Functions with per-function code size recorded */
+#define CODE_GAP_MAX      (1 << 20)  /* Larger address gaps = different code region */
+
+/* Hardware counters (--perf, Linux perf_event) */
+#define PERF_COUNT        5       /* cycles, instructions, branch-misses, L1i, iTLB */
+
+/* Tiered JIT (--tiered) */
+#define TIER_TRIGGER_N    100000LL  /* Driver iterations run in tier 0 */
+#define TIER_UP_PRICE     0.05    /* Tier-0 shadow price that marks a function hot */
+#define TIER_CHUNK_N      TIER_TRIGGER_N  /* Iterations per served request (latency sample) */
+#define TIER_CHUNKS       200     /* Requests served per background tier-up run */
+#define TIER_MAX_FUNCS    4096    /* Tier-0 probe counters / dispatch slots per module, at most */
+#define COMPILE_THREADS   0       /* Background compile workers (--compile-threads) */
+#define COMPILE_MAX_THREADS 16    /* Upper bound for --compile-threads */
+
+/* Incremental re-optimization (--reopt) */
+#define REOPT_BAND        0.05    /* Price moves up to this keep the old price (--reopt-band) */
+
+/* Live metrics (--metrics) */
+#define METRICS_FUNCS     256     /* Per-function slots; power of two */
+#define METRICS_LAMBDA_BUCKETS 10 /* Equal-width price histogram buckets over [0, 1] */
+
+/* Deoptimization guard (--guard) */
+#define GUARD_RUNS        5       /* Timed runs per side of each A/B */
+#define GUARD_NOISE       0.02    /* Revert only if the reverted median is this much faster */
+#define GUARD_MAX_SITES   64      /* Promotions A/B tested; the rest are kept untested */
+
+/* Synthetic workload (--synthetic) */
+#define SYNTH_SHAPE       SHAPE_TREE  /* Call-graph shape (--shape) */
+#define SYNTH_FANOUT      4       /* Children per function, tree and dag (--fanout) */
+#define SYNTH_ZIPF        1.0     /* s_c runs (c+1)^-zipf times per iteration (--zipf) */
+#define SYNTH_MIN_INSNS   20      /* Callee sizes are uniform in [MIN, MAX] */
+#define SYNTH_MAX_INSNS   180
+#define SYNTH_BLOCKS      3       /* Flag-guarded diamonds per callee */
+#define SYNTH_BENCH_N     1000000LL  /* Timed driver(n) for synthetic modules (--iters) */
+#define PRINT_MAX_ROWS    32      /* Per-function listings are cut off after this */
+
 /* Random seed for reproducibility */
 #define RANDOM_SEED      42
 
 /* ========================================================================
  * SECTION 2: PROFILING DATA STRUCTURES (Phase 1 - The Master)
  *
- * Simple hash map: function name -> call count.
+ * Hash map: function name -> call count.
  * We use name-based lookup because MIR_item_t pointers differ across
  * context re-initializations (each condition gets a fresh context).
+ *
+ * Layout: entries[] is a dense, growable array in insertion order (callers
+ * iterate it directly); slots[] is an open-addressing index over it, keyed
+ * on a 64-bit FNV-1a hash of the name with linear probing. The slot table
+ * is kept at twice the entry capacity, so the load factor never exceeds
+ * 0.5 and lookups stay O(1) on modules with tens of thousands of callees.
  * ======================================================================== */
 
-#define PROFILE_MAP_SIZE 256
+#define PROFILE_MAP_INIT_CAP 64  /* Initial entry capacity (power of two) */
 
 typedef struct {
     const char *func_name;
+    uint64_t    name_hash;     /* FNV-1a of func_name */
     uint64_t    call_count;
     double      shadow_price;  /* Normalized after profiling */
 } profile_entry_t;
 
+/*
+ * Call-site prices. A site is (caller, index, callee), where index is the
+ * ordinal of the call among the caller's MIR_CALL/MIR_INLINE insns
+ * (stable across the CALL -> INLINE rewrite and across probe insertion).
+ * Site lambda = site count / hottest site count. Sites are optional; a
+ * map without them (static maps from older callers, --load-profile,
+ * synthetic price maps) prices every site at its callee's lambda.
+ */
+typedef struct {
+    const char *caller;        /* Owned */
+    const char *callee;        /* Owned */
+    int         index;
+    uint64_t    key_hash;
+    uint64_t    call_count;
+    double      shadow_price;
+} site_entry_t;
+
+struct profile_db;
+
 typedef struct {
-    profile_entry_t entries[PROFILE_MAP_SIZE];
-    int             count;
-    double          max_count;  /* For normalization */
+    profile_entry_t *entries;    /* Dense, insertion order */
+    int              count;
+    int              capacity;
+    int32_t         *slots;      /* Index into entries[], -1 = empty */
+    uint32_t         slot_mask;  /* Number of slots - 1 */
+    double           max_count;  /* For normalization */
+    const struct profile_db *db; /* Optional mmapped fallback, see below */
+    site_entry_t    *sites;      /* Dense, insertion order */
+    int              nsites;
+    int              site_capacity;
+    int32_t         *site_slots; /* Index into sites[], -1 = empty */
+    uint32_t         site_slot_mask;
+    double           site_max_count;
 } profile_map_t;
 
+static uint64_t profile_hash_name(const char *name) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h ^= *p;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
 static void profile_map_init(profile_map_t *map) {
     memset(map, 0, sizeof(*map));
 }
 
-static profile_entry_t *profile_map_get(profile_map_t *map, const char *name) {
-    for (int i = 0; i < map->count; i++) {
-        if (strcmp(map->entries[i].func_name, name) == 0)
-            return &map->entries[i];
+static void profile_map_free(profile_map_t *map) {
+    for (int i = 0; i < map->count; i++)
+        free((char *)map->entries[i].func_name);
+    for (int i = 0; i < map->nsites; i++) {
+        free((char *)map->sites[i].caller);
+        free((char *)map->sites[i].callee);
     }
-    return NULL;
+    free(map->entries);
+    free(map->slots);
+    free(map->sites);
+    free(map->site_slots);
+    memset(map, 0, sizeof(*map));
+}
+
+static profile_entry_t *profile_map_get(const profile_map_t *map, const char *name) {
+    if (map->slots == NULL) return NULL;
+    uint64_t h = profile_hash_name(name);
+    for (uint32_t i = (uint32_t)h & map->slot_mask;; i = (i + 1) & map->slot_mask) {
+        int32_t idx = map->slots[i];
+        if (idx < 0) return NULL;
+        profile_entry_t *e = &map->entries[idx];
+        if (e->name_hash == h && strcmp(e->func_name, name) == 0)
+            return e;
+    }
+}
+
+/*
+ * profile_map_grow: Double entry capacity and rebuild the slot index.
+ * Returns 0 on success, -1 on allocation failure (map left unchanged).
+ */
+static int profile_map_grow(profile_map_t *map) {
+    int new_cap = map->capacity ? map->capacity * 2 : PROFILE_MAP_INIT_CAP;
+    uint32_t nslots = (uint32_t)new_cap * 2;
+
+    profile_entry_t *entries = realloc(map->entries,
+                                       (size_t)new_cap * sizeof(*entries));
+    if (entries == NULL) return -1;
+    map->entries = entries;
+
+    int32_t *slots = malloc((size_t)nslots * sizeof(*slots));
+    if (slots == NULL) return -1;
+    memset(slots, 0xff, (size_t)nslots * sizeof(*slots));  /* all -1 */
+    for (int k = 0; k < map->count; k++) {
+        uint32_t i = (uint32_t)entries[k].name_hash & (nslots - 1);
+        while (slots[i] >= 0) i = (i + 1) & (nslots - 1);
+        slots[i] = k;
+    }
+
+    free(map->slots);
+    map->slots = slots;
+    map->slot_mask = nslots - 1;
+    map->capacity = new_cap;
+    return 0;
 }
 
-static void profile_map_increment(profile_map_t *map, const char *name) {
+/*
+ * profile_map_add: Credit `calls` executions to `name`.
+ *
+ * The map keeps its own copy of the name: telemetry names live in a
+ * throwaway MIR context that is finished before the conditions run.
+ */
+static void profile_map_add(profile_map_t *map, const char *name, uint64_t calls) {
     profile_entry_t *e = profile_map_get(map, name);
     if (e) {
-        e->call_count++;
-    } else if (map->count < PROFILE_MAP_SIZE) {
-        map->entries[map->count].func_name = name;
-        map->entries[map->count].call_count = 1;
-        map->entries[map->count].shadow_price = 0.0;
-        map->count++;
+        e->call_count += calls;
+        return;
+    }
+    if (map->count == map->capacity && profile_map_grow(map) != 0) {
+        fprintf(stderr, "  WARNING: profile map out of memory, dropping '%s'\n", name);
+        return;
+    }
+
+    uint64_t h = profile_hash_name(name);
+    uint32_t i = (uint32_t)h & map->slot_mask;
+    while (map->slots[i] >= 0) i = (i + 1) & map->slot_mask;
+    map->slots[i] = map->count;
+
+    e = &map->entries[map->count++];
+    e->func_name = strdup(name);
+    e->name_hash = h;
+    e->call_count = calls;
+    e->shadow_price = 0.0;
+}
+
+static uint64_t profile_site_hash(const char *caller, int index) {
+    uint64_t h = profile_hash_name(caller);
+    h ^= (uint64_t)(uint32_t)index;
+    h *= 0x100000001b3ULL;
+    return h;
+}
+
+static site_entry_t *profile_map_get_site(const profile_map_t *map, const char *caller,
+                                          int index, const char *callee) {
+    if (map->site_slots == NULL) return NULL;
+    uint64_t h = profile_site_hash(caller, index);
+    for (uint32_t i = (uint32_t)h & map->site_slot_mask;; i = (i + 1) & map->site_slot_mask) {
+        int32_t idx = map->site_slots[i];
+        if (idx < 0) return NULL;
+        site_entry_t *e = &map->sites[idx];
+        if (e->key_hash == h && e->index == index && strcmp(e->caller, caller) == 0 &&
+            strcmp(e->callee, callee) == 0)
+            return e;
+    }
+}
+
+static int profile_map_grow_sites(profile_map_t *map) {
+    int new_cap = map->site_capacity ? map->site_capacity * 2 : PROFILE_MAP_INIT_CAP;
+    uint32_t nslots = (uint32_t)new_cap * 2;
+
+    site_entry_t *sites = realloc(map->sites, (size_t)new_cap * sizeof(*sites));
+    if (sites == NULL) return -1;
+    map->sites = sites;
+
+    int32_t *slots = malloc((size_t)nslots * sizeof(*slots));
+    if (slots == NULL) return -1;
+    memset(slots, 0xff, (size_t)nslots * sizeof(*slots));  /* all -1 */
+    for (int k = 0; k < map->nsites; k++) {
+        uint32_t i = (uint32_t)sites[k].key_hash & (nslots - 1);
+        while (slots[i] >= 0) i = (i + 1) & (nslots - 1);
+        slots[i] = k;
+    }
+
+    free(map->site_slots);
+    map->site_slots = slots;
+    map->site_slot_mask = nslots - 1;
+    map->site_capacity = new_cap;
+    return 0;
+}
+
+static void profile_map_add_site(profile_map_t *map, const char *caller, int index,
+                                 const char *callee, uint64_t calls) {
+    site_entry_t *e = profile_map_get_site(map, caller, index, callee);
+    if (e) {
+        e->call_count += calls;
+        return;
+    }
+    if (map->nsites == map->site_capacity && profile_map_grow_sites(map) != 0) {
+        fprintf(stderr, "  WARNING: profile map out of memory, dropping site %s#%d\n",
+                caller, index);
+        return;
     }
+
+    uint64_t h = profile_site_hash(caller, index);
+    uint32_t i = (uint32_t)h & map->site_slot_mask;
+    while (map->site_slots[i] >= 0) i = (i + 1) & map->site_slot_mask;
+    map->site_slots[i] = map->nsites;
+
+    e = &map->sites[map->nsites++];
+    e->caller = strdup(caller);
+    e->callee = strdup(callee);
+    e->index = index;
+    e->key_hash = h;
+    e->call_count = calls;
+    e->shadow_price = 0.0;
 }
 
 static void profile_map_normalize(profile_map_t *map) {
@@ -121,549 +425,2744 @@ static void profile_map_normalize(profile_map_t *map) {
                 (double)map->entries[i].call_count / map->max_count;
         }
     }
+
+    /* Sites are normalized among themselves */
+    map->site_max_count = 0;
+    for (int i = 0; i < map->nsites; i++)
+        if (map->sites[i].call_count > map->site_max_count)
+            map->site_max_count = (double)map->sites[i].call_count;
+    if (map->site_max_count > 0)
+        for (int i = 0; i < map->nsites; i++)
+            map->sites[i].shadow_price =
+                (double)map->sites[i].call_count / map->site_max_count;
+}
+
+/*
+ * profile_map_copy: Add `src`'s functions and call sites, counts and
+ * prices, to the empty map `dst`. Returns 0 on success, -1 if an entry
+ * was dropped for lack of memory.
+ */
+static int profile_map_copy(profile_map_t *dst, const profile_map_t *src) {
+    for (int i = 0; i < src->count; i++) {
+        const profile_entry_t *e = &src->entries[i];
+        profile_map_add(dst, e->func_name, e->call_count);
+        if (dst->count != i + 1) return -1;
+        dst->entries[i].shadow_price = e->shadow_price;
+    }
+    for (int i = 0; i < src->nsites; i++) {
+        const site_entry_t *e = &src->sites[i];
+        profile_map_add_site(dst, e->caller, e->index, e->callee, e->call_count);
+        if (dst->nsites != i + 1) return -1;
+        dst->sites[i].shadow_price = e->shadow_price;
+    }
+    dst->max_count = src->max_count;
+    dst->site_max_count = src->site_max_count;
+    return 0;
 }
 
 static void profile_map_print(const profile_map_t *map) {
     printf("  Shadow Prices (%d functions profiled):\n", map->count);
-    for (int i = 0; i < map->count; i++) {
+    for (int i = 0; i < map->count && i < PRINT_MAX_ROWS; i++) {
         printf("    %-20s  calls=%-10lu  lambda=%.4f\n",
                map->entries[i].func_name,
                (unsigned long)map->entries[i].call_count,
                map->entries[i].shadow_price);
     }
-}
-
-/* ========================================================================
- * SECTION 3: PROFILING PASS (Phase 1)
- *
- * External profiling: traverse the IR to identify call targets and their
- * static call-site counts. For the first experiment, we use static analysis
- * augmented by loop structure to estimate execution frequency.
- *
- * For a production implementation, this would be replaced by interpreter
- * instrumentation (patching call_insn_execute() in mir-interp.c).
- *
- * The key insight: in our benchmarks, the driver loop calls work() N times.
- * Static call-site count * estimated loop trip count = approximate profile.
- * ======================================================================== */
-
-/*
- * count_func_insns: Count instructions in a MIR function.
- * Anchored to: DLIST traversal pattern from PoC v2 (confirmed working).
- *
- * NOTE: We access func->insns via DLIST. The MIR_insn_t is iterable
- * through the same DLIST_HEAD/DLIST_NEXT pattern used for items.
- */
-static int count_func_insns(MIR_func_t func) {
-    int count = 0;
-    for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, func->insns);
-         insn != NULL;
-         insn = DLIST_NEXT(MIR_insn_t, insn)) {
-        count++;
+    if (map->count > PRINT_MAX_ROWS)
+        printf("    ... %d more\n", map->count - PRINT_MAX_ROWS);
+    if (map->nsites == 0) return;
+    printf("  Call-site prices (%d sites):\n", map->nsites);
+    for (int i = 0; i < map->nsites && i < PRINT_MAX_ROWS; i++) {
+        char site[64];
+        snprintf(site, sizeof(site), "%s#%d -> %s", map->sites[i].caller,
+                 map->sites[i].index, map->sites[i].callee);
+        printf("    %-32s  calls=%-10lu  lambda=%.4f\n", site,
+               (unsigned long)map->sites[i].call_count, map->sites[i].shadow_price);
     }
-    return count;
+    if (map->nsites > PRINT_MAX_ROWS)
+        printf("    ... %d more\n", map->nsites - PRINT_MAX_ROWS);
 }
 
 /*
- * profile_module: Static profiling pass.
+ * Persistent profile database (--save-profile / --load-profile).
  *
- * Walk every function in the module. For each MIR_CALL or MIR_INLINE
- * instruction, extract the callee name and record a call-site hit.
+ * A compact native-endian binary image that is usable straight from an
+ * mmap, with no parse and no allocation:
  *
- * Anchored to dossier Section 2.5:
- *   insn->ops[1].u.ref gives the callee item for call instructions.
- *   (ops[0] is the proto, ops[1] is the callee ref)
+ *   profile_db_header_t                  magic, version, counts
+ *   profile_db_entry_t  entries[count]   name hash, call count, lambda
+ *   int32_t             slots[nslots]    open-addressing index (-1 = empty)
+ *
+ * The slot table is the same linear-probing scheme as profile_map_t, so a
+ * lookup is hash -> probe -> entry directly in the mapping. Names are not
+ * stored; entries match by 64-bit FNV-1a hash alone, so two functions whose
+ * hashes collide share one profile entry (the first written wins). That is
+ * vanishingly unlikely at module scale, and profile_db_write() warns if it
+ * happens. The table always keeps an empty slot (nslots > count), and a
+ * probe never runs past nslots, so a corrupt file cannot hang a lookup.
  *
- * We also estimate loop multipliers: if a call site is inside a loop
- * (detected by the presence of backward jumps), we weight it higher.
- * For simplicity in v1, we just count static call sites.
+ * A map with `db` set falls back to the database for names it does not
+ * hold itself, which lets mutate_module() run on the first MIR_link()
+ * of a process without any telemetry pass.
  */
-static void profile_module(MIR_module_t m, profile_map_t *map) {
-    for (MIR_item_t item = DLIST_HEAD(MIR_item_t, m->items);
-         item != NULL;
-         item = DLIST_NEXT(MIR_item_t, item)) {
-
-        if (item->item_type != MIR_func_item) continue;
-        MIR_func_t func = item->u.func;
+#define PROFILE_DB_MAGIC   "NUMPROF1"
+#define PROFILE_DB_VERSION 1
+#define PROFILE_DB_BOM     0x01020304u  /* Byte-order check */
 
-        for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, func->insns);
-             insn != NULL;
-             insn = DLIST_NEXT(MIR_insn_t, insn)) {
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t bom;
+    uint32_t count;
+    uint32_t nslots;     /* Power of two */
+    double   max_count;
+} profile_db_header_t;
 
-            if (insn->code != MIR_CALL && insn->code != MIR_INLINE) continue;
+typedef struct {
+    uint64_t name_hash;
+    uint64_t call_count;
+    double   shadow_price;
+} profile_db_entry_t;
 
-            /*
-             * For MIR_CALL/MIR_INLINE: ops layout is:
-             *   ops[0] = proto ref
-             *   ops[1] = callee ref (MIR_item_t)
-             *   ops[2..] = return value(s), then arguments
-             *
-             * Anchored to dossier Section 2.5:
-             *   insn->ops[1].u.ref gives the callee item
-             */
-            MIR_item_t callee_item = insn->ops[1].u.ref;
-            if (callee_item == NULL) continue;
-            if (callee_item->item_type != MIR_func_item) continue;
+typedef struct profile_db {
+    void                     *base;
+    size_t                    len;
+    const profile_db_header_t *header;
+    const profile_db_entry_t *entries;
+    const int32_t            *slots;
+#ifdef _WIN32
+    HANDLE                    file, mapping;
+#endif
+} profile_db_t;
 
-            const char *callee_name = callee_item->u.func->name;
-            profile_map_increment(map, callee_name);
-        }
+static const profile_db_entry_t *profile_db_find(const profile_db_t *db, uint64_t h) {
+    uint32_t mask = db->header->nslots - 1;
+    uint32_t i = (uint32_t)h & mask;
+    for (uint32_t probes = 0; probes < db->header->nslots; probes++, i = (i + 1) & mask) {
+        int32_t idx = db->slots[i];
+        if (idx < 0) return NULL;
+        if (db->entries[idx].name_hash == h) return &db->entries[idx];
     }
-    profile_map_normalize(map);
+    return NULL;
 }
 
-/* ========================================================================
- * SECTION 4: MUTATION PASS (Phase 2 - The Agent)
- *
- * Implements mir_num_optimize_calls(): runs between MIR_load_module()
- * and MIR_link() to mutate MIR_CALL -> MIR_INLINE based on condition.
- *
- * The mutation is: insn->code = MIR_INLINE
- * This promotes the call to use the 200-insn threshold in MIR's native
- * process_inlines() instead of the 50-insn threshold for MIR_CALL.
- *
- * NOTE ON TWO-STAGE FILTER: Our mutation promotes MIR_CALL -> MIR_INLINE,
- * then MIR's native process_inlines() in MIR_link() makes the final
- * inlining decision at the 200-insn threshold. We are NOT bypassing
- * MIR's native inliner; we are feeding it different instruction codes.
- * ======================================================================== */
-
-typedef enum {
-    COND_NO_INLINE      = 0,  /* Leave all as MIR_CALL */
-    COND_BLIND_ALL      = 1,  /* Convert all MIR_CALL -> MIR_INLINE */
-    COND_RANDOM_50      = 2,  /* Random 50% conversion */
-    COND_SHADOW_PRICE   = 3,  /* NUM-predicted threshold */
-    COND_INVERTED_PRICE = 4,  /* Inverted: hot->low, cold->high */
-    COND_COUNT          = 5
-} experiment_condition_t;
-
-static const char *condition_names[COND_COUNT] = {
-    "No inlining",
-    "Blind inline-all",
-    "Random 50%",
-    "Shadow-price (NUM)",
-    "Inverted-price (control)"
-};
-
 /*
- * compute_adjusted_threshold: The NUM shadow-price formula.
- * From dossier Section 4.3 (one free parameter, simple linear scaling).
- *
- * For COND_SHADOW_PRICE:
- *   scale = clamp(lambda, 0.1, 5.0)
- *   T_adj = clamp(50 * scale, 5, 200)
- *
- * For COND_INVERTED_PRICE:
- *   lambda_inv = 1.0 - lambda  (hot becomes cold, cold becomes hot)
- *   Then same formula.
+ * profile_map_lookup: Shadow price for `name`, from the map itself or,
+ * failing that, its database. Returns 1 and sets *lambda if found;
+ * otherwise returns 0 and sets *lambda to 0.
  */
-static int compute_adjusted_threshold(double shadow_price, int inverted) {
-    double lambda = shadow_price;
-    if (inverted) {
-        /* Invert: hottest (lambda=1.0) -> coldest (0.0), and vice versa */
-        lambda = 1.0 - lambda;
+static int profile_map_lookup(const profile_map_t *map, const char *name,
+                              double *lambda) {
+    const profile_entry_t *e = profile_map_get(map, name);
+    if (e == NULL && map->db != NULL) {
+        const profile_db_entry_t *de = profile_db_find(map->db, profile_hash_name(name));
+        if (de != NULL) {
+            *lambda = de->shadow_price;
+            return 1;
+        }
     }
+    *lambda = e ? e->shadow_price : 0.0;
+    return e != NULL;
+}
 
-    /* Scale factor: lambda is already [0,1], scale to [0.1, 5.0] range */
-    /* Map [0,1] -> [SCALE_FLOOR, SCALE_CEIL] linearly */
-    double scale_factor = SCALE_FLOOR + lambda * (SCALE_CEIL - SCALE_FLOOR);
-    if (scale_factor < SCALE_FLOOR) scale_factor = SCALE_FLOOR;
-    if (scale_factor > SCALE_CEIL)  scale_factor = SCALE_CEIL;
-
-    int adjusted = (int)(MIR_CALL_INLINE_THRESHOLD * scale_factor);
-    if (adjusted < THRESHOLD_FLOOR)    adjusted = THRESHOLD_FLOOR;
-    if (adjusted > MIR_INLINE_THRESHOLD) adjusted = MIR_INLINE_THRESHOLD;
+static double profile_map_lambda(const profile_map_t *map, const char *name) {
+    double lambda;
+    profile_map_lookup(map, name, &lambda);
+    return lambda;
+}
 
-    return adjusted;
+/* Price of call site `index` in `caller`; falls back to the callee price. */
+static double profile_site_lambda(const profile_map_t *map, const char *caller,
+                                  int index, const char *callee) {
+    const site_entry_t *e = profile_map_get_site(map, caller, index, callee);
+    return e ? e->shadow_price : profile_map_lambda(map, callee);
 }
 
 /*
- * Recursion breaker: simple visited-set to prevent cycles.
- * Track which callee names we've already decided to inline in the
- * current mutation pass to prevent mutual-recursion expansion.
+ * profile_db_write: Save a normalized map. Writes to `path`.tmp and renames
+ * over `path`, so a concurrent reader never maps a half-written file.
+ * Returns 0 on success, -1 on I/O failure.
  */
-#define MAX_INLINE_CHAIN 64
-
-typedef struct {
-    const char *names[MAX_INLINE_CHAIN];
-    int         depth;
-} inline_chain_t;
+static int profile_db_write(const char *path, const profile_map_t *map) {
+    profile_db_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PROFILE_DB_MAGIC, sizeof(h.magic));
+    h.version = PROFILE_DB_VERSION;
+    h.bom = PROFILE_DB_BOM;
+    h.count = (uint32_t)map->count;
+    h.nslots = 16;
+    while (h.nslots < h.count * 2) h.nslots *= 2;
+    h.max_count = map->max_count;
 
-static void chain_init(inline_chain_t *chain) {
-    chain->depth = 0;
-}
+    int32_t *slots = malloc((size_t)h.nslots * sizeof(*slots));
+    if (slots == NULL) return -1;
+    memset(slots, 0xff, (size_t)h.nslots * sizeof(*slots));  /* all -1 */
+    for (int k = 0; k < map->count; k++) {
+        uint64_t hash = map->entries[k].name_hash;
+        uint32_t i = (uint32_t)hash & (h.nslots - 1);
+        while (slots[i] >= 0) {
+            if (map->entries[slots[i]].name_hash == hash)
+                fprintf(stderr, "  WARNING: profile db: '%s' and '%s' share a name hash; "
+                                "'%s' will read the first one's price\n",
+                        map->entries[slots[i]].func_name, map->entries[k].func_name,
+                        map->entries[k].func_name);
+            i = (i + 1) & (h.nslots - 1);
+        }
+        slots[i] = k;
+    }
 
-static int chain_contains(const inline_chain_t *chain, const char *name) {
-    for (int i = 0; i < chain->depth; i++) {
-        if (strcmp(chain->names[i], name) == 0) return 1;
+    char tmp[1024];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "wb");
+    if (f == NULL) {
+        free(slots);
+        return -1;
+    }
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    for (int k = 0; ok && k < map->count; k++) {
+        profile_db_entry_t e;
+        e.name_hash = map->entries[k].name_hash;
+        e.call_count = map->entries[k].call_count;
+        e.shadow_price = map->entries[k].shadow_price;
+        ok = fwrite(&e, sizeof(e), 1, f) == 1;
+    }
+    ok = ok && fwrite(slots, sizeof(*slots), h.nslots, f) == h.nslots;
+    ok = (fclose(f) == 0) && ok;
+    free(slots);
+#ifdef _WIN32
+    remove(path);  /* rename() does not replace on Windows */
+#endif
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        return -1;
     }
     return 0;
 }
 
-static int chain_push(inline_chain_t *chain, const char *name) {
-    if (chain->depth >= MAX_INLINE_CHAIN) return 0;
-    chain->names[chain->depth++] = name;
-    return 1;
+static void profile_db_close(profile_db_t *db) {
+#ifdef _WIN32
+    if (db->base) UnmapViewOfFile(db->base);
+    if (db->mapping) CloseHandle(db->mapping);
+    if (db->file && db->file != INVALID_HANDLE_VALUE) CloseHandle(db->file);
+#else
+    if (db->base) munmap(db->base, db->len);
+#endif
+    memset(db, 0, sizeof(*db));
 }
 
 /*
- * mutate_module: Apply experimental condition to all MIR_CALL instructions.
- *
- * Runs BEFORE MIR_link(). Modifies insn->code in-place.
- *
- * Returns: number of MIR_CALL instructions promoted to MIR_INLINE.
+ * profile_db_open: Map `path` read-only and validate its layout.
+ * Returns 0 on success, -1 if the file is missing, truncated or foreign.
  */
-static int mutate_module(MIR_module_t m,
-                         experiment_condition_t condition,
-                         const profile_map_t *profile,
-                         unsigned int *rng_state) {
-    int mutations = 0;
-    inline_chain_t chain;
-    chain_init(&chain);
-
-    for (MIR_item_t item = DLIST_HEAD(MIR_item_t, m->items);
-         item != NULL;
-         item = DLIST_NEXT(MIR_item_t, item)) {
-
-        if (item->item_type != MIR_func_item) continue;
-        MIR_func_t func = item->u.func;
+static int profile_db_open(const char *path, profile_db_t *db) {
+    memset(db, 0, sizeof(*db));
+#ifdef _WIN32
+    db->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (db->file == INVALID_HANDLE_VALUE) return -1;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(db->file, &size) || size.QuadPart < (LONGLONG)sizeof(profile_db_header_t)) {
+        profile_db_close(db);
+        return -1;
+    }
+    db->len = (size_t)size.QuadPart;
+    db->mapping = CreateFileMappingA(db->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    db->base = db->mapping ? MapViewOfFile(db->mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (db->base == NULL) {
+        profile_db_close(db);
+        return -1;
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(profile_db_header_t)) {
+        close(fd);
+        return -1;
+    }
+    db->len = (size_t)st.st_size;
+    db->base = mmap(NULL, db->len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (db->base == MAP_FAILED) {
+        db->base = NULL;
+        return -1;
+    }
+#endif
 
-        for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, func->insns);
-             insn != NULL;
-             insn = DLIST_NEXT(MIR_insn_t, insn)) {
+    db->header = db->base;
+    const profile_db_header_t *h = db->header;
+    size_t need = sizeof(*h) + (size_t)h->count * sizeof(profile_db_entry_t)
+                + (size_t)h->nslots * sizeof(int32_t);
+    if (memcmp(h->magic, PROFILE_DB_MAGIC, sizeof(h->magic)) != 0 ||
+        h->version != PROFILE_DB_VERSION || h->bom != PROFILE_DB_BOM ||
+        h->nslots == 0 || (h->nslots & (h->nslots - 1)) != 0 ||
+        h->nslots <= h->count || h->count > INT32_MAX || db->len < need) {
+        profile_db_close(db);
+        return -1;
+    }
+    db->entries = (const profile_db_entry_t *)(h + 1);
+    db->slots = (const int32_t *)(db->entries + h->count);
+    for (uint32_t i = 0; i < h->nslots; i++) {
+        if (db->slots[i] < -1 || db->slots[i] >= (int32_t)h->count) {
+            profile_db_close(db);
+            return -1;
+        }
+    }
+    return 0;
+}
 
-            if (insn->code != MIR_CALL) continue;
+/*
+ * Workload modules. One copy of the workload is benchmark_nmodules
+ * consecutive modules of the context's module list, starting at the one
+ * benchmark_module() returned; without --modules that is `m` alone. Passes
+ * that walk "the module" walk the items of all of them, so one func cache,
+ * one call graph and one profile span every module, and a call through an
+ * import item is just another call site.
+ */
+static int benchmark_nmodules = 1;  /* Modules per workload copy (--modules) */
 
-            /* Extract callee (same pattern as profiling pass) */
-            MIR_item_t callee_item = insn->ops[1].u.ref;
-            if (callee_item == NULL) continue;
-            if (callee_item->item_type != MIR_func_item) continue;
+static MIR_item_t workload_items_from(MIR_module_t mm, int left) {
+    for (; mm != NULL && left > 0; mm = DLIST_NEXT(MIR_module_t, mm), left--) {
+        MIR_item_t head = DLIST_HEAD(MIR_item_t, mm->items);
+        if (head != NULL) return head;
+    }
+    return NULL;
+}
 
-            const char *callee_name = callee_item->u.func->name;
-            int callee_insns = count_func_insns(callee_item->u.func);
+static MIR_item_t workload_first_item(MIR_module_t m) {
+    return workload_items_from(m, benchmark_nmodules);
+}
 
-            /* Recursion breaker: skip if callee already in chain */
-            if (chain_contains(&chain, callee_name)) continue;
+static MIR_item_t workload_next_item(MIR_module_t m, MIR_item_t item) {
+    MIR_item_t next = DLIST_NEXT(MIR_item_t, item);
+    if (next != NULL) return next;
+    int k = 0;  /* Position of item->module in the workload */
+    for (MIR_module_t mm = m; mm != item->module; mm = DLIST_NEXT(MIR_module_t, mm)) k++;
+    return workload_items_from(DLIST_NEXT(MIR_module_t, item->module),
+                               benchmark_nmodules - k - 1);
+}
 
-            int should_promote = 0;
+/* MIR_load_module() every module of the workload copy starting at `m`. */
+static void workload_load(MIR_context_t ctx, MIR_module_t m) {
+    for (int k = 0; k < benchmark_nmodules && m != NULL;
+         k++, m = DLIST_NEXT(MIR_module_t, m))
+        MIR_load_module(ctx, m);
+}
 
-            switch (condition) {
-            case COND_NO_INLINE:
-                /* Leave as MIR_CALL */
-                should_promote = 0;
-                break;
+/*
+ * profile_map_hydrate: Copy database entries for the functions of `m` into
+ * the map, for modes that iterate a map by name (--iterative). Normal
+ * conditions do not need this; they look prices up through map->db.
+ */
+static void profile_map_hydrate(profile_map_t *map, const profile_db_t *db,
+                                MIR_module_t m) {
+    for (MIR_item_t item = workload_first_item(m);
+         item != NULL;
+         item = workload_next_item(m, item)) {
+        if (item->item_type != MIR_func_item) continue;
+        const profile_db_entry_t *de =
+            profile_db_find(db, profile_hash_name(item->u.func->name));
+        if (de == NULL) continue;
+        profile_map_add(map, item->u.func->name, de->call_count);
+        profile_entry_t *e = profile_map_get(map, item->u.func->name);
+        if (e != NULL) e->shadow_price = de->shadow_price;  /* NULL: dropped, out of memory */
+    }
+    map->max_count = db->header->max_count;
+}
 
-            case COND_BLIND_ALL:
-                /* Promote everything */
-                should_promote = 1;
-                break;
+/*
+ * Sharded call counters for concurrent telemetry.
+ *
+ * One shard per profiling thread, indexed by dense function ID (position
+ * of the function among the module's func items), followed by dense call
+ * site IDs (call_site_ids() order). Each shard starts on its
+ * own cache line and is padded to a whole number of lines, so threads never
+ * write to a line another thread touches. Every shard has exactly one writer
+ * (the instrumented code running on its thread), so increments need no
+ * atomic RMW; the master reads with relaxed atomic loads, which makes a
+ * merge safe even while workers are still running.
+ */
+typedef struct {
+    _Atomic uint64_t *base;     /* nshards * stride counters, line aligned */
+    void             *raw;      /* Allocation backing base */
+    int               nshards;
+    int               ncounters;  /* Live counters per shard */
+    size_t            stride;   /* Counters per shard, multiple of a line */
+} profile_shards_t;
 
-            case COND_RANDOM_50:
-                /* XorShift32 for reproducible randomness */
-                *rng_state ^= *rng_state << 13;
-                *rng_state ^= *rng_state >> 17;
-                *rng_state ^= *rng_state << 5;
-                should_promote = (*rng_state % 2 == 0);
-                break;
+static int profile_shards_init(profile_shards_t *s, int nshards, int ncounters) {
+    const size_t per_line = CACHE_LINE / sizeof(uint64_t);
+    s->nshards = nshards;
+    s->ncounters = ncounters;
+    s->stride = ((size_t)ncounters + per_line - 1) / per_line * per_line;
+    size_t bytes = (size_t)nshards * s->stride * sizeof(uint64_t);
+    s->raw = calloc(1, bytes + CACHE_LINE);
+    if (s->raw == NULL) return -1;
+    s->base = (_Atomic uint64_t *)(((uintptr_t)s->raw + CACHE_LINE - 1)
+                                   & ~(uintptr_t)(CACHE_LINE - 1));
+    return 0;
+}
 
-            case COND_SHADOW_PRICE: {
-                profile_entry_t *pe = profile_map_get(
-                    (profile_map_t *)profile, callee_name);
-                double lambda = pe ? pe->shadow_price : 0.0;
-                int threshold = compute_adjusted_threshold(lambda, 0);
-                should_promote = (callee_insns < threshold);
-                break;
-            }
+static void profile_shards_free(profile_shards_t *s) {
+    free(s->raw);
+    memset(s, 0, sizeof(*s));
+}
 
-            case COND_INVERTED_PRICE: {
-                profile_entry_t *pe = profile_map_get(
-                    (profile_map_t *)profile, callee_name);
-                double lambda = pe ? pe->shadow_price : 0.0;
-                int threshold = compute_adjusted_threshold(lambda, 1);
-                should_promote = (callee_insns < threshold);
-                break;
-            }
+static _Atomic uint64_t *profile_shard(const profile_shards_t *s, int shard) {
+    return s->base + (size_t)shard * s->stride;
+}
 
-            default:
-                break;
-            }
+/* Sum of counter `id` over all shards. */
+static uint64_t profile_shards_total(const profile_shards_t *s, int id) {
+    uint64_t total = 0;
+    for (int k = 0; k < s->nshards; k++)
+        total += atomic_load_explicit(&profile_shard(s, k)[id], memory_order_relaxed);
+    return total;
+}
 
-            if (should_promote) {
-                insn->code = MIR_INLINE;
-                chain_push(&chain, callee_name);
-                mutations++;
-            }
-        }
+/*
+ * profile_shards_merge: Sum function counters 0..nfuncs-1 of all shards
+ * into `map`, using names[id] for dense function ID `id` (site counters,
+ * if any, follow). Functions named `skip` (the entry point) are left out.
+ * Does not normalize.
+ */
+static void profile_shards_merge(const profile_shards_t *s, int nfuncs, const char **names,
+                                 const char *skip, profile_map_t *map) {
+    for (int id = 0; id < nfuncs; id++) {
+        if (skip != NULL && strcmp(names[id], skip) == 0) continue;
+        profile_map_add(map, names[id], profile_shards_total(s, id));
     }
-
-    return mutations;
 }
 
 /* ========================================================================
- * SECTION 5: BENCHMARK IR (v2 - 8-function growth-budget stress test)
+ * SECTION 3: PROFILING PASS (Phase 1)
  *
- * 8 callee functions at varying sizes in the 55-180 insn sweet spot:
- *   HOT  (called every iter):       f_hot1(55), f_hot2(75), f_hot3(100), f_hot4(60)
- *   WARM (called every 10th iter):  f_warm1(80), f_warm2(120)
- *   COLD (called every 1000th iter): f_cold1(150), f_cold2(180)
+ * Two sources of call frequency:
  *
- * Total callee insns if all inlined: 55+75+100+60+80+120+150+180 = 820
- * Driver starts at ~40 insns. Growth to ~860 = 2150% >> 150% budget.
- * MIR growth check: caller > 150% original AND > 200 insns -> stop.
- * Blind-all WILL hit the ceiling. Shadow-price should prioritize hot.
+ *   profile_module_runtime(): the real telemetry pass. Private copies of
+ *   the IR are instrumented with per-function entry counters and executed
+ *   under the MIR interpreter on a training input (PROFILE_N), one copy
+ *   per profiling thread, each running its share of the input and counting
+ *   into its own shard. Merged entry counts feed profile_map_normalize().
+ *
+ *   profile_module(): static call-site counting, used as a fallback when
+ *   the module cannot be executed (no entry point, instrumentation failed).
+ *
+ * Instrumentation is done at the IR level instead of patching
+ * call_insn_execute() in mir-interp.c, so it needs no extra MIR patch and
+ * the probe is identical under the interpreter and the generator.
  * ======================================================================== */
 
-static const char *benchmark_ir =
-"m_bench: module\n"
-"  export driver\n"
-"  p_f_hot1: proto i64, i64:flag, i64:x\n"
-"  p_f_hot2: proto i64, i64:flag, i64:x\n"
-"  p_f_hot3: proto i64, i64:flag, i64:x\n"
-"  p_f_hot4: proto i64, i64:flag, i64:x\n"
-"  p_f_warm1: proto i64, i64:flag, i64:x\n"
-"  p_f_warm2: proto i64, i64:flag, i64:x\n"
-"  p_f_cold1: proto i64, i64:flag, i64:x\n"
-"  p_f_cold2: proto i64, i64:flag, i64:x\n"
-"\n"
-/* --- f_hot1: ~55 insns, HOT path --- */
-"  f_hot1: func i64, i64:flag, i64:x\n"
-"    local i64:t1, i64:t2, i64:t3, i64:t4\n"
-"    bne h1_heavy, flag, 1\n"
-"    add t1, x, 1\n"
-"    ret t1\n"
-"  h1_heavy:\n"
-"    add t1, x, 1\n"
-"    add t2, t1, 2\n"
-"    mul t3, t2, 3\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, t2\n"
-"    add t2, t1, t3\n"
-"    mul t3, t2, 2\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, 5\n"
-"    add t2, t1, t4\n"
-"    mul t3, t2, 3\n"
-"    sub t4, t3, t1\n"
-"    add t1, t4, t2\n"
-"    mul t2, t1, 2\n"
-"    add t3, t2, t4\n"
-"    sub t4, t3, 5\n"
-"    add t1, x, 1\n"
-"    add t2, t1, 2\n"
-"    mul t3, t2, 3\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, t2\n"
-"    add t2, t1, t3\n"
-"    mul t3, t2, 2\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, 5\n"
-"    add t2, t1, t4\n"
-"    mul t3, t2, 3\n"
-"    sub t4, t3, t1\n"
-"    add t1, t4, t2\n"
-"    mul t2, t1, 2\n"
-"    add t3, t2, t4\n"
-"    sub t4, t3, 5\n"
-"    add t1, x, 1\n"
-"    add t2, t1, 2\n"
-"    mul t3, t2, 3\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, t2\n"
-"    add t2, t1, t3\n"
-"    mul t3, t2, 2\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, 5\n"
-"    add t2, t1, t4\n"
-"    mul t3, t2, 3\n"
-"    sub t4, t3, t1\n"
-"    add t1, t4, t2\n"
-"    mul t2, t1, 2\n"
-"    add t3, t2, t4\n"
-"    sub t4, t3, 5\n"
-"    add t1, x, 1\n"
-"    add t2, t1, 2\n"
-"    ret t4\n"
-"  endfunc\n"
-"\n"
-/* --- f_hot2: ~75 insns, HOT path --- */
-"  f_hot2: func i64, i64:flag, i64:x\n"
-"    local i64:t1, i64:t2, i64:t3, i64:t4\n"
-"    bne h2_heavy, flag, 1\n"
-"    add t1, x, 1\n"
-"    ret t1\n"
-"  h2_heavy:\n"
-"    add t1, x, 1\n"
-"    add t2, t1, 2\n"
-"    mul t3, t2, 3\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, t2\n"
-"    add t2, t1, t3\n"
-"    mul t3, t2, 2\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, 5\n"
-"    add t2, t1, t4\n"
-"    mul t3, t2, 3\n"
-"    sub t4, t3, t1\n"
-"    add t1, t4, t2\n"
-"    mul t2, t1, 2\n"
-"    add t3, t2, t4\n"
-"    sub t4, t3, 5\n"
-"    add t1, x, 1\n"
-"    add t2, t1, 2\n"
-"    mul t3, t2, 3\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, t2\n"
-"    add t2, t1, t3\n"
-"    mul t3, t2, 2\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, 5\n"
-"    add t2, t1, t4\n"
-"    mul t3, t2, 3\n"
-"    sub t4, t3, t1\n"
-"    add t1, t4, t2\n"
-"    mul t2, t1, 2\n"
-"    add t3, t2, t4\n"
-"    sub t4, t3, 5\n"
-"    add t1, x, 1\n"
-"    add t2, t1, 2\n"
-"    mul t3, t2, 3\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, t2\n"
-"    add t2, t1, t3\n"
-"    mul t3, t2, 2\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, 5\n"
-"    add t2, t1, t4\n"
-"    mul t3, t2, 3\n"
-"    sub t4, t3, t1\n"
-"    add t1, t4, t2\n"
-"    mul t2, t1, 2\n"
-"    add t3, t2, t4\n"
-"    sub t4, t3, 5\n"
-"    add t1, x, 1\n"
-"    add t2, t1, 2\n"
-"    mul t3, t2, 3\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, t2\n"
-"    add t2, t1, t3\n"
-"    mul t3, t2, 2\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, 5\n"
-"    add t2, t1, t4\n"
-"    mul t3, t2, 3\n"
-"    sub t4, t3, t1\n"
-"    add t1, t4, t2\n"
-"    mul t2, t1, 2\n"
-"    add t3, t2, t4\n"
-"    sub t4, t3, 5\n"
-"    add t1, x, 1\n"
-"    add t2, t1, 2\n"
-"    mul t3, t2, 3\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, t2\n"
-"    add t2, t1, t3\n"
-"    ret t4\n"
-"  endfunc\n"
-"\n"
-/* --- f_hot3: ~100 insns, HOT path --- */
-"  f_hot3: func i64, i64:flag, i64:x\n"
-"    local i64:t1, i64:t2, i64:t3, i64:t4\n"
-"    bne h3_heavy, flag, 1\n"
-"    add t1, x, 1\n"
-"    ret t1\n"
-"  h3_heavy:\n"
-"    add t1, x, 1\n"
-"    add t2, t1, 2\n"
-"    mul t3, t2, 3\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, t2\n"
-"    add t2, t1, t3\n"
-"    mul t3, t2, 2\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, 5\n"
-"    add t2, t1, t4\n"
-"    mul t3, t2, 3\n"
-"    sub t4, t3, t1\n"
-"    add t1, t4, t2\n"
-"    mul t2, t1, 2\n"
-"    add t3, t2, t4\n"
-"    sub t4, t3, 5\n"
-"    add t1, x, 1\n"
-"    add t2, t1, 2\n"
-"    mul t3, t2, 3\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, t2\n"
-"    add t2, t1, t3\n"
-"    mul t3, t2, 2\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, 5\n"
-"    add t2, t1, t4\n"
-"    mul t3, t2, 3\n"
-"    sub t4, t3, t1\n"
-"    add t1, t4, t2\n"
-"    mul t2, t1, 2\n"
-"    add t3, t2, t4\n"
-"    sub t4, t3, 5\n"
-"    add t1, x, 1\n"
-"    add t2, t1, 2\n"
-"    mul t3, t2, 3\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, t2\n"
-"    add t2, t1, t3\n"
-"    mul t3, t2, 2\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, 5\n"
-"    add t2, t1, t4\n"
-"    mul t3, t2, 3\n"
-"    sub t4, t3, t1\n"
-"    add t1, t4, t2\n"
-"    mul t2, t1, 2\n"
-"    add t3, t2, t4\n"
-"    sub t4, t3, 5\n"
-"    add t1, x, 1\n"
-"    add t2, t1, 2\n"
-"    mul t3, t2, 3\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, t2\n"
-"    add t2, t1, t3\n"
-"    mul t3, t2, 2\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, 5\n"
-"    add t2, t1, t4\n"
-"    mul t3, t2, 3\n"
-"    sub t4, t3, t1\n"
-"    add t1, t4, t2\n"
-"    mul t2, t1, 2\n"
-"    add t3, t2, t4\n"
-"    sub t4, t3, 5\n"
-"    add t1, x, 1\n"
-"    add t2, t1, 2\n"
-"    mul t3, t2, 3\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, t2\n"
-"    add t2, t1, t3\n"
-"    mul t3, t2, 2\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, 5\n"
-"    add t2, t1, t4\n"
-"    mul t3, t2, 3\n"
-"    sub t4, t3, t1\n"
-"    add t1, t4, t2\n"
-"    mul t2, t1, 2\n"
-"    add t3, t2, t4\n"
-"    sub t4, t3, 5\n"
-"    add t1, x, 1\n"
-"    add t2, t1, 2\n"
-"    mul t3, t2, 3\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, t2\n"
-"    add t2, t1, t3\n"
-"    mul t3, t2, 2\n"
-"    add t4, t3, t1\n"
-"    sub t1, t4, 5\n"
-"    add t2, t1, t4\n"
-"    mul t3, t2, 3\n"
-"    sub t4, t3, t1\n"
+/*
+ * find_func_item: Look up a function item by name in a module.
+ * Returns NULL if the module has no such function.
+ */
+static MIR_item_t find_func_item(MIR_module_t m, const char *name) {
+    for (MIR_item_t item = workload_first_item(m);
+         item != NULL;
+         item = workload_next_item(m, item)) {
+        if (item->item_type == MIR_func_item &&
+            strcmp(item->u.func->name, name) == 0)
+            return item;
+    }
+    return NULL;
+}
+
+/*
+ * count_func_insns: Count instructions in a MIR function.
+ * Anchored to: DLIST traversal pattern from PoC v2 (confirmed working).
+ *
+ * NOTE: We access func->insns via DLIST. The MIR_insn_t is iterable
+ * through the same DLIST_HEAD/DLIST_NEXT pattern used for items.
+ */
+static int count_func_insns(MIR_func_t func) {
+    int count = 0;
+    for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, func->insns);
+         insn != NULL;
+         insn = DLIST_NEXT(MIR_insn_t, insn)) {
+        count++;
+    }
+    return count;
+}
+
+/*
+ * Per-function metadata cache.
+ *
+ * count_func_insns() walks the whole instruction DLIST, and mutate_module()
+ * needs the callee size at every call site, so a hot callee referenced from
+ * thousands of sites used to be rewalked thousands of times. The cache is
+ * built once after MIR_load_module(): funcs[] is dense in item order (the
+ * same dense ID the telemetry shards use), and slots[] is an
+ * open-addressing index on the MIR_item_t pointer for O(1) lookup from a
+ * call operand. Over several modules, each import item is indexed too,
+ * under the function of that name defined in another module, so a
+ * cross-module call resolves to its callee before MIR_link() does it.
+ *
+ * Sizes describe the module as loaded. mutate_module() only rewrites
+ * insn->code, so they stay valid through mutation; MIR_link()'s inliner
+ * changes them, so rebuild the cache if you need post-link sizes.
+ */
+typedef struct {
+    MIR_item_t  item;
+    const char *name;
+    int         insns;     /* IR instruction count */
+    const MIR_reg_t *arg_regs;  /* Register of each parameter, declaration order */
+} func_info_t;
+
+typedef struct {
+    func_info_t *funcs;      /* Dense, item order */
+    MIR_reg_t   *arg_regs;   /* Backing store of funcs[].arg_regs */
+    int          count;
+    int32_t     *slots;      /* Index into funcs[], -1 = empty */
+    MIR_item_t  *keys;       /* Item indexed by each slot (func or import) */
+    uint32_t     slot_mask;  /* Number of slots - 1 */
+    int          imports;    /* Import items resolved to a func */
+} func_cache_t;
+
+static uint32_t func_cache_hash(MIR_item_t item) {
+    return (uint32_t)(((uintptr_t)item >> 4) * 0x9E3779B97F4A7C15ULL >> 32);
+}
+
+static void func_cache_free(func_cache_t *fc) {
+    free(fc->funcs);
+    free(fc->arg_regs);
+    free(fc->slots);
+    free(fc->keys);
+    memset(fc, 0, sizeof(*fc));
+}
+
+static void func_cache_insert(func_cache_t *fc, MIR_item_t key, int idx) {
+    uint32_t i = func_cache_hash(key) & fc->slot_mask;
+    while (fc->slots[i] >= 0) i = (i + 1) & fc->slot_mask;
+    fc->slots[i] = idx;
+    fc->keys[i] = key;
+}
+
+/*
+ * Returns 0 on success, -1 on allocation failure (cache left empty).
+ * `ctx` resolves each parameter's register by name (MIR_reg()).
+ */
+static int func_cache_build(MIR_context_t ctx, MIR_module_t m, func_cache_t *fc) {
+    memset(fc, 0, sizeof(*fc));
+    int n = 0, nimports = 0;
+    size_t nargs = 0;
+    for (MIR_item_t item = workload_first_item(m);
+         item != NULL;
+         item = workload_next_item(m, item)) {
+        if (item->item_type == MIR_func_item) {
+            n++;
+            nargs += item->u.func->nargs;
+        } else if (item->item_type == MIR_import_item) {
+            nimports++;
+        }
+    }
+
+    uint32_t nslots = 16;
+    while (nslots < (uint32_t)(n + nimports) * 2) nslots *= 2;
+    fc->funcs = calloc(n > 0 ? (size_t)n : 1, sizeof(*fc->funcs));
+    fc->arg_regs = malloc((nargs > 0 ? nargs : 1) * sizeof(*fc->arg_regs));
+    fc->slots = malloc((size_t)nslots * sizeof(*fc->slots));
+    fc->keys = malloc((size_t)nslots * sizeof(*fc->keys));
+    if (fc->funcs == NULL || fc->arg_regs == NULL || fc->slots == NULL || fc->keys == NULL) {
+        func_cache_free(fc);
+        return -1;
+    }
+    memset(fc->slots, 0xff, (size_t)nslots * sizeof(*fc->slots));  /* all -1 */
+    fc->slot_mask = nslots - 1;
+
+    size_t arg = 0;
+    for (MIR_item_t item = workload_first_item(m);
+         item != NULL;
+         item = workload_next_item(m, item)) {
+        if (item->item_type != MIR_func_item) continue;
+        MIR_func_t func = item->u.func;
+        func_info_t *fi = &fc->funcs[fc->count];
+        fi->item = item;
+        fi->name = func->name;
+        fi->insns = count_func_insns(func);
+        fi->arg_regs = &fc->arg_regs[arg];
+        for (uint32_t k = 0; k < func->nargs; k++)
+            fc->arg_regs[arg++] = MIR_reg(ctx, VARR_GET(MIR_var_t, func->vars, k).name, func);
+        func_cache_insert(fc, item, fc->count++);
+    }
+    if (nimports == 0) return 0;
+
+    /* Imports: match by name against functions of the other modules */
+    uint32_t nnames = 16;
+    while (nnames < (uint32_t)n * 2) nnames *= 2;
+    int32_t *by_name = malloc((size_t)nnames * sizeof(int32_t));
+    if (by_name == NULL) {
+        func_cache_free(fc);
+        return -1;
+    }
+    memset(by_name, 0xff, (size_t)nnames * sizeof(int32_t));
+    for (int k = 0; k < fc->count; k++) {
+        uint32_t i = (uint32_t)profile_hash_name(fc->funcs[k].name) & (nnames - 1);
+        while (by_name[i] >= 0) i = (i + 1) & (nnames - 1);
+        by_name[i] = k;
+    }
+    for (MIR_item_t item = workload_first_item(m);
+         item != NULL;
+         item = workload_next_item(m, item)) {
+        if (item->item_type != MIR_import_item) continue;
+        const char *name = item->u.import_id;
+        for (uint32_t i = (uint32_t)profile_hash_name(name) & (nnames - 1);
+             by_name[i] >= 0; i = (i + 1) & (nnames - 1)) {
+            const func_info_t *fi = &fc->funcs[by_name[i]];
+            if (fi->item->module != item->module && strcmp(fi->name, name) == 0) {
+                func_cache_insert(fc, item, by_name[i]);
+                fc->imports++;
+                break;
+            }
+        }
+    }
+    free(by_name);
+    return 0;
+}
+
+static const func_info_t *func_cache_get(const func_cache_t *fc, MIR_item_t item) {
+    if (fc->slots == NULL) return NULL;
+    for (uint32_t i = func_cache_hash(item) & fc->slot_mask;;
+         i = (i + 1) & fc->slot_mask) {
+        int32_t idx = fc->slots[i];
+        if (idx < 0) return NULL;
+        if (fc->keys[i] == item) return &fc->funcs[idx];
+    }
+}
+
+/*
+ * count_cross_module_sites: Call sites in `fc` that reach their callee
+ * through a resolved import item; with `inlined_only`, just the ones
+ * promoted to MIR_INLINE.
+ */
+static int count_cross_module_sites(const func_cache_t *fc, int inlined_only) {
+    int n = 0;
+    for (int f = 0; f < fc->count; f++) {
+        for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, fc->funcs[f].item->u.func->insns);
+             insn != NULL; insn = DLIST_NEXT(MIR_insn_t, insn)) {
+            if (insn->code != MIR_INLINE && (inlined_only || insn->code != MIR_CALL)) continue;
+            MIR_item_t callee = insn->ops[1].u.ref;
+            if (callee != NULL && callee->item_type == MIR_import_item &&
+                func_cache_get(fc, callee) != NULL)
+                n++;
+        }
+    }
+    return n;
+}
+
+/*
+ * Static frequency estimation (no runtime profile available).
+ *
+ * Per function, every insn gets a relative execution weight:
+ *   - Loops: a branch back to an earlier label closes a loop over
+ *     [label, branch]; each enclosing loop multiplies by STATIC_LOOP_WEIGHT
+ *     (10^depth).
+ *   - Guards: a forward conditional branch over [branch+1, target) scales
+ *     that region by its fall-through probability. "bne L, r, 0" after
+ *     "mod r, x, K" falls through 1 time in K (beq: K-1 in K); other
+ *     guards use STATIC_BRANCH_PROB. When the region ends in a "jmp" over an
+ *     else-part, that part gets the complement. Branches that leave the
+ *     innermost loop are exits and do not scale the loop body.
+ * The weight at a call site is the site's frequency per caller entry.
+ */
+typedef struct {
+    MIR_insn_t label;
+    int        pos;
+} label_pos_t;
+
+static int label_pos_cmp(const void *a, const void *b) {
+    uintptr_t x = (uintptr_t)((const label_pos_t *)a)->label;
+    uintptr_t y = (uintptr_t)((const label_pos_t *)b)->label;
+    return (x > y) - (x < y);
+}
+
+static int label_pos_find(const label_pos_t *labels, int n, MIR_insn_t label) {
+    label_pos_t key = {label, 0};
+    const label_pos_t *lp = bsearch(&key, labels, (size_t)n, sizeof(*labels), label_pos_cmp);
+    return lp ? lp->pos : -1;
+}
+
+/* Fall-through probability of the conditional branch at insns[p]. */
+static double guard_fallthrough_prob(MIR_insn_t *insns, int p) {
+    MIR_insn_t br = insns[p];
+    int bne = (br->code == MIR_BNE || br->code == MIR_BNES);
+    int beq = (br->code == MIR_BEQ || br->code == MIR_BEQS);
+    if ((bne || beq) && br->nops == 3 && br->ops[1].mode == MIR_OP_REG &&
+        br->ops[2].mode == MIR_OP_INT && br->ops[2].u.i == 0) {
+        for (int q = p - 1; q >= 0 && q >= p - 4; q--) {
+            MIR_insn_t d = insns[q];
+            if (d->nops < 1 || d->ops[0].mode != MIR_OP_REG ||
+                d->ops[0].u.reg != br->ops[1].u.reg) continue;
+            if ((d->code == MIR_MOD || d->code == MIR_MODS || d->code == MIR_UMOD ||
+                 d->code == MIR_UMODS) && d->ops[2].mode == MIR_OP_INT && d->ops[2].u.i > 1) {
+                double k = (double)d->ops[2].u.i;
+                return bne ? 1.0 / k : (k - 1.0) / k;
+            }
+            break;  /* Defined by something else */
+        }
+    }
+    return STATIC_BRANCH_PROB;
+}
+
+/*
+ * estimate_insn_weights: Fill weight[0..n) for the n insns of `func`
+ * (insns[] receives them in order). Returns n, or -1 on allocation failure.
+ */
+static int estimate_insn_weights(MIR_func_t func, MIR_insn_t **insns_out,
+                                 double **weight_out) {
+    int n = 0, nlabels = 0;
+    for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, func->insns); insn != NULL;
+         insn = DLIST_NEXT(MIR_insn_t, insn)) {
+        n++;
+        if (insn->code == MIR_LABEL) nlabels++;
+    }
+    MIR_insn_t *insns = malloc((n > 0 ? (size_t)n : 1) * sizeof(*insns));
+    double *weight = malloc((n > 0 ? (size_t)n : 1) * sizeof(*weight));
+    label_pos_t *labels = malloc((nlabels > 0 ? (size_t)nlabels : 1) * sizeof(*labels));
+    int *loop_lo = malloc((n > 0 ? (size_t)n : 1) * sizeof(int));
+    int *loop_hi = malloc((n > 0 ? (size_t)n : 1) * sizeof(int));
+    if (insns == NULL || weight == NULL || labels == NULL || loop_lo == NULL || loop_hi == NULL) {
+        free(insns); free(weight); free(labels); free(loop_lo); free(loop_hi);
+        return -1;
+    }
+
+    int i = 0, l = 0;
+    for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, func->insns); insn != NULL;
+         insn = DLIST_NEXT(MIR_insn_t, insn), i++) {
+        insns[i] = insn;
+        weight[i] = 1.0;
+        if (insn->code == MIR_LABEL) {
+            labels[l].label = insn;
+            labels[l++].pos = i;
+        }
+    }
+    qsort(labels, (size_t)nlabels, sizeof(*labels), label_pos_cmp);
+
+    /* Pass 1: loops from back-edges; several back-edges to one header are one loop */
+    int nloops = 0;
+    for (int p = 0; p < n; p++) {
+        if (!MIR_branch_code_p(insns[p]->code) || insns[p]->ops[0].mode != MIR_OP_LABEL) continue;
+        int q = label_pos_find(labels, nlabels, insns[p]->ops[0].u.label);
+        if (q < 0 || q > p) continue;
+        int lo = q, loop = 0;
+        while (loop < nloops && loop_lo[loop] != q) loop++;
+        if (loop < nloops) {
+            lo = loop_hi[loop] + 1;  /* Extend the loop to this back-edge */
+            loop_hi[loop] = p;
+        } else {
+            loop_lo[nloops] = q;
+            loop_hi[nloops++] = p;
+        }
+        for (int k = lo; k <= p; k++) weight[k] *= STATIC_LOOP_WEIGHT;
+    }
+
+    /* Pass 2: forward guards */
+    for (int p = 0; p < n; p++) {
+        MIR_insn_t br = insns[p];
+        if (br->code == MIR_JMP || !MIR_branch_code_p(br->code) ||
+            br->ops[0].mode != MIR_OP_LABEL) continue;
+        int q = label_pos_find(labels, nlabels, br->ops[0].u.label);
+        if (q <= p) continue;
+
+        /* Loop exit: target beyond the innermost loop holding the branch */
+        int inner = -1;
+        for (int k = 0; k < nloops; k++)
+            if (loop_lo[k] <= p && p <= loop_hi[k] &&
+                (inner < 0 || loop_hi[k] - loop_lo[k] < loop_hi[inner] - loop_lo[inner]))
+                inner = k;
+        if (inner >= 0 && q > loop_hi[inner]) continue;
+
+        double pf = guard_fallthrough_prob(insns, p);
+        for (int k = p + 1; k < q; k++) weight[k] *= pf;
+
+        /* if/else: "jmp r" right before the target skips the else-part */
+        MIR_insn_t j = insns[q - 1];
+        if (q - 1 > p && j->code == MIR_JMP && j->ops[0].mode == MIR_OP_LABEL) {
+            int r = label_pos_find(labels, nlabels, j->ops[0].u.label);
+            for (int k = q; k < r; k++) weight[k] *= 1.0 - pf;
+        }
+    }
+
+    free(labels);
+    free(loop_lo);
+    free(loop_hi);
+    *insns_out = insns;
+    *weight_out = weight;
+    return n;
+}
+
+/*
+ * Call graph. Call sites become edges caller -> callee (MIR_CALL or
+ * MIR_INLINE to a func item). Tarjan's algorithm splits the graph into
+ * SCCs, emitted callees-first.
+ */
+typedef struct {
+    int        callee;   /* Dense func_cache_t ID */
+    int        index;    /* Call-site ordinal in the caller */
+    MIR_insn_t insn;
+} cg_edge_t;
+
+typedef struct {
+    cg_edge_t *edges;    /* Grouped by caller, in insn order */
+    int       *first;    /* Edges of f: [first[f], first[f + 1]) */
+    int       *scc;      /* SCC ID per function */
+    int       *order;    /* Functions, callees before callers */
+    int        nfuncs;
+} call_graph_t;
+
+static void call_graph_free(call_graph_t *cg) {
+    free(cg->edges);
+    free(cg->first);
+    free(cg->scc);
+    free(cg->order);
+    memset(cg, 0, sizeof(*cg));
+}
+
+/* Iterative Tarjan; fills cg->scc and cg->order. Returns 0 on success. */
+static int call_graph_scc(call_graph_t *cg) {
+    int n = cg->nfuncs, next_index = 0, nscc = 0, sp = 0, cs = 0, norder = 0;
+    size_t sz = (n > 0 ? (size_t)n : 1) * sizeof(int);
+    int *index = malloc(sz), *low = malloc(sz), *stack = malloc(sz);
+    int *call_f = malloc(sz), *call_e = malloc(sz);
+    unsigned char *on_stack = calloc(n > 0 ? (size_t)n : 1, 1);
+    if (index == NULL || low == NULL || stack == NULL || call_f == NULL ||
+        call_e == NULL || on_stack == NULL) {
+        free(index); free(low); free(stack); free(call_f); free(call_e); free(on_stack);
+        return -1;
+    }
+    for (int f = 0; f < n; f++) index[f] = -1;
+
+    for (int root = 0; root < n; root++) {
+        if (index[root] >= 0) continue;
+        call_f[cs] = root;
+        call_e[cs++] = cg->first[root];
+        index[root] = low[root] = next_index++;
+        stack[sp++] = root;
+        on_stack[root] = 1;
+
+        while (cs > 0) {
+            int f = call_f[cs - 1];
+            if (call_e[cs - 1] < cg->first[f + 1]) {
+                int w = cg->edges[call_e[cs - 1]++].callee;
+                if (index[w] < 0) {
+                    index[w] = low[w] = next_index++;
+                    stack[sp++] = w;
+                    on_stack[w] = 1;
+                    call_f[cs] = w;
+                    call_e[cs++] = cg->first[w];
+                } else if (on_stack[w] && index[w] < low[f]) {
+                    low[f] = index[w];
+                }
+                continue;
+            }
+            if (low[f] == index[f]) {
+                int w;
+                do {
+                    w = stack[--sp];
+                    on_stack[w] = 0;
+                    cg->scc[w] = nscc;
+                    cg->order[norder++] = w;  /* SCCs complete callees-first */
+                } while (w != f);
+                nscc++;
+            }
+            cs--;
+            if (cs > 0 && low[f] < low[call_f[cs - 1]]) low[call_f[cs - 1]] = low[f];
+        }
+    }
+
+    free(index); free(low); free(stack); free(call_f); free(call_e); free(on_stack);
+    return 0;
+}
+
+static int call_graph_build(const func_cache_t *fc, call_graph_t *cg) {
+    memset(cg, 0, sizeof(*cg));
+    int n = fc->count, nedges = 0;
+    for (int f = 0; f < n; f++)
+        for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, fc->funcs[f].item->u.func->insns);
+             insn != NULL; insn = DLIST_NEXT(MIR_insn_t, insn))
+            if (insn->code == MIR_CALL || insn->code == MIR_INLINE) nedges++;
+
+    cg->nfuncs = n;
+    cg->edges = malloc((nedges > 0 ? (size_t)nedges : 1) * sizeof(*cg->edges));
+    cg->first = malloc(((size_t)n + 1) * sizeof(int));
+    cg->scc = malloc((n > 0 ? (size_t)n : 1) * sizeof(int));
+    cg->order = malloc((n > 0 ? (size_t)n : 1) * sizeof(int));
+    if (cg->edges == NULL || cg->first == NULL || cg->scc == NULL || cg->order == NULL) {
+        call_graph_free(cg);
+        return -1;
+    }
+
+    int e = 0;
+    for (int f = 0; f < n; f++) {
+        cg->first[f] = e;
+        int k = -1;
+        for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, fc->funcs[f].item->u.func->insns);
+             insn != NULL; insn = DLIST_NEXT(MIR_insn_t, insn)) {
+            if (insn->code != MIR_CALL && insn->code != MIR_INLINE) continue;
+            k++;
+            MIR_item_t callee_item = insn->ops[1].u.ref;
+            if (callee_item == NULL) continue;
+            const func_info_t *fi = func_cache_get(fc, callee_item);
+            if (fi == NULL) continue;
+            cg->edges[e].callee = (int)(fi - fc->funcs);
+            cg->edges[e].index = k;
+            cg->edges[e++].insn = insn;
+        }
+    }
+    cg->first[n] = e;
+
+    if (call_graph_scc(cg) != 0) {
+        call_graph_free(cg);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * profile_module: Static profiling pass (fallback when the telemetry run
+ * fails, and for modules compiled before any profile exists).
+ *
+ * Call-site weights from estimate_insn_weights() are propagated down the
+ * call graph: freq(f) = [f has no callers] + sum over sites s in g calling
+ * f of weight(s) * freq(g). One pass over the SCCs in topological order
+ * (callers first) is exact for an acyclic graph. Inside an SCC, the
+ * recursive sites are applied once from the frequencies entering it, not
+ * iterated to a fixed point, so recursion cannot grow freq geometrically.
+ * Weights and frequencies are clamped to STATIC_FREQ_MAX in double before
+ * any integer conversion. Every called function is then credited
+ * freq * STATIC_FREQ_SCALE, every site weight(s) * freq(caller) *
+ * STATIC_FREQ_SCALE, and the map is normalized.
+ *
+ * Anchored to dossier Section 2.5:
+ *   insn->ops[1].u.ref gives the callee item for call instructions.
+ *   (ops[0] is the proto, ops[1] is the callee ref)
+ */
+typedef struct {
+    int    caller;
+    int    callee;
+    int    index;   /* Call-site ordinal in the caller */
+    double weight;
+} static_site_t;
+
+/* Also maps NaN to the clamp, so llround() is always defined */
+static double static_freq_clamp(double x) {
+    return x < STATIC_FREQ_MAX ? x : STATIC_FREQ_MAX;
+}
+
+static void profile_module(MIR_context_t ctx, MIR_module_t m, profile_map_t *map) {
+    func_cache_t fc;
+    if (func_cache_build(ctx, m, &fc) != 0) return;
+
+    static_site_t *sites = NULL;
+    int nsites = 0, cap = 0;
+    unsigned char *called = calloc(fc.count > 0 ? (size_t)fc.count : 1, 1);
+
+    for (int f = 0; f < fc.count && called != NULL; f++) {
+        MIR_insn_t *insns;
+        double *weight;
+        int n = estimate_insn_weights(fc.funcs[f].item->u.func, &insns, &weight);
+        if (n < 0) continue;
+        int k = -1;
+        for (int p = 0; p < n; p++) {
+            if (insns[p]->code != MIR_CALL && insns[p]->code != MIR_INLINE) continue;
+            k++;
+            MIR_item_t callee_item = insns[p]->ops[1].u.ref;
+            if (callee_item == NULL) continue;
+            const func_info_t *fi = func_cache_get(&fc, callee_item);
+            if (fi == NULL) continue;
+            if (nsites == cap) {
+                cap = cap ? cap * 2 : 64;
+                static_site_t *grown = realloc(sites, (size_t)cap * sizeof(*sites));
+                if (grown == NULL) break;
+                sites = grown;
+            }
+            sites[nsites].caller = f;
+            sites[nsites].callee = (int)(fi - fc.funcs);
+            sites[nsites].index = k;
+            sites[nsites++].weight = weight[p];
+            called[fi - fc.funcs] = 1;
+        }
+        free(insns);
+        free(weight);
+    }
+
+    double *freq = calloc(fc.count > 0 ? (size_t)fc.count : 1, sizeof(double));
+    double *recur = calloc(fc.count > 0 ? (size_t)fc.count : 1, sizeof(double));
+    int *site_first = malloc(((size_t)fc.count + 1) * sizeof(int));
+    call_graph_t cg;
+    if (called != NULL && freq != NULL && recur != NULL && site_first != NULL &&
+        call_graph_build(&fc, &cg) == 0) {
+        /* sites[] is grouped by caller in ID order */
+        for (int f = 0, k = 0; f <= fc.count; f++) {
+            while (k < nsites && sites[k].caller < f) k++;
+            site_first[f] = k;
+        }
+        for (int f = 0; f < fc.count; f++) freq[f] = called[f] ? 0.0 : 1.0;
+
+        /* cg.order is callees-first with each SCC contiguous; walk it backwards */
+        for (int hi = fc.count - 1, lo; hi >= 0; hi = lo) {
+            int id = cg.scc[cg.order[hi]];
+            for (lo = hi; lo >= 0 && cg.scc[cg.order[lo]] == id; lo--) continue;
+            for (int i = lo + 1; i <= hi; i++)
+                for (int k = site_first[cg.order[i]]; k < site_first[cg.order[i] + 1]; k++)
+                    if (cg.scc[sites[k].callee] == id)
+                        recur[sites[k].callee] += static_freq_clamp(sites[k].weight)
+                                                * freq[sites[k].caller];
+            for (int i = lo + 1; i <= hi; i++)
+                freq[cg.order[i]] = static_freq_clamp(freq[cg.order[i]] + recur[cg.order[i]]);
+            for (int i = lo + 1; i <= hi; i++)
+                for (int k = site_first[cg.order[i]]; k < site_first[cg.order[i] + 1]; k++)
+                    if (cg.scc[sites[k].callee] != id)
+                        freq[sites[k].callee] = static_freq_clamp(
+                            freq[sites[k].callee]
+                            + static_freq_clamp(sites[k].weight) * freq[sites[k].caller]);
+        }
+        call_graph_free(&cg);
+
+        for (int f = 0; f < fc.count; f++)
+            if (called[f])
+                profile_map_add(map, fc.funcs[f].name,
+                                (uint64_t)llround(freq[f] * STATIC_FREQ_SCALE));
+        for (int k = 0; k < nsites; k++)
+            profile_map_add_site(map, fc.funcs[sites[k].caller].name, sites[k].index,
+                                 fc.funcs[sites[k].callee].name,
+                                 (uint64_t)llround(static_freq_clamp(
+                                     static_freq_clamp(sites[k].weight) * freq[sites[k].caller])
+                                     * STATIC_FREQ_SCALE));
+    }
+
+    free(freq);
+    free(recur);
+    free(site_first);
+    free(called);
+    free(sites);
+    func_cache_free(&fc);
+    profile_map_normalize(map);
+}
+
+/*
+ * instrument_module: Insert an entry counter at the head of every function.
+ *
+ * Function k (in item order) gets counters[k], and its first instructions
+ * become:
+ *     mov  prof_a, <&counters[k]>
+ *     mov  prof_t, i64:0(prof_a)
+ *     add  prof_t, prof_t, 1
+ *     mov  i64:0(prof_a), prof_t
+ * The counter address is an immediate, so the probe needs no import item.
+ * If MIR_link() later inlines a callee, its probe travels with the body and
+ * still credits the callee.
+ *
+ * `counters` is one profile shard; `names` (may be NULL) receives the name
+ * of each dense ID.
+ *
+ * Call between MIR_load_module() and MIR_link(), same as mutate_module().
+ * Returns the number of functions instrumented (at most max_funcs).
+ */
+static int instrument_module(MIR_context_t ctx, MIR_module_t m,
+                             _Atomic uint64_t *counters, const char **names,
+                             int max_funcs) {
+    int nfuncs = 0;
+    for (MIR_item_t item = workload_first_item(m);
+         item != NULL && nfuncs < max_funcs;
+         item = workload_next_item(m, item)) {
+
+        if (item->item_type != MIR_func_item) continue;
+        MIR_func_t func = item->u.func;
+
+        MIR_reg_t a = MIR_new_func_reg(ctx, func, MIR_T_I64, "num_prof_a");
+        MIR_reg_t t = MIR_new_func_reg(ctx, func, MIR_T_I64, "num_prof_t");
+        MIR_op_t a_op = MIR_new_reg_op(ctx, a);
+        MIR_op_t t_op = MIR_new_reg_op(ctx, t);
+        MIR_op_t cnt_op = MIR_new_mem_op(ctx, MIR_T_I64, 0, a, 0, 1);
+
+        /* Prepend in reverse so the probe runs in program order */
+        MIR_prepend_insn(ctx, item, MIR_new_insn(ctx, MIR_MOV, cnt_op, t_op));
+        MIR_prepend_insn(ctx, item, MIR_new_insn(ctx, MIR_ADD, t_op, t_op,
+                                                 MIR_new_int_op(ctx, 1)));
+        MIR_prepend_insn(ctx, item, MIR_new_insn(ctx, MIR_MOV, t_op, cnt_op));
+        MIR_prepend_insn(ctx, item, MIR_new_insn(ctx, MIR_MOV, a_op,
+            MIR_new_int_op(ctx, (int64_t)(intptr_t)&counters[nfuncs])));
+
+        if (names != NULL) names[nfuncs] = func->name;
+        nfuncs++;
+    }
+    return nfuncs;
+}
+
+/*
+ * call_site_ids: Walk the call sites of `m` in dense site order (item
+ * order, then insn order; every MIR_CALL/MIR_INLINE counts). If `callers`
+ * etc. are not NULL they receive each site's key; a non-function callee
+ * gets callee NULL. Returns the number of sites.
+ */
+static int call_site_ids(MIR_module_t m, const char **callers, int *index,
+                         const char **callees) {
+    int n = 0;
+    for (MIR_item_t item = workload_first_item(m); item != NULL;
+         item = workload_next_item(m, item)) {
+        if (item->item_type != MIR_func_item) continue;
+        int k = 0;
+        for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, item->u.func->insns); insn != NULL;
+             insn = DLIST_NEXT(MIR_insn_t, insn)) {
+            if (insn->code != MIR_CALL && insn->code != MIR_INLINE) continue;
+            if (callers != NULL) {
+                MIR_item_t callee = insn->ops[1].u.ref;
+                callers[n] = item->u.func->name;
+                index[n] = k;
+                callees[n] = callee == NULL ? NULL
+                             : callee->item_type == MIR_func_item ? callee->u.func->name
+                             : callee->item_type == MIR_import_item ? callee->u.import_id
+                             : NULL;
+            }
+            k++;
+            n++;
+        }
+    }
+    return n;
+}
+
+/*
+ * instrument_call_sites: Put the same counter probe in front of every call
+ * site; site k counts into counters[k]. Run after instrument_module(),
+ * whose prof_a/prof_t registers it reuses. Returns the sites probed.
+ */
+static int instrument_call_sites(MIR_context_t ctx, MIR_module_t m,
+                                 _Atomic uint64_t *counters, int max_sites) {
+    int n = 0;
+    for (MIR_item_t item = workload_first_item(m); item != NULL;
+         item = workload_next_item(m, item)) {
+        if (item->item_type != MIR_func_item) continue;
+        MIR_func_t func = item->u.func;
+        MIR_reg_t a = MIR_reg(ctx, "num_prof_a", func);
+        MIR_reg_t t = MIR_reg(ctx, "num_prof_t", func);
+        MIR_op_t a_op = MIR_new_reg_op(ctx, a);
+        MIR_op_t t_op = MIR_new_reg_op(ctx, t);
+        MIR_op_t cnt_op = MIR_new_mem_op(ctx, MIR_T_I64, 0, a, 0, 1);
+
+        for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, func->insns);
+             insn != NULL && n < max_sites;
+             insn = DLIST_NEXT(MIR_insn_t, insn)) {
+            if (insn->code != MIR_CALL && insn->code != MIR_INLINE) continue;
+            MIR_insert_insn_before(ctx, item, insn, MIR_new_insn(ctx, MIR_MOV, a_op,
+                MIR_new_int_op(ctx, (int64_t)(intptr_t)&counters[n])));
+            MIR_insert_insn_before(ctx, item, insn, MIR_new_insn(ctx, MIR_MOV, t_op, cnt_op));
+            MIR_insert_insn_before(ctx, item, insn, MIR_new_insn(ctx, MIR_ADD, t_op, t_op,
+                                                                 MIR_new_int_op(ctx, 1)));
+            MIR_insert_insn_before(ctx, item, insn, MIR_new_insn(ctx, MIR_MOV, cnt_op, t_op));
+            n++;
+        }
+    }
+    return n;
+}
+
+/* Adds a fresh, unloaded copy of the workload to ctx and returns it. */
+typedef MIR_module_t (*module_source_fn)(MIR_context_t ctx);
+
+/*
+ * Telemetry worker: one thread, one private MIR context, one shard.
+ * MIR contexts are not shared between threads, so each worker loads and
+ * instruments its own copy; dense IDs agree because item order does.
+ */
+typedef struct {
+    module_source_fn  source;
+    const char       *entry;
+    int64_t           n;
+    _Atomic uint64_t *counters;  /* This worker's shard: functions, then sites */
+    int               nfuncs;
+    int               nsites;
+    int               status;    /* 0 = ran, -1 = entry missing */
+} profile_worker_t;
+
+static void *profile_worker_run(void *arg) {
+    profile_worker_t *w = arg;
+    MIR_context_t ctx = MIR_init();
+    MIR_module_t m = w->source(ctx);
+    workload_load(ctx, m);
+
+    MIR_item_t entry_item = find_func_item(m, w->entry);
+    if (entry_item == NULL) {
+        w->status = -1;
+        MIR_finish(ctx);
+        return NULL;
+    }
+    instrument_module(ctx, m, w->counters, NULL, w->nfuncs);
+    instrument_call_sites(ctx, m, w->counters + w->nfuncs, w->nsites);
+    MIR_link(ctx, MIR_set_interp_interface, NULL);
+
+    MIR_val_t arg_val, res;
+    arg_val.i = w->n;
+    MIR_interp_arr(ctx, entry_item, &res, 1, &arg_val);
+
+    w->status = 0;
+    MIR_finish(ctx);
+    return NULL;
+}
+
+/*
+ * profile_module_runtime: Measured telemetry pass (Phase 1).
+ *
+ * Runs entry(n) under the MIR interpreter on `nthreads` workers, each with
+ * an instrumented private copy of the module from `source` counting into
+ * its own shard. The input is split: worker k runs entry(n_k) with the n_k
+ * summing to n (at most n workers), so the merged counts match a
+ * single-threaded entry(n) for a driver whose work is linear in n. A
+ * worker whose thread cannot be started runs on the master afterwards.
+ * The master then merges the shards: every function except `entry` itself
+ * is credited with its total measured entry count, every call site with
+ * its execution count, and the map is normalized.
+ *
+ * Returns 0 on success, -1 if the entry function is missing or a worker
+ * failed (in which case the map is left untouched and the caller should
+ * fall back to profile_module()).
+ */
+static int profile_module_runtime(module_source_fn source, const char *entry,
+                                  int64_t n, int nthreads, profile_map_t *map) {
+    if (n > 0 && nthreads > n) nthreads = (int)n;
+
+    /* Master copy: fixes the dense ID -> name table used by the merge */
+    MIR_context_t ctx = MIR_init();
+    MIR_module_t m = source(ctx);
+
+    int nfuncs = 0;
+    for (MIR_item_t item = workload_first_item(m);
+         item != NULL;
+         item = workload_next_item(m, item)) {
+        if (item->item_type == MIR_func_item) nfuncs++;
+    }
+    if (find_func_item(m, entry) == NULL || nfuncs == 0 || nthreads < 1) {
+        MIR_finish(ctx);
+        return -1;
+    }
+
+    int nsites = call_site_ids(m, NULL, NULL, NULL);
+    const char **names = calloc((size_t)nfuncs, sizeof(const char *));
+    const char **site_callers = calloc((size_t)nsites + 1, sizeof(const char *));
+    const char **site_callees = calloc((size_t)nsites + 1, sizeof(const char *));
+    int *site_index = calloc((size_t)nsites + 1, sizeof(int));
+    int id = 0;
+    for (MIR_item_t item = workload_first_item(m);
+         item != NULL;
+         item = workload_next_item(m, item)) {
+        if (item->item_type == MIR_func_item) names[id++] = item->u.func->name;
+    }
+
+    profile_shards_t shards;
+    profile_worker_t *workers = calloc((size_t)nthreads, sizeof(*workers));
+    pthread_t *threads = calloc((size_t)nthreads, sizeof(*threads));
+    if (names == NULL || workers == NULL || threads == NULL || site_callers == NULL ||
+        site_callees == NULL || site_index == NULL ||
+        profile_shards_init(&shards, nthreads, nfuncs + nsites) != 0) {
+        free(names); free(workers); free(threads);
+        free(site_callers); free(site_callees); free(site_index);
+        MIR_finish(ctx);
+        return -1;
+    }
+    call_site_ids(m, site_callers, site_index, site_callees);
+
+    for (int k = 0; k < nthreads; k++) {
+        workers[k].source = source;
+        workers[k].entry = entry;
+        workers[k].n = n / nthreads + (k < n % nthreads);
+        workers[k].counters = profile_shard(&shards, k);
+        workers[k].nfuncs = nfuncs;
+        workers[k].nsites = nsites;
+        workers[k].status = -1;
+    }
+    int started = 0;
+    if (nthreads > 1) {
+        for (int k = 0; k < nthreads; k++) {
+            if (pthread_create(&threads[k], NULL, profile_worker_run, &workers[k]) != 0) break;
+            started++;
+        }
+    }
+    for (int k = started; k < nthreads; k++) profile_worker_run(&workers[k]);
+    for (int k = 0; k < started; k++) pthread_join(threads[k], NULL);
+
+    int rc = 0;
+    for (int k = 0; k < nthreads; k++)
+        if (workers[k].status != 0) rc = -1;
+    if (rc == 0) {
+        profile_shards_merge(&shards, nfuncs, names, entry, map);
+        for (int k = 0; k < nsites; k++)
+            if (site_callees[k] != NULL)
+                profile_map_add_site(map, site_callers[k], site_index[k], site_callees[k],
+                                     profile_shards_total(&shards, nfuncs + k));
+        profile_map_normalize(map);
+    }
+
+    profile_shards_free(&shards);
+    free(names);
+    free(site_callers);
+    free(site_callees);
+    free(site_index);
+    free(workers);
+    free(threads);
+    MIR_finish(ctx);
+    return rc;
+}
+
+/* ========================================================================
+ * SECTION 4: MUTATION PASS (Phase 2 - The Agent)
+ *
+ * Implements mir_num_optimize_calls(): runs between MIR_load_module()
+ * and MIR_link() to mutate MIR_CALL -> MIR_INLINE based on condition.
+ *
+ * The mutation is: insn->code = MIR_INLINE
+ * This promotes the call to use the 200-insn threshold in MIR's native
+ * process_inlines() instead of the 50-insn threshold for MIR_CALL.
+ *
+ * NOTE ON TWO-STAGE FILTER: Our mutation promotes MIR_CALL -> MIR_INLINE,
+ * then MIR's native process_inlines() in MIR_link() makes the final
+ * inlining decision at the 200-insn threshold. We are NOT bypassing
+ * MIR's native inliner; we are feeding it different instruction codes.
+ * ======================================================================== */
+
+typedef enum {
+    COND_NO_INLINE      = 0,  /* Leave all as MIR_CALL */
+    COND_BLIND_ALL      = 1,  /* Convert all MIR_CALL -> MIR_INLINE */
+    COND_RANDOM_50      = 2,  /* Random 50% conversion */
+    COND_SHADOW_PRICE   = 3,  /* NUM-predicted threshold */
+    COND_INVERTED_PRICE = 4,  /* Inverted: hot->low, cold->high */
+    COND_KNAPSACK       = 5,  /* Budgeted: global knapsack over all sites */
+    COND_COUNT          = 6
+} experiment_condition_t;
+
+static const char *condition_names[COND_COUNT] = {
+    "No inlining",
+    "Blind inline-all",
+    "Random 50%",
+    "Shadow-price (NUM)",
+    "Inverted-price (control)",
+    "Knapsack (NUM budget)"
+};
+
+/*
+ * Live metrics (--metrics PATH, --metrics-dump PATH).
+ *
+ * One fixed-layout block of counters, updated lock-free (relaxed atomic
+ * adds) from the mutation and compile paths. By default it is a static
+ * in this process. With --metrics it is a MAP_SHARED file mapping, so
+ * another process can read it at any time, and it still holds the final
+ * counts after this one exits. --metrics-dump prints a block as
+ * Prometheus text exposition, for a scraper or a node_exporter
+ * textfile collector.
+ *
+ *   promotions[c]    sites promoted by mutate_module() under condition c,
+ *                    every pass (dry-run plans included)
+ *   lambda[k]        site prices seen by the price rules (shadow,
+ *                    inverted, tier-up, knapsack), METRICS_LAMBDA_BUCKETS
+ *                    equal-width buckets over [0, 1], bucket k holding
+ *                    k/B < lambda <= (k+1)/B (k = 0 also takes lambda <= 0),
+ *                    then one overflow bucket for lambda > 1 that is only
+ *                    counted under le="+Inf"
+ *   funcs[]          per-function O2 compile time and code bytes, keyed by
+ *                    64-bit name hash with linear probing; a slot is
+ *                    claimed by CAS on its key and its name is published
+ *                    with a release store to `ready`
+ *
+ * Counters are native endian; a block is only readable on the machine
+ * that wrote it.
+ */
+#define METRICS_MAGIC    "NUMMET01"
+#define METRICS_VERSION  2
+
+static const char *condition_keys[COND_COUNT] = {
+    "none", "blind", "random", "shadow", "inverted", "knapsack"
+};
+
+typedef struct {
+    _Atomic uint64_t key;       /* Name hash | 1; 0 = free */
+    _Atomic uint32_t ready;     /* name[] is complete */
+    char             name[32];
+    _Atomic uint64_t compiles;
+    _Atomic uint64_t gen_ns;
+    _Atomic uint64_t code_bytes;  /* Latest measured compile */
+} metrics_func_t;
+
+typedef struct {
+    char             magic[8];
+    uint32_t         version;
+    uint32_t         size;       /* sizeof(num_metrics_t) */
+    int64_t          pid;
+    _Atomic uint64_t mutate_passes[COND_COUNT];
+    _Atomic uint64_t promotions[COND_COUNT];
+    _Atomic uint64_t tier_promotions;
+    _Atomic uint64_t lambda[METRICS_LAMBDA_BUCKETS + 1];  /* Last: lambda > 1 */
+    _Atomic uint64_t lambda_sum_ppm;  /* Sum of prices, x 1e6 */
+    _Atomic uint64_t links;
+    _Atomic uint64_t link_ns;
+    _Atomic uint64_t compiles;        /* Functions compiled at O2 */
+    _Atomic uint64_t gen_ns;
+    _Atomic uint64_t code_bytes;
+    _Atomic uint64_t tier_ups;        /* Tier-1 builds, synchronous or pooled */
+    _Atomic uint64_t tier_published;  /* Functions published into dispatch slots */
+    _Atomic uint64_t reopt_recompiles;
+    _Atomic uint64_t guard_reverts;
+    _Atomic uint64_t funcs_dropped;   /* Compiles with no free funcs[] slot */
+    metrics_func_t   funcs[METRICS_FUNCS];
+} num_metrics_t;
+
+static num_metrics_t metrics_local;
+static num_metrics_t *metrics = &metrics_local;
+
+static void metrics_header(num_metrics_t *mb) {
+    memcpy(mb->magic, METRICS_MAGIC, sizeof(mb->magic));
+    mb->version = METRICS_VERSION;
+    mb->size = (uint32_t)sizeof(*mb);
+#ifdef _WIN32
+    mb->pid = (int64_t)GetCurrentProcessId();
+#else
+    mb->pid = (int64_t)getpid();
+#endif
+}
+
+static void metrics_add(_Atomic uint64_t *c, uint64_t v) {
+    atomic_fetch_add_explicit(c, v, memory_order_relaxed);
+}
+
+static void metrics_lambda(double lambda) {
+    int k = METRICS_LAMBDA_BUCKETS;  /* Overflow */
+    if (!(lambda > 0.0)) {
+        k = 0;
+    } else if (lambda <= 1.0) {
+        /* Smallest k with lambda <= (k+1)/B, against the bounds the dump prints */
+        k = (int)ceil(lambda * METRICS_LAMBDA_BUCKETS) - 1;
+        if (k > 0 && lambda <= (double)k / METRICS_LAMBDA_BUCKETS) k--;
+        if (k < 0) k = 0;
+    }
+    metrics_add(&metrics->lambda[k], 1);
+    metrics_add(&metrics->lambda_sum_ppm, lambda > 0.0 ? (uint64_t)(lambda * 1e6) : 0);
+}
+
+/* funcs[] slot for `name`, claimed on first use; NULL when the table is full. */
+static metrics_func_t *metrics_func(const char *name) {
+    uint64_t key = profile_hash_name(name) | 1;
+    for (int probe = 0; probe < METRICS_FUNCS; probe++) {
+        metrics_func_t *mf = &metrics->funcs[(key + (uint64_t)probe) & (METRICS_FUNCS - 1)];
+        uint64_t cur = atomic_load_explicit(&mf->key, memory_order_acquire);
+        if (cur == 0) {
+            if (atomic_compare_exchange_strong_explicit(&mf->key, &cur, key,
+                                                        memory_order_acq_rel,
+                                                        memory_order_acquire)) {
+                snprintf(mf->name, sizeof(mf->name), "%s", name);
+                atomic_store_explicit(&mf->ready, 1, memory_order_release);
+                return mf;
+            }
+        }
+        if (cur == key) return mf;
+    }
+    metrics_add(&metrics->funcs_dropped, 1);
+    return NULL;
+}
+
+/* One O2 compile of `name`; `bytes` < 0 when its size was not measured. */
+static void metrics_compile(const char *name, double gen_sec, long bytes) {
+    uint64_t ns = (uint64_t)(gen_sec * 1e9);
+    metrics_add(&metrics->compiles, 1);
+    metrics_add(&metrics->gen_ns, ns);
+    if (bytes > 0) metrics_add(&metrics->code_bytes, (uint64_t)bytes);
+    metrics_func_t *mf = metrics_func(name);
+    if (mf == NULL) return;
+    metrics_add(&mf->compiles, 1);
+    metrics_add(&mf->gen_ns, ns);
+    if (bytes > 0) atomic_store_explicit(&mf->code_bytes, (uint64_t)bytes, memory_order_relaxed);
+}
+
+static void metrics_link(double sec) {
+    metrics_add(&metrics->links, 1);
+    metrics_add(&metrics->link_ns, (uint64_t)(sec * 1e9));
+}
+
+/*
+ * metrics_map: Map `path` as the metrics block, read-write and shared
+ * (created and zeroed when `create`) or read-only. The mapping is never
+ * unmapped: it lives as long as the process. Returns NULL on failure.
+ */
+static num_metrics_t *metrics_map(const char *path, int create) {
+    size_t len = sizeof(num_metrics_t);
+    void *base;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, create ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                              create ? CREATE_ALWAYS : OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    if (create || (GetFileSizeEx(file, &size) && size.QuadPart >= (LONGLONG)len))
+        mapping = CreateFileMappingA(file, NULL, create ? PAGE_READWRITE : PAGE_READONLY,
+                                     0, (DWORD)len, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) return NULL;
+    base = MapViewOfFile(mapping, create ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, len);
+    CloseHandle(mapping);  /* The view keeps the mapping alive */
+    if (base == NULL) return NULL;
+#else
+    int fd = create ? open(path, O_RDWR | O_CREAT | O_TRUNC, 0644) : open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if ((create && ftruncate(fd, (off_t)len) != 0) ||
+        (!create && (fstat(fd, &st) != 0 || (size_t)st.st_size < len))) {
+        close(fd);
+        return NULL;
+    }
+    base = mmap(NULL, len, create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+#endif
+    num_metrics_t *mb = base;
+    if (create) {
+        metrics_header(mb);  /* A new file reads as zeros: every counter starts at 0 */
+    } else if (memcmp(mb->magic, METRICS_MAGIC, sizeof(mb->magic)) != 0 ||
+               mb->version != METRICS_VERSION || mb->size != len) {
+        return NULL;
+    }
+    return mb;
+}
+
+static uint64_t metrics_get(const _Atomic uint64_t *c) {
+    return atomic_load_explicit(c, memory_order_relaxed);
+}
+
+static void metrics_counter(const char *name, const char *help, uint64_t v) {
+    printf("# HELP %s %s\n# TYPE %s counter\n%s %llu\n", name, help, name, name,
+           (unsigned long long)v);
+}
+
+/* metrics_dump: Print the block at `path` as Prometheus text. Returns 0 on success. */
+static int metrics_dump(const char *path) {
+    const num_metrics_t *mb = metrics_map(path, 0);
+    if (mb == NULL) {
+        fprintf(stderr, "ERROR: '%s' is not a metrics block\n", path);
+        return -1;
+    }
+    printf("# num_experiment pid %lld\n", (long long)mb->pid);
+
+    printf("# HELP num_promotions_total Call sites promoted to MIR_INLINE, all mutation passes\n");
+    printf("# TYPE num_promotions_total counter\n");
+    for (int c = 0; c < COND_COUNT; c++)
+        printf("num_promotions_total{condition=\"%s\"} %llu\n", condition_keys[c],
+               (unsigned long long)metrics_get(&mb->promotions[c]));
+    printf("num_promotions_total{condition=\"tier\"} %llu\n",
+           (unsigned long long)metrics_get(&mb->tier_promotions));
+    printf("# HELP num_mutation_passes_total mutate_module() calls\n");
+    printf("# TYPE num_mutation_passes_total counter\n");
+    for (int c = 0; c < COND_COUNT; c++)
+        printf("num_mutation_passes_total{condition=\"%s\"} %llu\n", condition_keys[c],
+               (unsigned long long)metrics_get(&mb->mutate_passes[c]));
+
+    printf("# HELP num_site_lambda Shadow prices of call sites decided by a price rule\n");
+    printf("# TYPE num_site_lambda histogram\n");
+    uint64_t cum = 0;
+    for (int k = 0; k < METRICS_LAMBDA_BUCKETS; k++) {
+        cum += metrics_get(&mb->lambda[k]);
+        printf("num_site_lambda_bucket{le=\"%g\"} %llu\n",
+               (double)(k + 1) / METRICS_LAMBDA_BUCKETS, (unsigned long long)cum);
+    }
+    cum += metrics_get(&mb->lambda[METRICS_LAMBDA_BUCKETS]);
+    printf("num_site_lambda_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)cum);
+    printf("num_site_lambda_sum %.6f\n", metrics_get(&mb->lambda_sum_ppm) / 1e6);
+    printf("num_site_lambda_count %llu\n", (unsigned long long)cum);
+
+    metrics_counter("num_links_total", "MIR_link() calls timed", metrics_get(&mb->links));
+    printf("# HELP num_link_seconds_total Time in MIR_link()\n"
+           "# TYPE num_link_seconds_total counter\nnum_link_seconds_total %.9f\n",
+           metrics_get(&mb->link_ns) / 1e9);
+    metrics_counter("num_compiles_total", "Functions compiled at O2", metrics_get(&mb->compiles));
+    printf("# HELP num_compile_seconds_total Time in MIR_gen() at O2\n"
+           "# TYPE num_compile_seconds_total counter\nnum_compile_seconds_total %.9f\n",
+           metrics_get(&mb->gen_ns) / 1e9);
+    metrics_counter("num_code_bytes_total", "Machine code bytes of measured compiles",
+                    metrics_get(&mb->code_bytes));
+    metrics_counter("num_tier_ups_total", "Tier-1 builds", metrics_get(&mb->tier_ups));
+    metrics_counter("num_tier_published_total", "Functions published into dispatch slots",
+                    metrics_get(&mb->tier_published));
+    metrics_counter("num_reopt_recompiles_total", "Stale functions recompiled by --reopt",
+                    metrics_get(&mb->reopt_recompiles));
+    metrics_counter("num_guard_reverts_total", "Promotions reverted by --guard",
+                    metrics_get(&mb->guard_reverts));
+    metrics_counter("num_metrics_funcs_dropped_total", "Compiles with no per-function slot",
+                    metrics_get(&mb->funcs_dropped));
+
+    printf("# HELP num_function_compile_seconds_total Time in MIR_gen() at O2, per function\n");
+    printf("# TYPE num_function_compile_seconds_total counter\n");
+    for (int i = 0; i < METRICS_FUNCS; i++)
+        if (atomic_load_explicit(&mb->funcs[i].ready, memory_order_acquire))
+            printf("num_function_compile_seconds_total{function=\"%s\"} %.9f\n",
+                   mb->funcs[i].name, metrics_get(&mb->funcs[i].gen_ns) / 1e9);
+    printf("# HELP num_function_compiles_total O2 compiles, per function\n");
+    printf("# TYPE num_function_compiles_total counter\n");
+    for (int i = 0; i < METRICS_FUNCS; i++)
+        if (atomic_load_explicit(&mb->funcs[i].ready, memory_order_acquire))
+            printf("num_function_compiles_total{function=\"%s\"} %llu\n", mb->funcs[i].name,
+                   (unsigned long long)metrics_get(&mb->funcs[i].compiles));
+    printf("# HELP num_function_code_bytes Machine code bytes, latest measured compile\n");
+    printf("# TYPE num_function_code_bytes gauge\n");
+    for (int i = 0; i < METRICS_FUNCS; i++)
+        if (atomic_load_explicit(&mb->funcs[i].ready, memory_order_acquire) &&
+            metrics_get(&mb->funcs[i].code_bytes) > 0)
+            printf("num_function_code_bytes{function=\"%s\"} %llu\n", mb->funcs[i].name,
+                   (unsigned long long)metrics_get(&mb->funcs[i].code_bytes));
+    return 0;
+}
+
+/*
+ * compute_adjusted_threshold: The NUM shadow-price formula.
+ * From dossier Section 4.3 (one free parameter, simple linear scaling).
+ *
+ * For COND_SHADOW_PRICE:
+ *   scale = clamp(lambda, 0.1, 5.0)
+ *   T_adj = clamp(50 * scale, 5, 200)
+ *
+ * The constants (0.1, 5.0, 5, 50) are num_params, which is per thread so
+ * that --sweep workers can each evaluate their own grid point.
+ *
+ * For COND_INVERTED_PRICE:
+ *   lambda_inv = 1.0 - lambda  (hot becomes cold, cold becomes hot)
+ *   Then same formula.
+ */
+typedef struct {
+    double scale_floor;     /* SCALE_FLOOR */
+    double scale_ceil;      /* SCALE_CEIL */
+    int    threshold_floor; /* THRESHOLD_FLOOR */
+    int    call_threshold;  /* MIR_CALL_INLINE_THRESHOLD, the formula's base */
+} num_params_t;
+
+#define NUM_PARAMS_DEFAULT {SCALE_FLOOR, SCALE_CEIL, THRESHOLD_FLOOR, MIR_CALL_INLINE_THRESHOLD}
+
+static _Thread_local num_params_t num_params = NUM_PARAMS_DEFAULT;
+
+static int compute_adjusted_threshold(double shadow_price, int inverted) {
+    const num_params_t *np = &num_params;
+    double lambda = shadow_price;
+    if (inverted) {
+        /* Invert: hottest (lambda=1.0) -> coldest (0.0), and vice versa */
+        lambda = 1.0 - lambda;
+    }
+
+    /* Scale factor: lambda is already [0,1], scale to [0.1, 5.0] range */
+    /* Map [0,1] -> [scale_floor, scale_ceil] linearly */
+    double scale_factor = np->scale_floor + lambda * (np->scale_ceil - np->scale_floor);
+    if (scale_factor < np->scale_floor) scale_factor = np->scale_floor;
+    if (scale_factor > np->scale_ceil)  scale_factor = np->scale_ceil;
+
+    int adjusted = (int)(np->call_threshold * scale_factor);
+    if (adjusted < np->threshold_floor)  adjusted = np->threshold_floor;
+    if (adjusted > MIR_INLINE_THRESHOLD) adjusted = MIR_INLINE_THRESHOLD;
+
+    return adjusted;
+}
+
+/*
+ * Post-inline DCE benefit model.
+ *
+ * Inlining a call copies the callee's parameters into the caller. An
+ * argument that is an integer constant (an MIR_OP_INT operand) becomes a
+ * constant in the inlined body, so every branch testing that parameter
+ * folds and the side it never takes is deleted. An inlined callee that
+ * collapses this way costs only its live insns and saves more than the call.
+ *
+ * estimate_inline_benefit() folds the callee's branches on constant,
+ * never-reassigned parameters (registers resolved by name in
+ * func_info_t.arg_regs) and counts the insns unreachable from entry once
+ * they are folded. Bodies with indirect jumps are not analysed.
+ */
+typedef struct {
+    int dead;    /* Callee insns that DCE removes after inlining here */
+    int folded;  /* Conditional branches that become unconditional */
+} inline_benefit_t;
+
+/* Parameter number of register operand `op` of `callee`, or -1. */
+static int arg_operand(const MIR_op_t *op, const func_info_t *callee) {
+    if (op->mode != MIR_OP_REG) return -1;
+    for (uint32_t k = 0; k < callee->item->u.func->nargs; k++)
+        if (callee->arg_regs[k] == op->u.reg) return (int)k;
+    return -1;
+}
+
+/* Value of `op` if it is an int or a known-constant parameter register. */
+static int const_operand(const MIR_op_t *op, const int64_t *val,
+                         const unsigned char *known, const func_info_t *callee,
+                         int64_t *out) {
+    if (op->mode == MIR_OP_INT) {
+        *out = op->u.i;
+        return 1;
+    }
+    int k = arg_operand(op, callee);
+    if (k >= 0 && known[k]) {
+        *out = val[k];
+        return 1;
+    }
+    return 0;
+}
+
+/* 1 = taken, 0 = falls through, -1 = not a foldable conditional branch. */
+static int fold_branch(MIR_insn_t br, const int64_t *val,
+                       const unsigned char *known, const func_info_t *callee) {
+    int64_t a, b = 0;
+    MIR_insn_code_t code = br->code;
+    if (br->nops < 2 || !const_operand(&br->ops[1], val, known, callee, &a)) return -1;
+    if (code != MIR_BT && code != MIR_BF && code != MIR_BTS && code != MIR_BFS &&
+        (br->nops < 3 || !const_operand(&br->ops[2], val, known, callee, &b))) return -1;
+
+    /* 32-bit (S) forms; listed, since mir.h interleaves them with the 64-bit ones */
+    int s = 0;
+    switch (code) {
+    case MIR_BTS:  case MIR_BFS:   case MIR_BEQS:  case MIR_BNES:
+    case MIR_BLTS: case MIR_BLES:  case MIR_BGTS:  case MIR_BGES:
+    case MIR_UBLTS: case MIR_UBLES: case MIR_UBGTS: case MIR_UBGES:
+        s = 1;
+        break;
+    default:
+        break;
+    }
+    uint64_t ua = s ? (uint32_t)a : (uint64_t)a, ub = s ? (uint32_t)b : (uint64_t)b;
+    if (s) {
+        a = (int32_t)a;
+        b = (int32_t)b;
+    }
+    switch (code) {
+    case MIR_BT:   case MIR_BTS:   return a != 0;
+    case MIR_BF:   case MIR_BFS:   return a == 0;
+    case MIR_BEQ:  case MIR_BEQS:  return a == b;
+    case MIR_BNE:  case MIR_BNES:  return a != b;
+    case MIR_BLT:  case MIR_BLTS:  return a < b;
+    case MIR_BLE:  case MIR_BLES:  return a <= b;
+    case MIR_BGT:  case MIR_BGTS:  return a > b;
+    case MIR_BGE:  case MIR_BGES:  return a >= b;
+    case MIR_UBLT: case MIR_UBLTS: return ua < ub;
+    case MIR_UBLE: case MIR_UBLES: return ua <= ub;
+    case MIR_UBGT: case MIR_UBGTS: return ua > ub;
+    case MIR_UBGE: case MIR_UBGES: return ua >= ub;
+    default:                       return -1;
+    }
+}
+
+/* Output operands of `insn` are ops[*lo, *hi). */
+static void insn_outputs(MIR_insn_t insn, size_t *lo, size_t *hi) {
+    *lo = *hi = 0;
+    if (insn->code == MIR_CALL || insn->code == MIR_INLINE || insn->code == MIR_JCALL) {
+        MIR_item_t p = insn->ops[0].u.ref;
+        *lo = 2;
+        *hi = p != NULL && p->item_type == MIR_proto_item ? 2 + p->u.proto->nres : 2;
+    } else if (insn->code != MIR_LABEL && insn->code != MIR_RET &&
+               insn->code != MIR_JRET && insn->code != MIR_SWITCH &&
+               !MIR_branch_code_p(insn->code)) {
+        *hi = insn->nops > 0 ? 1 : 0;
+    }
+}
+
+/* Benefit of inlining `callee` at the MIR_CALL/MIR_INLINE insn `call`. */
+static void estimate_inline_benefit(MIR_insn_t call, const func_info_t *callee,
+                                    inline_benefit_t *out) {
+    out->dead = out->folded = 0;
+    MIR_func_t func = callee->item->u.func;
+    uint32_t nargs = func->nargs;
+    MIR_item_t proto = call->ops[0].u.ref;
+    if (nargs == 0 || proto == NULL || proto->item_type != MIR_proto_item) return;
+    size_t first_arg = 2 + proto->u.proto->nres;
+
+    int64_t *val = malloc(nargs * sizeof(*val));
+    unsigned char *known = calloc(nargs, 1);
+    if (val == NULL || known == NULL) {
+        free(val); free(known);
+        return;
+    }
+    int nconst = 0;
+    for (uint32_t k = 0; k < nargs && first_arg + k < call->nops; k++) {
+        if (call->ops[first_arg + k].mode != MIR_OP_INT) continue;
+        val[k] = call->ops[first_arg + k].u.i;
+        known[k] = 1;
+        nconst++;
+    }
+
+    int n = 0, nlabels = 0, indirect = 0;
+    for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, func->insns); nconst > 0 && insn != NULL;
+         insn = DLIST_NEXT(MIR_insn_t, insn)) {
+        n++;
+        if (insn->code == MIR_LABEL) nlabels++;
+        if (insn->code == MIR_JMPI || insn->code == MIR_LADDR) indirect = 1;
+
+        /* A parameter reassigned in the body is no longer the argument */
+        size_t lo, hi;
+        insn_outputs(insn, &lo, &hi);
+        for (size_t o = lo; o < hi && o < insn->nops; o++) {
+            int k = arg_operand(&insn->ops[o], callee);
+            if (k >= 0 && known[k]) {
+                known[k] = 0;
+                nconst--;
+            }
+        }
+    }
+    if (nconst <= 0 || indirect) {
+        free(val); free(known);
+        return;
+    }
+
+    MIR_insn_t *insns = malloc((size_t)n * sizeof(*insns));
+    label_pos_t *labels = malloc((nlabels > 0 ? (size_t)nlabels : 1) * sizeof(*labels));
+    int *stack = malloc((size_t)n * sizeof(int));
+    unsigned char *reached = calloc((size_t)n, 1);
+    if (insns == NULL || labels == NULL || stack == NULL || reached == NULL) {
+        free(val); free(known); free(insns); free(labels); free(stack); free(reached);
+        return;
+    }
+    int i = 0, l = 0;
+    for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, func->insns); insn != NULL;
+         insn = DLIST_NEXT(MIR_insn_t, insn), i++) {
+        insns[i] = insn;
+        if (insn->code == MIR_LABEL) {
+            labels[l].label = insn;
+            labels[l++].pos = i;
+        }
+    }
+    qsort(labels, (size_t)nlabels, sizeof(*labels), label_pos_cmp);
+
+    /* Reachability from entry with the constant branches folded */
+    int sp = 0, live = 0;
+    stack[sp++] = 0;
+    reached[0] = 1;
+    while (sp > 0) {
+        int p = stack[--sp];
+        MIR_insn_t insn = insns[p];
+        int succ[2], nsucc = 0;
+        live++;
+
+        if (insn->code == MIR_SWITCH) {
+            for (size_t o = 1; o < insn->nops; o++) {
+                int q = label_pos_find(labels, nlabels, insn->ops[o].u.label);
+                if (q >= 0 && !reached[q]) {
+                    reached[q] = 1;
+                    stack[sp++] = q;
+                }
+            }
+            continue;
+        }
+        if (insn->code == MIR_RET || insn->code == MIR_JRET || insn->code == MIR_JCALL)
+            continue;
+        if (MIR_branch_code_p(insn->code) && insn->ops[0].mode == MIR_OP_LABEL) {
+            int target = label_pos_find(labels, nlabels, insn->ops[0].u.label);
+            int taken = insn->code == MIR_JMP ? 1 : fold_branch(insn, val, known, callee);
+            if (insn->code != MIR_JMP && taken >= 0) out->folded++;
+            if (taken != 0 && target >= 0) succ[nsucc++] = target;
+            if (taken != 1 && p + 1 < n) succ[nsucc++] = p + 1;
+        } else if (p + 1 < n) {
+            succ[nsucc++] = p + 1;
+        }
+        for (int s = 0; s < nsucc; s++) {
+            if (reached[succ[s]]) continue;
+            reached[succ[s]] = 1;
+            stack[sp++] = succ[s];
+        }
+    }
+    out->dead = n - live;
+
+    free(val); free(known); free(insns); free(labels); free(stack); free(reached);
+}
+
+/* Expected insns saved per executed call if this site is inlined. */
+static double site_savings(const inline_benefit_t *b) {
+    return CALL_SAVINGS_INSNS + BRANCH_FOLD_SAVINGS * b->folded;
+}
+
+/*
+ * Register-pressure model (--pressure-cost N).
+ *
+ * Inlining merges the callee's live ranges into the caller. Past the
+ * target's allocatable registers, each extra live value is a likely spill
+ * (a store plus at least one reload). This is an estimate from MIR-level
+ * liveness before register allocation, not the generator's spill count:
+ * the experiment links a stock mir-gen.c, whose allocator reports nothing.
+ * A backward dataflow over basic blocks gives the peak number of
+ * simultaneously live registers, and the excess over the allocatable set,
+ * max(0, peak - PRESSURE_REGS), stands in for spills.
+ *
+ * The planner uses it bottom-up next to the size model: at a site where
+ * `across` registers are live over the call, promoting a callee with peak
+ * pressure p_c raises the caller's peak to max(p_f, across + p_c). The
+ * marginal excess of that, times pressure_cost insns, are added to the
+ * callee size the site rule compares against its threshold. The compile
+ * path runs the same model on the post-link IR each function is handed to
+ * MIR_gen() with, so both the insn count and the excess it reports are
+ * pre-generator figures; only the machine-code size comes from MIR_gen().
+ */
+static int pressure_cost = PRESSURE_COST;  /* Insns per excess live register; 0 = off */
+
+static int pressure_excess(int live) {
+    return live > PRESSURE_REGS ? live - PRESSURE_REGS : 0;
+}
+
+/* Register operands of `op`: the register itself or a memory operand's base/index. */
+static int op_regs(const MIR_op_t *op, MIR_reg_t regs[2]) {
+    int n = 0;
+    if (op->mode == MIR_OP_REG) {
+        regs[n++] = op->u.reg;
+    } else if (op->mode == MIR_OP_MEM) {
+        if (op->u.mem.base != 0) regs[n++] = op->u.mem.base;
+        if (op->u.mem.index != 0) regs[n++] = op->u.mem.index;
+    }
+    return n;
+}
+
+static void bits_set(uint64_t *b, MIR_reg_t r) { b[r >> 6] |= 1ULL << (r & 63); }
+static void bits_clear(uint64_t *b, MIR_reg_t r) { b[r >> 6] &= ~(1ULL << (r & 63)); }
+
+static int bits_count(const uint64_t *b, int words) {
+    int n = 0;
+    for (int w = 0; w < words; w++)
+        for (uint64_t x = b[w]; x != 0; x &= x - 1) n++;
+    return n;
+}
+
+/*
+ * insn_step: Backward liveness over one insn: live = (live - defs) | uses.
+ * Returns the pressure at the insn, |live after, plus its defs|.
+ */
+static int insn_step(MIR_insn_t insn, uint64_t *live, uint64_t *scratch, int words) {
+    size_t lo, hi;
+    insn_outputs(insn, &lo, &hi);
+    MIR_reg_t regs[2];
+    memcpy(scratch, live, (size_t)words * sizeof(uint64_t));
+    for (size_t o = lo; o < hi && o < insn->nops; o++)
+        if (insn->ops[o].mode == MIR_OP_REG) bits_set(scratch, insn->ops[o].u.reg);
+    int peak = bits_count(scratch, words);
+    for (size_t o = lo; o < hi && o < insn->nops; o++)
+        if (insn->ops[o].mode == MIR_OP_REG) bits_clear(live, insn->ops[o].u.reg);
+    for (size_t o = 0; o < insn->nops; o++) {
+        int is_out = o >= lo && o < hi && insn->ops[o].mode == MIR_OP_REG;
+        if (is_out || insn->ops[o].mode == MIR_OP_LABEL) continue;
+        for (int k = op_regs(&insn->ops[o], regs); k > 0; k--) bits_set(live, regs[k - 1]);
+    }
+    return peak;
+}
+
+typedef struct {
+    MIR_insn_t       *insns;
+    int              *block;    /* Block of each insn */
+    int              *start;    /* First insn of each block; start[nblocks] = n */
+    int               nblocks;
+    const label_pos_t *labels;
+    int               nlabels;
+    const uint64_t   *live_in;  /* nblocks x words */
+    int               words;
+} liveness_t;
+
+/* live_out(b): union of live_in over b's successors. */
+static void block_live_out(const liveness_t *lv, int b, uint64_t *out) {
+    MIR_insn_t last = lv->insns[lv->start[b + 1] - 1];
+    int succ[2], nsucc = 0;
+    memset(out, 0, (size_t)lv->words * sizeof(uint64_t));
+    if (last->code == MIR_SWITCH) {
+        for (size_t o = 1; o < last->nops; o++) {
+            int q = label_pos_find(lv->labels, lv->nlabels, last->ops[o].u.label);
+            for (int w = 0; q >= 0 && w < lv->words; w++)
+                out[w] |= lv->live_in[(size_t)lv->block[q] * lv->words + w];
+        }
+        return;
+    }
+    if (last->code == MIR_RET || last->code == MIR_JRET || last->code == MIR_JCALL ||
+        last->code == MIR_JMPI)
+        return;
+    if (MIR_branch_code_p(last->code) && last->ops[0].mode == MIR_OP_LABEL) {
+        int q = label_pos_find(lv->labels, lv->nlabels, last->ops[0].u.label);
+        if (q >= 0) succ[nsucc++] = lv->block[q];
+    }
+    if (last->code != MIR_JMP && b + 1 < lv->nblocks) succ[nsucc++] = b + 1;
+    for (int k = 0; k < nsucc; k++)
+        for (int w = 0; w < lv->words; w++)
+            out[w] |= lv->live_in[(size_t)succ[k] * lv->words + w];
+}
+
+/*
+ * func_pressure: Peak live registers of `func`. For each insn in
+ * calls[0..ncalls), across[k] receives the registers live over it (live
+ * after the call, results excluded). Returns -1 on allocation failure.
+ */
+static int func_pressure(MIR_func_t func, MIR_insn_t *calls, int *across, int ncalls) {
+    int n = 0, nlabels = 0;
+    MIR_reg_t max_reg = 0;
+    for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, func->insns); insn != NULL;
+         insn = DLIST_NEXT(MIR_insn_t, insn)) {
+        n++;
+        if (insn->code == MIR_LABEL) nlabels++;
+        MIR_reg_t regs[2];
+        for (size_t o = 0; o < insn->nops; o++)
+            for (int k = op_regs(&insn->ops[o], regs); k > 0; k--)
+                if (regs[k - 1] > max_reg) max_reg = regs[k - 1];
+    }
+    for (int k = 0; k < ncalls; k++) across[k] = 0;
+    if (n == 0) return 0;
+
+    int words = (int)(max_reg >> 6) + 1;
+    MIR_insn_t *insns = malloc((size_t)n * sizeof(*insns));
+    label_pos_t *labels = malloc((nlabels > 0 ? (size_t)nlabels : 1) * sizeof(*labels));
+    int *block = malloc((size_t)n * sizeof(int));        /* Block of each insn */
+    int *start = malloc(((size_t)n + 1) * sizeof(int));  /* First insn of each block */
+    uint64_t *live_in = calloc((size_t)n * (size_t)words, sizeof(uint64_t));
+    uint64_t *live = malloc(2 * (size_t)words * sizeof(uint64_t));
+    if (insns == NULL || labels == NULL || block == NULL || start == NULL ||
+        live_in == NULL || live == NULL) {
+        free(insns); free(labels); free(block); free(start); free(live_in); free(live);
+        return -1;
+    }
+    uint64_t *scratch = live + words;
+
+    int i = 0, l = 0, nblocks = 0;
+    for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, func->insns); insn != NULL;
+         insn = DLIST_NEXT(MIR_insn_t, insn), i++) {
+        insns[i] = insn;
+        if (insn->code == MIR_LABEL) {
+            labels[l].label = insn;
+            labels[l++].pos = i;
+        }
+        int leader = i == 0 || insn->code == MIR_LABEL;
+        if (i > 0) {
+            MIR_insn_code_t prev = insns[i - 1]->code;
+            leader |= MIR_branch_code_p(prev) || prev == MIR_SWITCH || prev == MIR_RET ||
+                      prev == MIR_JRET || prev == MIR_JCALL || prev == MIR_JMPI;
+        }
+        if (leader) start[nblocks++] = i;
+        block[i] = nblocks - 1;
+    }
+    start[nblocks] = n;
+    qsort(labels, (size_t)nlabels, sizeof(*labels), label_pos_cmp);
+
+    liveness_t lv = {insns, block, start, nblocks, labels, nlabels, live_in, words};
+
+    /* Iterate live_in(b) = uses(b) | (live_out(b) - defs(b)) to a fixed point */
+    for (int changed = 1; changed;) {
+        changed = 0;
+        for (int b = nblocks - 1; b >= 0; b--) {
+            block_live_out(&lv, b, live);
+            for (int p = start[b + 1] - 1; p >= start[b]; p--)
+                insn_step(insns[p], live, scratch, words);
+            uint64_t *in = &live_in[(size_t)b * words];
+            if (memcmp(in, live, (size_t)words * sizeof(uint64_t)) != 0) {
+                memcpy(in, live, (size_t)words * sizeof(uint64_t));
+                changed = 1;
+            }
+        }
+    }
+
+    /* One more backward walk per block for the peak and live-across counts */
+    int peak = 0;
+    for (int b = 0; b < nblocks; b++) {
+        block_live_out(&lv, b, live);
+        for (int p = start[b + 1] - 1; p >= start[b]; p--) {
+            MIR_insn_t insn = insns[p];
+            int is_call = insn->code == MIR_CALL || insn->code == MIR_INLINE;
+            for (int k = 0; is_call && k < ncalls; k++) {
+                if (calls[k] != insn) continue;
+                size_t lo, hi;
+                insn_outputs(insn, &lo, &hi);
+                memcpy(scratch, live, (size_t)words * sizeof(uint64_t));
+                for (size_t o = lo; o < hi && o < insn->nops; o++)
+                    if (insn->ops[o].mode == MIR_OP_REG) bits_clear(scratch, insn->ops[o].u.reg);
+                across[k] = bits_count(scratch, words);
+            }
+            int at = insn_step(insn, live, scratch, words);
+            if (at > peak) peak = at;
+        }
+        int entry = bits_count(live, words);
+        if (entry > peak) peak = entry;
+    }
+
+    free(insns); free(labels); free(block); free(start); free(live_in); free(live);
+    return peak;
+}
+
+/*
+ * price_promotes: The shadow-price rule with the DCE benefit model. The
+ * post-DCE size must fall under the adjusted threshold, scaled by how much
+ * more than a plain call the site saves. `callee_size` is the planner's
+ * effective size (after the callee's own inlining), while b.dead counts
+ * the callee's body as loaded, so the credit is taken once, as the live
+ * fraction of that body applied to the effective size. A site with no
+ * constant arguments reduces to callee_size < compute_adjusted_threshold().
+ */
+static int price_promotes(double lambda, int inverted, MIR_insn_t call,
+                          const func_info_t *callee, int callee_size) {
+    inline_benefit_t b;
+    metrics_lambda(lambda);
+    estimate_inline_benefit(call, callee, &b);
+    double scale = site_savings(&b) / CALL_SAVINGS_INSNS;
+    double live = callee->insns > 0 ? (double)(callee->insns - b.dead) / callee->insns : 1.0;
+    return callee_size * live < compute_adjusted_threshold(lambda, inverted) * scale;
+}
+
+/*
+ * Call-graph inlining planner, over call_graph_build()'s graph. Edges
+ * inside an SCC are recursion and are never promoted. Callers are
+ * visited bottom-up, so when a caller is planned its callees' sizes
+ * already include what was inlined into them; promoting a site adds the
+ * callee's effective size to the caller. That is what lets a hot chain
+ * deeper than one level collapse. Each caller gets MIR's growth rule:
+ * inlining stops once the caller has grown past MIR_CALLER_GROWTH_PCT of
+ * its original size and past MIR_CALLER_GROWTH_FLOOR insns (checked
+ * before each site, as MIR does).
+ * Every site is decided on its own, so promoting one site of a callee
+ * does not block its others.
+ */
+static int inline_growth_limit(int insns) {
+    int limit = insns * MIR_CALLER_GROWTH_PCT / 100;
+    return limit < MIR_CALLER_GROWTH_FLOOR ? MIR_CALLER_GROWTH_FLOOR : limit;
+}
+
+/* Site predicate: promote `callee` (effective size `callee_size`) at site `index`, insn `call`? */
+typedef int (*inline_decide_fn)(const func_info_t *caller, int index, MIR_insn_t call,
+                                const func_info_t *callee, int callee_size, void *arg);
+
+/*
+ * plan_inlining: Promote MIR_CALL sites to MIR_INLINE bottom-up over the
+ * call graph. Returns the number of promotions, -1 on allocation failure.
+ */
+static int plan_inlining(const func_cache_t *fc, inline_decide_fn decide, void *arg) {
+    call_graph_t cg;
+    if (call_graph_build(fc, &cg) != 0) return -1;
+    int *size = malloc((fc->count > 0 ? (size_t)fc->count : 1) * sizeof(int));
+    if (size == NULL) {
+        call_graph_free(&cg);
+        return -1;
+    }
+    for (int f = 0; f < fc->count; f++) size[f] = fc->funcs[f].insns;
+
+    /* Register pressure per function and live-across per edge (--pressure-cost) */
+    int *pressure = NULL, *across = NULL;
+    MIR_insn_t *calls = NULL;
+    if (pressure_cost > 0) {
+        int nedges = cg.first[cg.nfuncs];
+        pressure = malloc((fc->count > 0 ? (size_t)fc->count : 1) * sizeof(int));
+        across = malloc((nedges > 0 ? (size_t)nedges : 1) * sizeof(int));
+        calls = malloc((nedges > 0 ? (size_t)nedges : 1) * sizeof(*calls));
+        int ok = pressure != NULL && across != NULL && calls != NULL;
+        for (int e = 0; ok && e < nedges; e++) calls[e] = cg.edges[e].insn;
+        for (int f = 0; ok && f < fc->count; f++) {
+            int lo = cg.first[f];
+            pressure[f] = func_pressure(fc->funcs[f].item->u.func, &calls[lo], &across[lo],
+                                        cg.first[f + 1] - lo);
+            ok = pressure[f] >= 0;
+        }
+        if (!ok) {  /* Plan on size alone */
+            free(pressure); free(across); free(calls);
+            pressure = across = NULL;
+            calls = NULL;
+        }
+    }
+
+    int mutations = 0;
+    for (int i = 0; i < cg.nfuncs; i++) {
+        int f = cg.order[i];
+        int limit = inline_growth_limit(fc->funcs[f].insns);
+        for (int e = cg.first[f]; e < cg.first[f + 1]; e++) {
+            const cg_edge_t *edge = &cg.edges[e];
+            int c = edge->callee;
+            if (edge->insn->code != MIR_CALL) continue;
+            if (cg.scc[c] == cg.scc[f]) continue;  /* Recursion */
+            if (size[f] > limit) break;             /* MIR's caller growth stop */
+            int cost = size[c], peak = 0;
+            if (calls != NULL) {
+                peak = across[e] + pressure[c];
+                if (peak < pressure[f]) peak = pressure[f];
+                cost += pressure_cost * (pressure_excess(peak) - pressure_excess(pressure[f]));
+            }
+            if (!decide(&fc->funcs[f], edge->index, edge->insn, &fc->funcs[c], cost, arg))
+                continue;
+            edge->insn->code = MIR_INLINE;
+            size[f] += size[c] - 1;
+            if (calls != NULL) pressure[f] = peak;
+            mutations++;
+        }
+    }
+
+    free(pressure);
+    free(across);
+    free(calls);
+    free(size);
+    call_graph_free(&cg);
+    return mutations;
+}
+
+/*
+ * Budgeted knapsack inliner (COND_KNAPSACK).
+ *
+ * Instead of deciding each call site in isolation, choose the set of
+ * promotions that maximizes total value under two kinds of constraint:
+ *
+ *   maximize   sum_i x_i * v_i          v_i = lambda_i * site_savings_i
+ *   subject to sum_i x_i * w_i <= B     w_i = callee insns left after DCE
+ *              sum_{i in c} x_i * w_i <= cap_c   for every caller c
+ *              x_i in {0, 1}
+ *
+ * cap_c mirrors MIR's caller growth check (stop once the caller exceeds
+ * 150% of its original size AND 200 insns): the caller may grow to
+ * max(150% * orig, 200) insns. We treat that as a hard ceiling, whereas
+ * MIR checks before each inline and so can overshoot by one callee.
+ *
+ * Solved by dual decomposition: price the global budget at mu, let every
+ * caller solve its own 0/1 knapsack on reduced value v_i - mu * w_i
+ * exactly (DP over its cap), and bisect mu until the callers' combined
+ * demand fits B. Any budget left over from the duality gap is filled
+ * greedily by value density.
+ */
+typedef struct {
+    MIR_insn_t insn;
+    int        caller;  /* Dense caller ID (index into func_cache_t) */
+    int        weight;  /* Growth if promoted: post-DCE callee insns */
+    double     value;   /* lambda * expected savings */
+    int        chosen;
+} knapsack_site_t;
+
+static int knapsack_caller_cap(const func_info_t *caller) {
+    int limit = inline_growth_limit(caller->insns);
+    return limit > caller->insns ? limit - caller->insns : 0;
+}
+
+/*
+ * knapsack_solve_caller: Exact 0/1 knapsack over sites[lo, hi) (all from
+ * one caller) with capacity `cap`, maximizing sum(value - mu * weight).
+ * Sets sites[i].chosen and returns the total weight chosen.
+ *
+ * `dp` holds cap+1 doubles, `take` holds (hi-lo)*(cap+1) bytes.
+ */
+static int knapsack_solve_caller(knapsack_site_t *sites, int lo, int hi,
+                                 int cap, double mu,
+                                 double *dp, unsigned char *take) {
+    for (int w = 0; w <= cap; w++) dp[w] = 0.0;
+    for (int i = lo; i < hi; i++) {
+        unsigned char *row = take + (size_t)(i - lo) * (cap + 1);
+        memset(row, 0, (size_t)cap + 1);
+        double r = sites[i].value - mu * sites[i].weight;
+        if (r <= 0.0) continue;
+        for (int w = cap; w >= sites[i].weight; w--) {
+            double cand = dp[w - sites[i].weight] + r;
+            if (cand > dp[w]) {
+                dp[w] = cand;
+                row[w] = 1;
+            }
+        }
+    }
+
+    int w = cap, used = 0;
+    for (int i = hi - 1; i >= lo; i--) {
+        sites[i].chosen = take[(size_t)(i - lo) * (cap + 1) + w];
+        if (sites[i].chosen) {
+            w -= sites[i].weight;
+            used += sites[i].weight;
+        }
+    }
+    return used;
+}
+
+/* Solve every caller at price mu. Returns total weight chosen. */
+static int knapsack_solve_all(knapsack_site_t *sites, int nsites,
+                              const int *caller_cap, double mu,
+                              double *dp, unsigned char *take) {
+    int total = 0;
+    for (int lo = 0; lo < nsites;) {
+        int hi = lo;
+        while (hi < nsites && sites[hi].caller == sites[lo].caller) hi++;
+        total += knapsack_solve_caller(sites, lo, hi, caller_cap[sites[lo].caller],
+                                       mu, dp, take);
+        lo = hi;
+    }
+    return total;
+}
+
+static int knapsack_by_density(const void *a, const void *b) {
+    const knapsack_site_t *x = *(knapsack_site_t *const *)a;
+    const knapsack_site_t *y = *(knapsack_site_t *const *)b;
+    double dx = x->value / x->weight, dy = y->value / y->weight;
+    return (dx < dy) - (dx > dy);
+}
+
+/*
+ * mutate_module_knapsack: Promote the knapsack-optimal set of call sites
+ * under a module-wide growth budget of `budget` insns.
+ * Returns the number of promotions, or -1 on allocation failure.
+ */
+static int mutate_module_knapsack(const profile_map_t *profile,
+                                  const func_cache_t *fc, int budget) {
+    int nsites = 0, max_sites = 0;
+    for (int c = 0; c < fc->count; c++) {
+        MIR_func_t func = fc->funcs[c].item->u.func;
+        for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, func->insns);
+             insn != NULL;
+             insn = DLIST_NEXT(MIR_insn_t, insn)) {
+            if (insn->code == MIR_CALL) max_sites++;
+        }
+    }
+
+    knapsack_site_t *sites = calloc(max_sites > 0 ? (size_t)max_sites : 1, sizeof(*sites));
+    int *caller_cap = calloc(fc->count > 0 ? (size_t)fc->count : 1, sizeof(int));
+    int max_cap = 0, max_per_caller = 0;
+    if (sites == NULL || caller_cap == NULL) {
+        free(sites); free(caller_cap);
+        return -1;
+    }
+
+    /* Collect candidate sites, grouped by caller (dense caller order) */
+    for (int c = 0; c < fc->count; c++) {
+        caller_cap[c] = knapsack_caller_cap(&fc->funcs[c]);
+        if (caller_cap[c] > budget) caller_cap[c] = budget;
+        if (caller_cap[c] > max_cap) max_cap = caller_cap[c];
+        int first = nsites;
+
+        MIR_func_t func = fc->funcs[c].item->u.func;
+        int index = -1;
+        for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, func->insns);
+             insn != NULL;
+             insn = DLIST_NEXT(MIR_insn_t, insn)) {
+            if (insn->code == MIR_CALL || insn->code == MIR_INLINE) index++;
+            if (insn->code != MIR_CALL) continue;
+            MIR_item_t callee_item = insn->ops[1].u.ref;
+            if (callee_item == NULL) continue;
+            const func_info_t *callee = func_cache_get(fc, callee_item);
+            if (callee == NULL || callee->insns <= 0) continue;
+            if (callee->item == fc->funcs[c].item) continue;  /* Self-recursion */
+
+            double lambda = profile_site_lambda(profile, func->name, index, callee->name);
+            metrics_lambda(lambda);
+            inline_benefit_t benefit;
+            estimate_inline_benefit(insn, callee, &benefit);
+
+            knapsack_site_t *site = &sites[nsites++];
+            site->insn = insn;
+            site->caller = c;
+            site->weight = callee->insns - benefit.dead;
+            if (site->weight < 1) site->weight = 1;
+            site->value = lambda * site_savings(&benefit);
+        }
+        if (nsites - first > max_per_caller) max_per_caller = nsites - first;
+    }
+
+    double *dp = malloc(((size_t)max_cap + 1) * sizeof(double));
+    unsigned char *take = malloc((size_t)(max_per_caller > 0 ? max_per_caller : 1)
+                                 * ((size_t)max_cap + 1));
+    knapsack_site_t **order = malloc((nsites > 0 ? (size_t)nsites : 1) * sizeof(*order));
+    if (dp == NULL || take == NULL || order == NULL) {
+        free(sites); free(caller_cap); free(dp); free(take); free(order);
+        return -1;
+    }
+
+    /* Dual ascent on mu: smallest price at which total demand fits budget */
+    double mu_lo = 0.0, mu_hi = 0.0;
+    for (int i = 0; i < nsites; i++) {
+        double density = sites[i].value / sites[i].weight;
+        if (density > mu_hi) mu_hi = density;
+    }
+    int used = knapsack_solve_all(sites, nsites, caller_cap, mu_lo, dp, take);
+    if (used > budget) {
+        for (int it = 0; it < KNAPSACK_BISECT_ITERS; it++) {
+            double mu = 0.5 * (mu_lo + mu_hi);
+            if (knapsack_solve_all(sites, nsites, caller_cap, mu, dp, take) > budget)
+                mu_lo = mu;
+            else
+                mu_hi = mu;
+        }
+        used = knapsack_solve_all(sites, nsites, caller_cap, mu_hi, dp, take);
+    }
+
+    /* Primal repair: spend any leftover budget by value density */
+    int *caller_used = calloc(fc->count > 0 ? (size_t)fc->count : 1, sizeof(int));
+    if (caller_used != NULL) {
+        for (int i = 0; i < nsites; i++)
+            if (sites[i].chosen) caller_used[sites[i].caller] += sites[i].weight;
+        int norder = 0;
+        for (int i = 0; i < nsites; i++)
+            if (!sites[i].chosen && sites[i].value > 0.0) order[norder++] = &sites[i];
+        qsort(order, (size_t)norder, sizeof(*order), knapsack_by_density);
+        for (int k = 0; k < norder; k++) {
+            knapsack_site_t *site = order[k];
+            if (used + site->weight > budget) continue;
+            if (caller_used[site->caller] + site->weight > caller_cap[site->caller])
+                continue;
+            site->chosen = 1;
+            used += site->weight;
+            caller_used[site->caller] += site->weight;
+        }
+        free(caller_used);
+    }
+
+    int mutations = 0;
+    for (int i = 0; i < nsites; i++) {
+        if (!sites[i].chosen) continue;
+        sites[i].insn->code = MIR_INLINE;
+        mutations++;
+    }
+
+    free(sites); free(caller_cap); free(dp); free(take); free(order);
+    return mutations;
+}
+
+/*
+ * Baseline walk (COND_NO_INLINE, COND_BLIND_ALL, COND_RANDOM_50): the
+ * published protocol's flat pass, kept so these conditions reproduce the
+ * published baselines. Sites are visited in item order with no growth
+ * stop, and RANDOM_50 draws once per site in that order. A callee that has
+ * been promoted once is skipped at its later sites, as it always was; that
+ * is also what keeps recursion from expanding. Returns the number of
+ * promotions, -1 on allocation failure.
+ */
+static int mutate_module_baseline(experiment_condition_t condition, const func_cache_t *fc,
+                                  unsigned int *rng_state) {
+    if (condition == COND_NO_INLINE) return 0;  /* Leave every site as MIR_CALL */
+    unsigned char *promoted = calloc(fc->count > 0 ? (size_t)fc->count : 1, 1);
+    if (promoted == NULL) return -1;
+
+    int mutations = 0;
+    for (int f = 0; f < fc->count; f++) {
+        for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, fc->funcs[f].item->u.func->insns);
+             insn != NULL; insn = DLIST_NEXT(MIR_insn_t, insn)) {
+            if (insn->code != MIR_CALL) continue;
+            const func_info_t *fi = func_cache_get(fc, insn->ops[1].u.ref);
+            if (fi == NULL || promoted[fi - fc->funcs]) continue;
+
+            int should_promote = 1;  /* COND_BLIND_ALL: promote everything */
+            if (condition == COND_RANDOM_50) {
+                /* XorShift32 for reproducible randomness */
+                *rng_state ^= *rng_state << 13;
+                *rng_state ^= *rng_state >> 17;
+                *rng_state ^= *rng_state << 5;
+                should_promote = *rng_state % 2 == 0;
+            }
+            if (!should_promote) continue;
+            insn->code = MIR_INLINE;
+            promoted[fi - fc->funcs] = 1;
+            mutations++;
+        }
+    }
+    free(promoted);
+    return mutations;
+}
+
+typedef struct {
+    experiment_condition_t condition;
+    const profile_map_t   *profile;
+} condition_decide_t;
+
+static int condition_decide(const func_info_t *caller, int index, MIR_insn_t call,
+                            const func_info_t *callee, int callee_size, void *arg) {
+    const condition_decide_t *d = arg;
+
+    switch (d->condition) {
+    case COND_SHADOW_PRICE: {
+        double lambda = profile_site_lambda(d->profile, caller->name, index, callee->name);
+        return price_promotes(lambda, 0, call, callee, callee_size);
+    }
+
+    case COND_INVERTED_PRICE: {
+        double lambda = profile_site_lambda(d->profile, caller->name, index, callee->name);
+        return price_promotes(lambda, 1, call, callee, callee_size);
+    }
+
+    default:
+        return 0;
+    }
+}
+
+/*
+ * mutate_module: Apply experimental condition to all MIR_CALL instructions.
+ *
+ * Runs BEFORE MIR_link(). Modifies insn->code in-place. Callee sizes come
+ * from `fc`, built by func_cache_build() after MIR_load_module(). The
+ * baseline conditions take mutate_module_baseline()'s flat pass; the
+ * price-guided ones are planned bottom-up by plan_inlining(), which
+ * compares each callee's size after its own inlining. `growth_budget`
+ * (insns) is only used by COND_KNAPSACK, `rng_state` by COND_RANDOM_50.
+ *
+ * Returns: number of MIR_CALL instructions promoted to MIR_INLINE, or -1
+ * (after printing an error) if planning ran out of memory.
+ */
+static int mutate_module(experiment_condition_t condition,
+                         const profile_map_t *profile,
+                         const func_cache_t *fc,
+                         int growth_budget,
+                         unsigned int *rng_state) {
+    int mutations;
+    if (condition == COND_KNAPSACK) {
+        mutations = mutate_module_knapsack(profile, fc, growth_budget);
+    } else if (condition == COND_NO_INLINE || condition == COND_BLIND_ALL ||
+               condition == COND_RANDOM_50) {
+        mutations = mutate_module_baseline(condition, fc, rng_state);
+    } else {
+        condition_decide_t d = {condition, profile};
+        mutations = plan_inlining(fc, condition_decide, &d);
+    }
+    if (mutations < 0) {
+        fprintf(stderr, "ERROR: out of memory planning '%s'\n", condition_names[condition]);
+        return -1;
+    }
+    metrics_add(&metrics->mutate_passes[condition], 1);
+    metrics_add(&metrics->promotions[condition], (uint64_t)mutations);
+    return mutations;
+}
+
+/* ========================================================================
+ * SECTION 5: BENCHMARK IR (v2 - 8-function growth-budget stress test)
+ *
+ * 8 callee functions at varying sizes in the 55-180 insn sweet spot:
+ *   HOT  (called every iter):       f_hot1(55), f_hot2(75), f_hot3(100), f_hot4(60)
+ *   WARM (called every 10th iter):  f_warm1(80), f_warm2(120)
+ *   COLD (called every 1000th iter): f_cold1(150), f_cold2(180)
+ *
+ * Total callee insns if all inlined: 55+75+100+60+80+120+150+180 = 820
+ * Driver starts at ~40 insns. Growth to ~860 = 2150% >> 150% budget.
+ * MIR growth check: caller > 150% original AND > 200 insns -> stop.
+ * Blind-all WILL hit the ceiling. Shadow-price should prioritize hot.
+ * ======================================================================== */
+
+static const char *benchmark_ir =
+"m_bench: module\n"
+"  export driver\n"
+"  p_f_hot1: proto i64, i64:flag, i64:x\n"
+"  p_f_hot2: proto i64, i64:flag, i64:x\n"
+"  p_f_hot3: proto i64, i64:flag, i64:x\n"
+"  p_f_hot4: proto i64, i64:flag, i64:x\n"
+"  p_f_warm1: proto i64, i64:flag, i64:x\n"
+"  p_f_warm2: proto i64, i64:flag, i64:x\n"
+"  p_f_cold1: proto i64, i64:flag, i64:x\n"
+"  p_f_cold2: proto i64, i64:flag, i64:x\n"
+"\n"
+/* --- f_hot1: ~55 insns, HOT path --- */
+"  f_hot1: func i64, i64:flag, i64:x\n"
+"    local i64:t1, i64:t2, i64:t3, i64:t4\n"
+"    bne h1_heavy, flag, 1\n"
+"    add t1, x, 1\n"
+"    ret t1\n"
+"  h1_heavy:\n"
+"    add t1, x, 1\n"
+"    add t2, t1, 2\n"
+"    mul t3, t2, 3\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, t2\n"
+"    add t2, t1, t3\n"
+"    mul t3, t2, 2\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, 5\n"
+"    add t2, t1, t4\n"
+"    mul t3, t2, 3\n"
+"    sub t4, t3, t1\n"
+"    add t1, t4, t2\n"
+"    mul t2, t1, 2\n"
+"    add t3, t2, t4\n"
+"    sub t4, t3, 5\n"
+"    add t1, x, 1\n"
+"    add t2, t1, 2\n"
+"    mul t3, t2, 3\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, t2\n"
+"    add t2, t1, t3\n"
+"    mul t3, t2, 2\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, 5\n"
+"    add t2, t1, t4\n"
+"    mul t3, t2, 3\n"
+"    sub t4, t3, t1\n"
+"    add t1, t4, t2\n"
+"    mul t2, t1, 2\n"
+"    add t3, t2, t4\n"
+"    sub t4, t3, 5\n"
+"    add t1, x, 1\n"
+"    add t2, t1, 2\n"
+"    mul t3, t2, 3\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, t2\n"
+"    add t2, t1, t3\n"
+"    mul t3, t2, 2\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, 5\n"
+"    add t2, t1, t4\n"
+"    mul t3, t2, 3\n"
+"    sub t4, t3, t1\n"
+"    add t1, t4, t2\n"
+"    mul t2, t1, 2\n"
+"    add t3, t2, t4\n"
+"    sub t4, t3, 5\n"
+"    add t1, x, 1\n"
+"    add t2, t1, 2\n"
+"    ret t4\n"
+"  endfunc\n"
+"\n"
+/* --- f_hot2: ~75 insns, HOT path --- */
+"  f_hot2: func i64, i64:flag, i64:x\n"
+"    local i64:t1, i64:t2, i64:t3, i64:t4\n"
+"    bne h2_heavy, flag, 1\n"
+"    add t1, x, 1\n"
+"    ret t1\n"
+"  h2_heavy:\n"
+"    add t1, x, 1\n"
+"    add t2, t1, 2\n"
+"    mul t3, t2, 3\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, t2\n"
+"    add t2, t1, t3\n"
+"    mul t3, t2, 2\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, 5\n"
+"    add t2, t1, t4\n"
+"    mul t3, t2, 3\n"
+"    sub t4, t3, t1\n"
+"    add t1, t4, t2\n"
+"    mul t2, t1, 2\n"
+"    add t3, t2, t4\n"
+"    sub t4, t3, 5\n"
+"    add t1, x, 1\n"
+"    add t2, t1, 2\n"
+"    mul t3, t2, 3\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, t2\n"
+"    add t2, t1, t3\n"
+"    mul t3, t2, 2\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, 5\n"
+"    add t2, t1, t4\n"
+"    mul t3, t2, 3\n"
+"    sub t4, t3, t1\n"
+"    add t1, t4, t2\n"
+"    mul t2, t1, 2\n"
+"    add t3, t2, t4\n"
+"    sub t4, t3, 5\n"
+"    add t1, x, 1\n"
+"    add t2, t1, 2\n"
+"    mul t3, t2, 3\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, t2\n"
+"    add t2, t1, t3\n"
+"    mul t3, t2, 2\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, 5\n"
+"    add t2, t1, t4\n"
+"    mul t3, t2, 3\n"
+"    sub t4, t3, t1\n"
+"    add t1, t4, t2\n"
+"    mul t2, t1, 2\n"
+"    add t3, t2, t4\n"
+"    sub t4, t3, 5\n"
+"    add t1, x, 1\n"
+"    add t2, t1, 2\n"
+"    mul t3, t2, 3\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, t2\n"
+"    add t2, t1, t3\n"
+"    mul t3, t2, 2\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, 5\n"
+"    add t2, t1, t4\n"
+"    mul t3, t2, 3\n"
+"    sub t4, t3, t1\n"
+"    add t1, t4, t2\n"
+"    mul t2, t1, 2\n"
+"    add t3, t2, t4\n"
+"    sub t4, t3, 5\n"
+"    add t1, x, 1\n"
+"    add t2, t1, 2\n"
+"    mul t3, t2, 3\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, t2\n"
+"    add t2, t1, t3\n"
+"    ret t4\n"
+"  endfunc\n"
+"\n"
+/* --- f_hot3: ~100 insns, HOT path --- */
+"  f_hot3: func i64, i64:flag, i64:x\n"
+"    local i64:t1, i64:t2, i64:t3, i64:t4\n"
+"    bne h3_heavy, flag, 1\n"
+"    add t1, x, 1\n"
+"    ret t1\n"
+"  h3_heavy:\n"
+"    add t1, x, 1\n"
+"    add t2, t1, 2\n"
+"    mul t3, t2, 3\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, t2\n"
+"    add t2, t1, t3\n"
+"    mul t3, t2, 2\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, 5\n"
+"    add t2, t1, t4\n"
+"    mul t3, t2, 3\n"
+"    sub t4, t3, t1\n"
+"    add t1, t4, t2\n"
+"    mul t2, t1, 2\n"
+"    add t3, t2, t4\n"
+"    sub t4, t3, 5\n"
+"    add t1, x, 1\n"
+"    add t2, t1, 2\n"
+"    mul t3, t2, 3\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, t2\n"
+"    add t2, t1, t3\n"
+"    mul t3, t2, 2\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, 5\n"
+"    add t2, t1, t4\n"
+"    mul t3, t2, 3\n"
+"    sub t4, t3, t1\n"
+"    add t1, t4, t2\n"
+"    mul t2, t1, 2\n"
+"    add t3, t2, t4\n"
+"    sub t4, t3, 5\n"
+"    add t1, x, 1\n"
+"    add t2, t1, 2\n"
+"    mul t3, t2, 3\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, t2\n"
+"    add t2, t1, t3\n"
+"    mul t3, t2, 2\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, 5\n"
+"    add t2, t1, t4\n"
+"    mul t3, t2, 3\n"
+"    sub t4, t3, t1\n"
+"    add t1, t4, t2\n"
+"    mul t2, t1, 2\n"
+"    add t3, t2, t4\n"
+"    sub t4, t3, 5\n"
+"    add t1, x, 1\n"
+"    add t2, t1, 2\n"
+"    mul t3, t2, 3\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, t2\n"
+"    add t2, t1, t3\n"
+"    mul t3, t2, 2\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, 5\n"
+"    add t2, t1, t4\n"
+"    mul t3, t2, 3\n"
+"    sub t4, t3, t1\n"
+"    add t1, t4, t2\n"
+"    mul t2, t1, 2\n"
+"    add t3, t2, t4\n"
+"    sub t4, t3, 5\n"
+"    add t1, x, 1\n"
+"    add t2, t1, 2\n"
+"    mul t3, t2, 3\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, t2\n"
+"    add t2, t1, t3\n"
+"    mul t3, t2, 2\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, 5\n"
+"    add t2, t1, t4\n"
+"    mul t3, t2, 3\n"
+"    sub t4, t3, t1\n"
+"    add t1, t4, t2\n"
+"    mul t2, t1, 2\n"
+"    add t3, t2, t4\n"
+"    sub t4, t3, 5\n"
+"    add t1, x, 1\n"
+"    add t2, t1, 2\n"
+"    mul t3, t2, 3\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, t2\n"
+"    add t2, t1, t3\n"
+"    mul t3, t2, 2\n"
+"    add t4, t3, t1\n"
+"    sub t1, t4, 5\n"
+"    add t2, t1, t4\n"
+"    mul t3, t2, 3\n"
+"    sub t4, t3, t1\n"
 "    add t1, t4, t2\n"
 "    mul t2, t1, 2\n"
 "    add t3, t2, t4\n"
@@ -1287,267 +3786,3460 @@ static const char *benchmark_ir =
 "\n"
 /* --- driver: 8-function benchmark with hot/warm/cold separation --- */
 /*
- * Call frequencies (per N iterations):
- *   f_hot1..f_hot4:  N each      (lambda ~ 1.0)
- *   f_warm1,f_warm2: N/10 each   (lambda ~ 0.1)
- *   f_cold1,f_cold2: N/1000 each (lambda ~ 0.01)
+ * Call frequencies (per N iterations):
+ *   f_hot1..f_hot4:  N each      (lambda ~ 1.0)
+ *   f_warm1,f_warm2: N/10 each   (lambda ~ 0.1)
+ *   f_cold1,f_cold2: N/1000 each (lambda ~ 0.01)
+ *
+ * Total callee insns if all inlined: 55+75+100+60+80+120+150+180 = 820
+ * Driver starts at ~40 insns. Growth to ~860 = 2150% >> 150% budget.
+ * MIR growth check: caller > 150% original AND > 200 insns -> stop inlining.
+ * So blind-all will inline the first few and then hit the ceiling.
+ * Shadow-price should inline hot functions first (highest value per budget).
+ */
+"  driver: func i64, i64:n\n"
+"    local i64:i, i64:sum, i64:tmp, i64:mod\n"
+"    mov i, 0\n"
+"    mov sum, 0\n"
+"  loop:\n"
+"    bge done, i, n\n"
+/* Hot: every iteration */
+"    call p_f_hot1, f_hot1, sum, 1, sum\n"
+"    call p_f_hot2, f_hot2, tmp, 1, sum\n"
+"    add sum, sum, tmp\n"
+"    call p_f_hot3, f_hot3, tmp, 1, sum\n"
+"    add sum, sum, tmp\n"
+"    call p_f_hot4, f_hot4, tmp, 1, sum\n"
+"    add sum, sum, tmp\n"
+/* Warm: every 10th iteration */
+"    mod mod, i, 10\n"
+"    bne skip_warm, mod, 0\n"
+"    call p_f_warm1, f_warm1, tmp, 1, sum\n"
+"    add sum, sum, tmp\n"
+"    call p_f_warm2, f_warm2, tmp, 1, sum\n"
+"    add sum, sum, tmp\n"
+"  skip_warm:\n"
+/* Cold: every 1000th iteration */
+"    mod mod, i, 1000\n"
+"    bne skip_cold, mod, 0\n"
+"    call p_f_cold1, f_cold1, tmp, 1, sum\n"
+"    add sum, sum, tmp\n"
+"    call p_f_cold2, f_cold2, tmp, 1, sum\n"
+"    add sum, sum, tmp\n"
+"  skip_cold:\n"
+"    add i, i, 1\n"
+"    jmp loop\n"
+"  done:\n"
+"    ret sum\n"
+"  endfunc\n"
+"endmodule\n";
+
+/* ========================================================================
+ * Synthetic workloads (--synthetic N)
+ *
+ * build_synthetic_module() generates a module of N callees s0..s{N-1}
+ * plus driver(n). It emits through the MIR_new_insn API directly, so a
+ * module with thousands of functions costs no scanner time. The callees
+ * share benchmark_ir's signature (flag, x) and body idiom:
+ *
+ *   Shape    Parent of s_c is s_{c-1} (chain) or s_{(c-1)/fanout} (tree).
+ *            In a dag, s_c also gets one random earlier parent. Edges run
+ *            from low to high index, so the graph is acyclic and s0 is its
+ *            only root. driver calls s0 once per iteration.
+ *   Hotness  s_c runs about (c+1)^-zipf times per iteration (Zipf by
+ *            index). Parent p calls c with probability q = f_c / (npar * f_p)
+ *            behind "mod r, x, K; bne skip, r, 0" (q = 1/K) or, for q > 1/2,
+ *            "beq skip, r, 0" (q = (K-1)/K). These are the guards the
+ *            static estimator reads. The x passed down is put through an
+ *            LCG step so guards along a path are independent.
+ *   Bodies   Sizes are uniform in [SYNTH_MIN_INSNS, SYNTH_MAX_INSNS]. Each
+ *            body has SYNTH_BLOCKS diamonds "bne heavy, flag, 1": the light
+ *            side is one add, the heavy side gets the remaining size.
+ *            Every call passes flag = 1, so once inlined the heavy sides
+ *            are dead.
+ * ======================================================================== */
+
+typedef enum { SHAPE_CHAIN, SHAPE_TREE, SHAPE_DAG, SHAPE_COUNT } synth_shape_t;
+
+static const char *synth_shape_names[SHAPE_COUNT] = {"chain", "tree", "dag"};
+
+typedef struct {
+    int           funcs;   /* Callees to generate; 0 = benchmark_ir */
+    synth_shape_t shape;
+    int           fanout;  /* Children per function (tree, dag) */
+    double        zipf;    /* Hotness exponent */
+    unsigned int  seed;    /* Sizes and dag edges */
+    int           modules; /* s_c goes to module c % modules, driver to 0 */
+} synth_config_t;
+
+#define SYNTH_LCG_A  6364136223846793005LL
+#define SYNTH_LCG_C  1442695040888963407LL
+
+/* driver(n) argument of every timed run; --synthetic and --iters change it */
+static int64_t bench_iters = BENCH_N;
+
+static unsigned int synth_rand(unsigned int *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+/* Expected entries of s_c per driver iteration. */
+static double synth_freq(const synth_config_t *cfg, int c) {
+    return pow(c + 1.0, -cfg->zipf);
+}
+
+/* Append an s_c body with the given size and children. */
+static void synth_emit_callee(MIR_context_t ctx, MIR_item_t f, MIR_item_t proto, int size,
+                              MIR_item_t *callees, const int *child,
+                              const int64_t *period, int nchildren) {
+    /* period[k]: K > 0 calls 1 in K; -K calls K-1 in K; 0 always calls */
+    MIR_func_t func = f->u.func;
+    MIR_op_t flag = MIR_new_reg_op(ctx, MIR_reg(ctx, "flag", func));
+    MIR_op_t x = MIR_new_reg_op(ctx, MIR_reg(ctx, "x", func));
+    MIR_op_t acc = MIR_new_reg_op(ctx, MIR_new_func_reg(ctx, func, MIR_T_I64, "acc"));
+    MIR_op_t r = MIR_new_reg_op(ctx, MIR_new_func_reg(ctx, func, MIR_T_I64, "r"));
+    MIR_op_t y = MIR_new_reg_op(ctx, MIR_new_func_reg(ctx, func, MIR_T_I64, "y"));
+    static const MIR_insn_code_t heavy_ops[3] = {MIR_MUL, MIR_ADD, MIR_SUB};
+
+    /* mov + ret, 5 per diamond, 7 per guarded call */
+    int heavy = (size - 2 - 5 * SYNTH_BLOCKS - 7 * nchildren) / SYNTH_BLOCKS;
+    if (heavy < 1) heavy = 1;
+
+    MIR_append_insn(ctx, f, MIR_new_insn(ctx, MIR_MOV, acc, x));
+    for (int b = 0; b < SYNTH_BLOCKS; b++) {
+        MIR_insn_t heavy_label = MIR_new_label(ctx), join = MIR_new_label(ctx);
+        MIR_append_insn(ctx, f, MIR_new_insn(ctx, MIR_BNE, MIR_new_label_op(ctx, heavy_label),
+                                             flag, MIR_new_int_op(ctx, 1)));
+        MIR_append_insn(ctx, f, MIR_new_insn(ctx, MIR_ADD, acc, acc, MIR_new_int_op(ctx, b + 1)));
+        MIR_append_insn(ctx, f, MIR_new_insn(ctx, MIR_JMP, MIR_new_label_op(ctx, join)));
+        MIR_append_insn(ctx, f, heavy_label);
+        for (int h = 0; h < heavy; h++)
+            MIR_append_insn(ctx, f, MIR_new_insn(ctx, heavy_ops[h % 3], acc, acc,
+                                                 MIR_new_int_op(ctx, h % 7 + 2)));
+        MIR_append_insn(ctx, f, join);
+    }
+    for (int k = 0; k < nchildren; k++) {
+        MIR_insn_t skip = MIR_new_label(ctx);
+        if (period[k] != 0) {
+            int64_t K = period[k] > 0 ? period[k] : -period[k];
+            MIR_append_insn(ctx, f, MIR_new_insn(ctx, MIR_MOD, r, x, MIR_new_int_op(ctx, K)));
+            MIR_append_insn(ctx, f, MIR_new_insn(ctx, period[k] > 0 ? MIR_BNE : MIR_BEQ,
+                                                 MIR_new_label_op(ctx, skip),
+                                                 r, MIR_new_int_op(ctx, 0)));
+        }
+        MIR_append_insn(ctx, f, MIR_new_insn(ctx, MIR_MUL, y, x, MIR_new_int_op(ctx, SYNTH_LCG_A)));
+        MIR_append_insn(ctx, f, MIR_new_insn(ctx, MIR_ADD, y, y, MIR_new_int_op(ctx, SYNTH_LCG_C)));
+        MIR_append_insn(ctx, f, MIR_new_call_insn(ctx, 5, MIR_new_ref_op(ctx, proto),
+                                                  MIR_new_ref_op(ctx, callees[child[k]]), r,
+                                                  MIR_new_int_op(ctx, 1), y));
+        MIR_append_insn(ctx, f, MIR_new_insn(ctx, MIR_ADD, acc, acc, r));
+        MIR_append_insn(ctx, f, skip);
+    }
+    MIR_append_insn(ctx, f, MIR_new_ret_insn(ctx, 1, acc));
+}
+
+/*
+ * build_synthetic_module: Generate the workload described by `cfg` into
+ * ctx as cfg->modules finished, unloaded modules (at least one) and
+ * return the first. Returns NULL on allocation failure.
+ */
+static MIR_module_t build_synthetic_module(MIR_context_t ctx, const synth_config_t *cfg) {
+    int n = cfg->funcs;
+    int *size = malloc((size_t)n * sizeof(int));
+    int *parent = malloc(2 * (size_t)n * sizeof(int));
+    int *npar = calloc((size_t)n, sizeof(int));
+    int *first = calloc((size_t)n + 1, sizeof(int));
+    int *fill = calloc((size_t)n, sizeof(int));
+    int *child = malloc(2 * (size_t)n * sizeof(int));
+    int64_t *period = malloc(2 * (size_t)n * sizeof(int64_t));
+    MIR_item_t *items = malloc((size_t)n * sizeof(MIR_item_t));
+    int *imported = malloc((size_t)n * sizeof(int));
+    if (size == NULL || parent == NULL || npar == NULL || first == NULL || fill == NULL ||
+        child == NULL || period == NULL || items == NULL || imported == NULL) {
+        free(size); free(parent); free(npar); free(first); free(fill);
+        free(child); free(period); free(items); free(imported);
+        return NULL;
+    }
+
+    /* Sizes and parents, then children grouped by parent (CSR) */
+    unsigned int rng = cfg->seed ? cfg->seed : 1;
+    for (int c = 0; c < n; c++) {
+        size[c] = SYNTH_MIN_INSNS + (int)(synth_rand(&rng) % (SYNTH_MAX_INSNS - SYNTH_MIN_INSNS + 1));
+        if (c == 0) continue;
+        int p = cfg->shape == SHAPE_CHAIN ? c - 1 : (c - 1) / cfg->fanout;
+        parent[2 * c] = p;
+        npar[c] = 1;
+        if (cfg->shape == SHAPE_DAG && c >= 2) {
+            int q = (int)(synth_rand(&rng) % (unsigned int)c);
+            if (q != p) parent[2 * c + npar[c]++] = q;
+        }
+        for (int k = 0; k < npar[c]; k++) first[parent[2 * c + k] + 1]++;
+    }
+    for (int c = 0; c < n; c++) first[c + 1] += first[c];
+    for (int c = 1; c < n; c++) {
+        for (int k = 0; k < npar[c]; k++) {
+            int p = parent[2 * c + k];
+            int e = first[p] + fill[p]++;
+            child[e] = c;
+            double q = synth_freq(cfg, c) / (npar[c] * synth_freq(cfg, p));
+            if (q <= 0.5)
+                period[e] = llround(1.0 / q);
+            else if (1.0 - q > 1e-9)
+                period[e] = -llround(1.0 / (1.0 - q));
+            else
+                period[e] = 0;
+            if (period[e] == 1 || period[e] == -1) period[e] = 0;
+        }
+    }
+
+    /*
+     * One module per k. items[c] is how the module being built refers to
+     * s_c: the function itself in its home module c % nmod, an import item
+     * elsewhere. Children have larger indices than their parents, so local
+     * callees are always defined before their callers.
+     */
+    int nmod = cfg->modules > 1 ? cfg->modules : 1;
+    MIR_type_t i64 = MIR_T_I64;
+    MIR_module_t m = NULL;
+    char name[32];
+    for (int c = 0; c < n; c++) imported[c] = -1;
+    for (int k = 0; k < nmod; k++) {
+        if (k == 0)
+            snprintf(name, sizeof(name), "m_synth");
+        else
+            snprintf(name, sizeof(name), "m_synth%d", k);
+        MIR_module_t mk = MIR_new_module(ctx, name);
+        if (m == NULL) m = mk;
+        if (k == 0) MIR_new_export(ctx, "driver");
+        for (int c = k; c < n; c += nmod) {
+            int remote = 0;
+            for (int p = 0; p < npar[c]; p++) remote |= parent[2 * c + p] % nmod != k;
+            snprintf(name, sizeof(name), "s%d", c);
+            if (c > 0 && remote) MIR_new_export(ctx, name);
+            for (int e = first[c]; e < first[c + 1]; e++) {
+                int ch = child[e];
+                if (ch % nmod == k || imported[ch] == k) continue;
+                snprintf(name, sizeof(name), "s%d", ch);
+                items[ch] = MIR_new_import(ctx, name);
+                imported[ch] = k;
+            }
+        }
+        MIR_item_t proto = MIR_new_proto(ctx, "p_s", 1, &i64, 2, MIR_T_I64, "flag", MIR_T_I64, "x");
+
+        /* Callees before callers, so every call refers to an existing item */
+        for (int c = n - 1; c >= 0; c--) {
+            if (c % nmod != k) continue;
+            snprintf(name, sizeof(name), "s%d", c);
+            items[c] = MIR_new_func(ctx, name, 1, &i64, 2, MIR_T_I64, "flag", MIR_T_I64, "x");
+            synth_emit_callee(ctx, items[c], proto, size[c], items, child + first[c],
+                              period + first[c], first[c + 1] - first[c]);
+            MIR_finish_func(ctx);
+        }
+        if (k > 0) {
+            MIR_finish_module(ctx);
+            continue;
+        }
+
+        MIR_item_t driver = MIR_new_func(ctx, "driver", 1, &i64, 1, MIR_T_I64, "n");
+        MIR_func_t func = driver->u.func;
+        MIR_op_t n_op = MIR_new_reg_op(ctx, MIR_reg(ctx, "n", func));
+        MIR_op_t i = MIR_new_reg_op(ctx, MIR_new_func_reg(ctx, func, MIR_T_I64, "i"));
+        MIR_op_t sum = MIR_new_reg_op(ctx, MIR_new_func_reg(ctx, func, MIR_T_I64, "sum"));
+        MIR_op_t x = MIR_new_reg_op(ctx, MIR_new_func_reg(ctx, func, MIR_T_I64, "x"));
+        MIR_op_t tmp = MIR_new_reg_op(ctx, MIR_new_func_reg(ctx, func, MIR_T_I64, "tmp"));
+        MIR_insn_t loop = MIR_new_label(ctx), done = MIR_new_label(ctx);
+        MIR_append_insn(ctx, driver, MIR_new_insn(ctx, MIR_MOV, i, MIR_new_int_op(ctx, 0)));
+        MIR_append_insn(ctx, driver, MIR_new_insn(ctx, MIR_MOV, sum, MIR_new_int_op(ctx, 0)));
+        MIR_append_insn(ctx, driver, loop);
+        MIR_append_insn(ctx, driver, MIR_new_insn(ctx, MIR_BGE, MIR_new_label_op(ctx, done), i, n_op));
+        MIR_append_insn(ctx, driver, MIR_new_insn(ctx, MIR_MUL, x, i, MIR_new_int_op(ctx, SYNTH_LCG_A)));
+        MIR_append_insn(ctx, driver, MIR_new_insn(ctx, MIR_ADD, x, x, MIR_new_int_op(ctx, SYNTH_LCG_C)));
+        MIR_append_insn(ctx, driver, MIR_new_call_insn(ctx, 5, MIR_new_ref_op(ctx, proto),
+                                                       MIR_new_ref_op(ctx, items[0]), tmp,
+                                                       MIR_new_int_op(ctx, 1), x));
+        MIR_append_insn(ctx, driver, MIR_new_insn(ctx, MIR_ADD, sum, sum, tmp));
+        MIR_append_insn(ctx, driver, MIR_new_insn(ctx, MIR_ADD, i, i, MIR_new_int_op(ctx, 1)));
+        MIR_append_insn(ctx, driver, MIR_new_insn(ctx, MIR_JMP, MIR_new_label_op(ctx, loop)));
+        MIR_append_insn(ctx, driver, done);
+        MIR_append_insn(ctx, driver, MIR_new_ret_insn(ctx, 1, sum));
+        MIR_finish_func(ctx);
+        MIR_finish_module(ctx);
+    }
+
+    free(size); free(parent); free(npar); free(first); free(fill);
+    free(child); free(period); free(items); free(imported);
+    return m;
+}
+
+/* ========================================================================
+ * SECTION 6: EXPERIMENT RUNNER (Phase 3)
+ *
+ * For each condition:
+ *   1. Fresh MIR context (clean state)
+ *   2. Read IR (binary template, scanned once per process)
+ *   3. Profile module (Phase 1)
+ *   4. Apply mutation (Phase 2)
+ *   5. Link + JIT compile
+ *   6. Execute with timing (Phase 3)
+ *   7. Tear down context
+ *
+ * Lifecycle anchored to PoC v2's confirmed working pattern.
+ * ======================================================================== */
+
+/*
+ * IR template: the workload (benchmark_ir, or a --synthetic module) is
+ * built once by benchmark_template_init() and kept as MIR binary IR in memory. Every later context reads that
+ * image with MIR_read_with_func(), which skips the text scanner; the
+ * result is an ordinary unloaded module, as if freshly scanned. The MIR
+ * byte reader/writer callbacks only receive the context, so the cursor
+ * lives in thread-local state.
+ */
+typedef struct {
+    uint8_t *data;
+    size_t   len, cap;
+} mir_template_t;
+
+static mir_template_t benchmark_template;  /* Empty = fall back to scanning */
+static _Thread_local mir_template_t *template_sink;
+static _Thread_local const mir_template_t *template_src;
+static _Thread_local size_t template_pos;
+
+static int template_writer(MIR_context_t ctx, uint8_t byte) {
+    (void)ctx;
+    mir_template_t *t = template_sink;
+    if (t->len == t->cap) {
+        size_t cap = t->cap ? t->cap * 2 : 4096;
+        uint8_t *data = realloc(t->data, cap);
+        if (data == NULL) return EOF;
+        t->data = data;
+        t->cap = cap;
+    }
+    t->data[t->len++] = byte;
+    return 1;
+}
+
+static int template_reader(MIR_context_t ctx) {
+    (void)ctx;
+    return template_pos < template_src->len ? template_src->data[template_pos++] : EOF;
+}
+
+/*
+ * Build the workload once into the binary template: scan benchmark_ir,
+ * or generate `synth` when its funcs > 0. Returns 0 on success.
+ */
+static int benchmark_template_init(const synth_config_t *synth) {
+    MIR_context_t ctx = MIR_init();
+    if (synth->funcs > 0) {
+        if (build_synthetic_module(ctx, synth) == NULL) {
+            MIR_finish(ctx);
+            return -1;
+        }
+    } else {
+        MIR_scan_string(ctx, benchmark_ir);
+    }
+    benchmark_nmodules = 0;
+    for (MIR_module_t m = DLIST_HEAD(MIR_module_t, *MIR_get_module_list(ctx)); m != NULL;
+         m = DLIST_NEXT(MIR_module_t, m))
+        benchmark_nmodules++;
+    template_sink = &benchmark_template;
+    MIR_write_with_func(ctx, template_writer);
+    template_sink = NULL;
+    MIR_finish(ctx);
+    return benchmark_template.len > 0 ? 0 : -1;
+}
+
+static void benchmark_template_free(void) {
+    free(benchmark_template.data);
+    memset(&benchmark_template, 0, sizeof(benchmark_template));
+}
+
+/*
+ * Add a fresh (unloaded) copy of the benchmark to ctx and return its first
+ * module; the copy is benchmark_nmodules modules from there on.
+ */
+static MIR_module_t benchmark_module(MIR_context_t ctx) {
+    MIR_module_t last = DLIST_TAIL(MIR_module_t, *MIR_get_module_list(ctx));
+    if (benchmark_template.len > 0) {
+        template_src = &benchmark_template;
+        template_pos = 0;
+        MIR_read_with_func(ctx, template_reader);
+        template_src = NULL;
+    } else {
+        MIR_scan_string(ctx, benchmark_ir);
+    }
+    return last != NULL ? DLIST_NEXT(MIR_module_t, last)
+                        : DLIST_HEAD(MIR_module_t, *MIR_get_module_list(ctx));
+}
+
+typedef struct {
+    char   name[32];
+    long   bytes;    /* Machine code incl. alignment; -1 = unknown */
+    double gen_sec;  /* MIR_gen() time for this function */
+    int    insns;    /* Post-link IR handed to MIR_gen() */
+    int    live;     /* Its peak live registers (func_pressure) */
+} code_func_t;
+
+typedef struct {
+    double times[MAX_RUNS];
+    uint64_t cycles[MAX_RUNS];  /* rdtscp deltas per run, 0 when not recorded */
+    int    runs;     /* Valid entries in times[] */
+    int    warmups;  /* Warmup calls made (all contexts) */
+    double setup_sec;  /* Total context build + load + mutate + link time */
+    /* Cost side. Sums over `compiles` contexts; per-function data from the first */
+    int    compiles;
+    double link_sec;   /* MIR_link(): resolution + MIR_INLINE expansion */
+    double gen_sec;    /* MIR_gen() over every function */
+    long   code_bytes; /* Sum of known code_funcs[].bytes */
+    int    ncode;
+    code_func_t code_funcs[MAX_CODE_FUNCS];
+    /* Hot-code footprint (layout_footprint), from the first compile */
+    int    hot_funcs;
+    long   hot_bytes;
+    long   hot_span;   /* First hot byte to last, -1 = across code regions */
+    long   hot_pages;  /* Distinct LAYOUT_PAGE pages holding hot code */
+    long   peak_rss_kb;  /* Process high-water mark during the condition */
+    double mean;
+    double stddev;
+    /* Robust statistics, over the runs left after outlier trimming */
+    int    trimmed;  /* Runs dropped as outliers */
+    double median;
+    double mad;      /* Median absolute deviation, scaled by 1.4826 (~SD if normal) */
+    double ci_lo;    /* 95% bootstrap CI of the median */
+    double ci_hi;
+    double median_cycles;
+    uint64_t perf[MAX_RUNS][PERF_COUNT];  /* Counter deltas per run (--perf) */
+    unsigned perf_valid;                 /* Bit i set: perf_names[i] was counted */
+    double perf_median[PERF_COUNT];
+    int    mutations;
+    int    cross_mutations;  /* Of those, sites that call into another module */
+    int64_t result;  /* Correctness check: all conditions should produce same result */
+} condition_result_t;
+
+/*
+ * Sampling plan. The published protocol is a fixed count (min_runs ==
+ * max_runs, ci_target == 0). With a ci_target, runs continue past
+ * min_runs until the bootstrap CI of the median is narrower than
+ * ci_target * median, or max_runs is reached.
+ */
+typedef struct {
+    int    min_runs;
+    int    max_runs;   /* <= MAX_RUNS */
+    double ci_target;  /* Relative CI width; 0 = fixed run count */
+    int    cycles;     /* Record rdtscp cycles around each run */
+    int    perf;       /* Record perf_event counters around each run */
+} bench_config_t;
+
+static bench_config_t bench_fixed(int nruns) {
+    bench_config_t b = {nruns, nruns, 0.0, 0, 0};
+    return b;
+}
+
+static double elapsed_sec(const struct timespec *t0, const struct timespec *t1) {
+    return (t1->tv_sec - t0->tv_sec) + (t1->tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+/* Serialising cycle counter read; 0 where rdtscp is unavailable. */
+static uint64_t read_cycles(void) {
+#ifdef HAVE_RDTSCP
+    unsigned int aux;
+    uint64_t c = __rdtscp(&aux);
+    _mm_lfence();  /* Keep the timed code from starting before the read */
+    return c;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * Hardware counters. One perf_event group per timing thread (pid 0,
+ * any cpu, user space only), led by cycles so all members are scheduled
+ * together. Members the PMU or a VM does not expose are left out; if the
+ * leader cannot be opened (no PMU, perf_event_paranoid too high) the
+ * group is unavailable and the run proceeds without counters. Deltas are
+ * scaled by time_enabled / time_running if the kernel multiplexed them.
+ */
+static const char *perf_names[PERF_COUNT] = {
+    "cycles", "instructions", "branch-misses", "L1i-misses", "iTLB-misses"
+};
+
+typedef struct {
+    int      fd[PERF_COUNT];   /* -1 = not counted */
+    int      slot[PERF_COUNT]; /* Position of counter i in the group read */
+    int      nopen;
+    unsigned valid;
+} perf_group_t;
+
+#ifdef __linux__
+static int perf_open(uint32_t type, uint64_t config, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = (group_fd == -1);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+/* Returns 0 if at least the leader (cycles) is counting. */
+static int perf_group_open(perf_group_t *g) {
+    for (int i = 0; i < PERF_COUNT; i++) g->fd[i] = g->slot[i] = -1;
+    g->nopen = 0;
+    g->valid = 0;
+#ifdef __linux__
+    static const uint32_t types[PERF_COUNT] = {
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+        PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE
+    };
+    static const uint64_t configs[PERF_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_L1I | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_ITLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+    };
+    for (int i = 0; i < PERF_COUNT; i++) {
+        int fd = perf_open(types[i], configs[i], i == 0 ? -1 : g->fd[0]);
+        if (fd < 0) {
+            if (i == 0) return -1;
+            continue;
+        }
+        g->fd[i] = fd;
+        g->slot[i] = g->nopen++;
+        g->valid |= 1u << i;
+    }
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+static void perf_group_close(perf_group_t *g) {
+#ifdef __linux__
+    for (int i = PERF_COUNT - 1; i >= 0; i--)
+        if (g->fd[i] >= 0) close(g->fd[i]);
+#endif
+    for (int i = 0; i < PERF_COUNT; i++) g->fd[i] = -1;
+    g->valid = 0;
+}
+
+static void perf_group_start(const perf_group_t *g) {
+#ifdef __linux__
+    ioctl(g->fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(g->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+    (void)g;
+#endif
+}
+
+/* Stop the group and store the (scaled) deltas in out[PERF_COUNT]. */
+static void perf_group_stop(const perf_group_t *g, uint64_t *out) {
+    memset(out, 0, PERF_COUNT * sizeof(uint64_t));
+#ifdef __linux__
+    uint64_t buf[3 + PERF_COUNT];  /* nr, time_enabled, time_running, values */
+    ioctl(g->fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    if (read(g->fd[0], buf, sizeof(buf)) < (ssize_t)(3 * sizeof(uint64_t))) return;
+    double scale = (buf[2] > 0) ? (double)buf[1] / (double)buf[2] : 1.0;
+    for (int i = 0; i < PERF_COUNT; i++)
+        if (g->slot[i] >= 0 && (uint64_t)g->slot[i] < buf[0])
+            out[i] = (uint64_t)((double)buf[3 + g->slot[i]] * scale);
+#else
+    (void)g;
+#endif
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Median of xs[0..n); sorts `scratch` (n entries) as a side effect. */
+static double sample_median(const double *xs, int n, double *scratch) {
+    if (n == 0) return 0.0;
+    memcpy(scratch, xs, n * sizeof(double));
+    qsort(scratch, n, sizeof(double), cmp_double);
+    return (n % 2) ? scratch[n / 2] : 0.5 * (scratch[n / 2 - 1] + scratch[n / 2]);
+}
+
+static double sample_mad(const double *xs, int n, double med, double *scratch) {
+    double dev[MAX_RUNS];
+    for (int i = 0; i < n; i++) dev[i] = fabs(xs[i] - med);
+    return 1.4826 * sample_median(dev, n, scratch);
+}
+
+/*
+ * summarize_times: Trim runs more than OUTLIER_K scaled MADs from the
+ * median, then compute median, MAD and a percentile bootstrap 95% CI of
+ * the median on what is left. Returns the number of runs trimmed.
+ */
+static int summarize_times(const double *xs, int n, double *median, double *mad,
+                           double *ci_lo, double *ci_hi) {
+    double scratch[MAX_RUNS], kept[MAX_RUNS], sample[MAX_RUNS];
+    static _Thread_local double boot[BOOTSTRAP_RESAMPLES];
+
+    double med = sample_median(xs, n, scratch);
+    double m = sample_mad(xs, n, med, scratch);
+    int nk = 0;
+    for (int i = 0; i < n; i++)
+        if (m == 0.0 || fabs(xs[i] - med) <= OUTLIER_K * m) kept[nk++] = xs[i];
+
+    *median = sample_median(kept, nk, scratch);
+    *mad = sample_mad(kept, nk, *median, scratch);
+
+    unsigned int rng = RANDOM_SEED ^ (unsigned int)nk;
+    for (int b = 0; b < BOOTSTRAP_RESAMPLES; b++) {
+        for (int i = 0; i < nk; i++) {
+            rng ^= rng << 13;
+            rng ^= rng >> 17;
+            rng ^= rng << 5;
+            sample[i] = kept[rng % (unsigned int)nk];
+        }
+        boot[b] = sample_median(sample, nk, scratch);
+    }
+    qsort(boot, BOOTSTRAP_RESAMPLES, sizeof(double), cmp_double);
+    *ci_lo = boot[(int)(0.025 * (BOOTSTRAP_RESAMPLES - 1))];
+    *ci_hi = boot[(int)ceil(0.975 * (BOOTSTRAP_RESAMPLES - 1))];
+    return n - nk;
+}
+
+/*
+ * warmup_until_stable: Call the driver on WARMUP_ITERS until the last
+ * WARMUP_WINDOW calls agree to WARMUP_TOL (caches, branch predictors and
+ * page mappings settled), or WARMUP_MAX calls. Returns calls made.
+ */
+static int warmup_until_stable(int64_t (*driver_fn)(int64_t)) {
+    double window[WARMUP_WINDOW];
+    int calls = 0;
+    while (calls < WARMUP_MAX) {
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        (void)driver_fn(WARMUP_ITERS);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        window[calls % WARMUP_WINDOW] = elapsed_sec(&t0, &t1);
+        calls++;
+        if (calls < WARMUP_WINDOW) continue;
+        double lo = window[0], hi = window[0];
+        for (int i = 1; i < WARMUP_WINDOW; i++) {
+            if (window[i] < lo) lo = window[i];
+            if (window[i] > hi) hi = window[i];
+        }
+        if (lo > 0.0 && (hi - lo) / lo < WARMUP_TOL) break;
+    }
+    return calls;
+}
+
+/*
+ * Compile-cost accounting. Linking uses the lazy gen interface, so
+ * MIR_link() only resolves and expands MIR_INLINE sites; each function
+ * is then compiled by an explicit MIR_gen(), timed on its own. MIR
+ * publishes machine code sequentially, so a function's size is the
+ * distance to the next function compiled. A one-insn sentinel compiled
+ * last bounds the final one; a gap that is negative or above CODE_GAP_MAX
+ * means a new code region started and the size is reported unknown.
+ */
+static MIR_item_t code_end_sentinel(MIR_context_t ctx) {
+    MIR_new_module(ctx, "num_code_end");
+    MIR_item_t func = MIR_new_func(ctx, "num_code_end", 0, NULL, 0);
+    MIR_append_insn(ctx, func, MIR_new_ret_insn(ctx, 0));
+    MIR_finish_func(ctx);
+    MIR_finish_module(ctx);
+    MIR_load_module(ctx, DLIST_TAIL(MIR_module_t, *MIR_get_module_list(ctx)));
+    return func;
+}
+
+/*
+ * Code layout (--layout). MIR appends each function's machine code to the
+ * current code region, so the order of MIR_gen() calls is the layout. With
+ * code_layout set, functions are compiled hottest first by profile price
+ * (driver first), which packs those at or above LAYOUT_HOT_PRICE together
+ * from the start of the region and leaves the cold ones behind them rather
+ * than between them. Without it, the order is the module's.
+ */
+static int code_layout = 0;  /* Hot-first MIR_gen() order */
+static int huge_code = 0;    /* Huge-page code regions (Linux) */
+
+typedef struct {
+    MIR_item_t item;
+    double     price;
+    int        order;    /* Position in the module, the tiebreak */
+    double     gen_sec;
+    long       bytes;    /* -1 = unknown */
+} layout_entry_t;
+
+static double layout_price(const profile_map_t *prices, const char *name) {
+    if (strcmp(name, "driver") == 0) return 2.0;  /* Above any normalized price */
+    return prices != NULL ? profile_map_lambda(prices, name) : 0.0;
+}
+
+static int layout_compare_price(const void *a, const void *b) {
+    const layout_entry_t *x = a, *y = b;
+    if (x->price != y->price) return x->price > y->price ? -1 : 1;
+    return x->order - y->order;
+}
+
+static int layout_compare_addr(const void *a, const void *b) {
+    uintptr_t x = (uintptr_t)((const layout_entry_t *)a)->item->u.func->machine_code;
+    uintptr_t y = (uintptr_t)((const layout_entry_t *)b)->item->u.func->machine_code;
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * Hot-code footprint of one compile: functions priced at or above
+ * LAYOUT_HOT_PRICE (and driver), their bytes, the address span from the
+ * first to the last of them, and the distinct LAYOUT_PAGE pages they
+ * touch. That page count is the iTLB reach the hot path needs.
+ */
+static void layout_footprint(const layout_entry_t *e, int n, condition_result_t *out) {
+    out->hot_funcs = 0;
+    out->hot_bytes = 0;
+    out->hot_span = -1;
+    out->hot_pages = 0;
+    layout_entry_t *hot = malloc((size_t)(n > 0 ? n : 1) * sizeof(*hot));
+    if (hot == NULL) return;
+    int nhot = 0;
+    for (int i = 0; i < n; i++) {
+        if (e[i].price < LAYOUT_HOT_PRICE) continue;
+        out->hot_funcs++;
+        if (e[i].bytes > 0) hot[nhot++] = e[i];
+    }
+    qsort(hot, (size_t)nhot, sizeof(*hot), layout_compare_addr);
+
+    uintptr_t last = 0;  /* Highest page counted so far */
+    for (int i = 0; i < nhot; i++) {
+        uintptr_t start = (uintptr_t)hot[i].item->u.func->machine_code;
+        uintptr_t p0 = start / LAYOUT_PAGE;
+        uintptr_t p1 = (start + (uintptr_t)hot[i].bytes - 1) / LAYOUT_PAGE;
+        if (i > 0 && p0 <= last) p0 = last + 1;
+        if (p0 <= p1) out->hot_pages += (long)(p1 - p0 + 1);
+        if (i == 0 || p1 > last) last = p1;
+        out->hot_bytes += hot[i].bytes;
+    }
+    if (nhot > 0) {
+        uintptr_t lo = (uintptr_t)hot[0].item->u.func->machine_code;
+        uintptr_t hi = 0;
+        for (int i = 0; i < nhot; i++) {
+            uintptr_t end = (uintptr_t)hot[i].item->u.func->machine_code + (uintptr_t)hot[i].bytes;
+            if (end > hi) hi = end;
+        }
+        if (hi - lo < CODE_GAP_MAX) out->hot_span = (long)(hi - lo);
+    }
+    free(hot);
+}
+
+#ifdef __linux__
+/*
+ * Huge-page code regions (--huge-code). MIR maps a new code region from
+ * its code allocator whenever the current one is full. Here each region
+ * is a HUGE_CODE_PAGE-aligned block advised MADV_HUGEPAGE, so the hot code
+ * at the start of the first region can sit under a single iTLB entry.
+ * Protection changes are widened to the whole block: a partial mprotect()
+ * would split the huge page back into small ones. That is safe because no
+ * block holds more than one region.
+ */
+static size_t huge_code_size(size_t len) {
+    return (len + HUGE_CODE_PAGE - 1) / HUGE_CODE_PAGE * HUGE_CODE_PAGE;
+}
+
+static void *huge_code_map(size_t len, void *user_data) {
+    (void)user_data;
+    size_t size = huge_code_size(len);
+    /* Over-map by one block, then trim to an aligned one */
+    uint8_t *raw = mmap(NULL, size + HUGE_CODE_PAGE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return MAP_FAILED;
+    uint8_t *mem = (uint8_t *)(((uintptr_t)raw + HUGE_CODE_PAGE - 1)
+                               & ~(uintptr_t)(HUGE_CODE_PAGE - 1));
+    if (mem > raw) munmap(raw, (size_t)(mem - raw));
+    if (raw + HUGE_CODE_PAGE > mem) munmap(mem + size, (size_t)(raw + HUGE_CODE_PAGE - mem));
+    (void)madvise(mem, size, MADV_HUGEPAGE);  /* Advisory; THP may be off */
+    return mem;
+}
+
+static int huge_code_unmap(void *ptr, size_t len, void *user_data) {
+    (void)user_data;
+    return munmap(ptr, huge_code_size(len));
+}
+
+static int huge_code_protect(void *ptr, size_t len, MIR_mem_protect_t prot, void *user_data) {
+    (void)user_data;
+    uintptr_t lo = (uintptr_t)ptr & ~(uintptr_t)(HUGE_CODE_PAGE - 1);
+    size_t size = huge_code_size((uintptr_t)ptr + len - lo);
+    return mprotect((void *)lo, size, prot == PROT_WRITE_EXEC
+                                          ? PROT_READ | PROT_WRITE | PROT_EXEC
+                                          : PROT_READ | PROT_EXEC);
+}
+
+static struct MIR_code_alloc huge_code_alloc = {
+    huge_code_map, huge_code_unmap, huge_code_protect, NULL
+};
+#endif
+
+/* Context for the measured compile path; --huge-code swaps the code allocator */
+static MIR_context_t code_context_init(void) {
+#ifdef __linux__
+    if (huge_code) return MIR_init2(NULL, &huge_code_alloc);
+#endif
+    return MIR_init();
+}
+
+/*
+ * Generate all functions of `m` (in layout order), then `sentinel`.
+ * Returns total gen time.
+ */
+static double generate_module(MIR_context_t ctx, MIR_module_t m, MIR_item_t sentinel,
+                              const profile_map_t *prices, condition_result_t *out,
+                              int record) {
+    int n = 0;
+    for (MIR_item_t item = workload_first_item(m); item != NULL;
+         item = workload_next_item(m, item))
+        if (item->item_type == MIR_func_item) n++;
+    layout_entry_t *order = malloc((size_t)(n > 0 ? n : 1) * sizeof(*order));
+    if (order == NULL) {
+        fprintf(stderr, "WARNING: no memory for the compile order; code is generated lazily\n");
+        return 0.0;
+    }
+    n = 0;
+    for (MIR_item_t item = workload_first_item(m); item != NULL;
+         item = workload_next_item(m, item)) {
+        if (item->item_type != MIR_func_item) continue;
+        order[n].item = item;
+        order[n].price = layout_price(prices, item->u.func->name);
+        order[n].order = n;
+        n++;
+    }
+    if (code_layout) qsort(order, (size_t)n, sizeof(*order), layout_compare_price);
+
+    double total = 0.0;
+    for (int i = 0; i < n; i++) {
+        MIR_item_t item = order[i].item;
+        if (record && i < MAX_CODE_FUNCS) {
+            /* Generator input: inlining is already expanded by MIR_link() */
+            code_func_t *cf = &out->code_funcs[i];
+            cf->insns = 0;
+            for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, item->u.func->insns); insn != NULL;
+                 insn = DLIST_NEXT(MIR_insn_t, insn))
+                cf->insns++;
+            cf->live = func_pressure(item->u.func, NULL, NULL, 0);
+        }
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        MIR_gen(ctx, item);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        order[i].gen_sec = elapsed_sec(&t0, &t1);
+        total += order[i].gen_sec;
+    }
+    MIR_gen(ctx, sentinel);
+
+    for (int i = 0; i < n; i++) {
+        MIR_item_t next = i + 1 < n ? order[i + 1].item : sentinel;
+        intptr_t gap = (intptr_t)next->u.func->machine_code
+                     - (intptr_t)order[i].item->u.func->machine_code;
+        order[i].bytes = (gap > 0 && gap < CODE_GAP_MAX) ? (long)gap : -1;
+        metrics_compile(order[i].item->u.func->name, order[i].gen_sec, order[i].bytes);
+    }
+    if (record) {
+        out->ncode = n < MAX_CODE_FUNCS ? n : MAX_CODE_FUNCS;
+        out->code_bytes = 0;
+        for (int i = 0; i < out->ncode; i++) {
+            code_func_t *cf = &out->code_funcs[i];
+            snprintf(cf->name, sizeof(cf->name), "%s", order[i].item->u.func->name);
+            cf->gen_sec = order[i].gen_sec;
+            cf->bytes = order[i].bytes;
+            if (cf->bytes > 0) out->code_bytes += cf->bytes;
+        }
+        layout_footprint(order, n, out);
+    }
+    free(order);
+    return total;
+}
+
+/*
+ * Peak RSS. On Linux the high-water mark is reset per condition through
+ * /proc/self/clear_refs (Linux 4.0+) and read from VmHWM; elsewhere it is
+ * the process lifetime peak. Process-wide either way, so under --parallel
+ * it covers all conditions running at the time.
+ */
+static void peak_rss_reset(void) {
+#ifdef __linux__
+    FILE *f = fopen("/proc/self/clear_refs", "w");
+    if (f != NULL) {
+        fputs("5", f);
+        fclose(f);
+    }
+#endif
+}
+
+static long peak_rss_kb(void) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return (long)(pmc.PeakWorkingSetSize / 1024);
+    return 0;
+#else
+#ifdef __linux__
+    char line[128];
+    long kb = -1;
+    FILE *f = fopen("/proc/self/status", "r");
+    if (f != NULL) {
+        while (fgets(line, sizeof(line), f) != NULL)
+            if (sscanf(line, "VmHWM: %ld", &kb) == 1) break;
+        fclose(f);
+    }
+    if (kb >= 0) return kb;
+#endif
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+#ifdef __APPLE__
+    return ru.ru_maxrss / 1024;  /* Bytes on macOS */
+#else
+    return ru.ru_maxrss;
+#endif
+#endif
+}
+
+/*
+ * run_condition: Time runs of the benchmark under one condition, as many
+ * as `bench` asks for. Returns 0 on success, -1 if 'driver' is missing.
+ *
+ * By default every run builds its own context, as in the published
+ * protocol. With `reuse_code`, one context is built, mutated and linked
+ * per condition and every run times the same machine code. That is sound
+ * because the mutated IR is identical across runs (the RNG is reset per
+ * run), and it models a long-lived production context.
+ */
+static int run_condition(experiment_condition_t condition,
+                         const profile_map_t *profile,
+                         int growth_budget, const bench_config_t *bench,
+                         int reuse_code, condition_result_t *out) {
+    memset(out, 0, sizeof(*out));
+    unsigned int rng_state = RANDOM_SEED;
+    int max_runs = bench->max_runs > MAX_RUNS ? MAX_RUNS : bench->max_runs;
+    int adaptive = bench->ci_target > 0.0;
+
+    MIR_context_t ctx = NULL;
+    typedef int64_t (*driver_fn_t)(int64_t);
+    driver_fn_t driver_fn = NULL;
+
+    /* Opened on this thread: counters follow the thread that times */
+    perf_group_t perf;
+    int use_perf = bench->perf && perf_group_open(&perf) == 0;
+    if (bench->perf && !use_perf)
+        fprintf(stderr, "WARNING: perf_event_open failed; no hardware counters "
+                        "(check /proc/sys/kernel/perf_event_paranoid)\n");
+    out->perf_valid = use_perf ? perf.valid : 0;
+    peak_rss_reset();
+
+    for (int run = 0; run < max_runs; run++) {
+        if (ctx == NULL) {
+            struct timespec s0, s1;
+            clock_gettime(CLOCK_MONOTONIC, &s0);
+
+            /* Step 1: Fresh context */
+            ctx = code_context_init();
+            MIR_gen_init(ctx);
+            MIR_gen_set_optimize_level(ctx, 2);  /* O2 for full optimization */
+
+            /* Step 2: Read IR (binary template, no re-parse) */
+            MIR_module_t m = benchmark_module(ctx);
+
+            /* Step 3: Load module (makes items traversable) */
+            workload_load(ctx, m);
+
+            /* Step 4: Mutate (between load and link) */
+            func_cache_t fc;
+            func_cache_build(ctx, m, &fc);
+            rng_state = RANDOM_SEED;  /* Reset RNG per run for reproducibility */
+            int muts = mutate_module(condition, profile, &fc, growth_budget, &rng_state);
+            if (muts < 0) {
+                func_cache_free(&fc);
+                MIR_gen_finish(ctx);
+                MIR_finish(ctx);
+                if (use_perf) perf_group_close(&perf);
+                return -1;
+            }
+            if (run == 0) {
+                out->mutations = muts;
+                out->cross_mutations = count_cross_module_sites(&fc, 1);
+            }
+            func_cache_free(&fc);
+
+            /* Step 5: Link (expands MIR_INLINE), then JIT compile each function */
+            MIR_item_t sentinel = code_end_sentinel(ctx);
+            struct timespec l0, l1;
+            clock_gettime(CLOCK_MONOTONIC, &l0);
+            MIR_link(ctx, MIR_set_lazy_gen_interface, NULL);
+            clock_gettime(CLOCK_MONOTONIC, &l1);
+            out->link_sec += elapsed_sec(&l0, &l1);
+            metrics_link(elapsed_sec(&l0, &l1));
+            out->gen_sec += generate_module(ctx, m, sentinel, profile, out,
+                                            out->compiles == 0);
+            out->compiles++;
+
+            /* Step 6: Find driver function */
+            MIR_item_t driver_item = find_func_item(m, "driver");
+
+            if (driver_item == NULL || driver_item->addr == NULL) {
+                fprintf(stderr, "ERROR: Could not find/compile 'driver'\n");
+                MIR_gen_finish(ctx);
+                MIR_finish(ctx);
+                if (use_perf) perf_group_close(&perf);
+                return -1;
+            }
+            driver_fn = (driver_fn_t)driver_item->addr;
+
+            clock_gettime(CLOCK_MONOTONIC, &s1);
+            out->setup_sec += elapsed_sec(&s0, &s1);
+
+            /* Adaptive: warm fresh code until its timings settle */
+            if (adaptive) out->warmups += warmup_until_stable(driver_fn);
+        }
+
+        /* Warmup */
+        (void)driver_fn(WARMUP_ITERS);
+        out->warmups++;
+
+        /* Timed execution */
+        struct timespec t0, t1;
+        if (use_perf) perf_group_start(&perf);
+        uint64_t c0 = bench->cycles ? read_cycles() : 0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        int64_t result = driver_fn(bench_iters);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        uint64_t c1 = bench->cycles ? read_cycles() : 0;
+        if (use_perf) perf_group_stop(&perf, out->perf[run]);
+
+        out->times[run] = elapsed_sec(&t0, &t1);
+        out->cycles[run] = c1 - c0;
+        out->runs = run + 1;
+        if (run == 0) out->result = result;
+
+        /* Step 7: Tear down (kept alive across runs when reusing code) */
+        if (!reuse_code) {
+            MIR_gen_finish(ctx);
+            MIR_finish(ctx);
+            ctx = NULL;
+        }
+
+        /* Adaptive stopping rule: CI of the median narrow enough */
+        if (adaptive && out->runs >= bench->min_runs) {
+            double med, mad, lo, hi;
+            summarize_times(out->times, out->runs, &med, &mad, &lo, &hi);
+            if (med > 0.0 && (hi - lo) / med < bench->ci_target) break;
+        }
+    }
+    if (ctx != NULL) {
+        MIR_gen_finish(ctx);
+        MIR_finish(ctx);
+    }
+    if (use_perf) perf_group_close(&perf);
+    out->peak_rss_kb = peak_rss_kb();
+
+    /* Compute statistics */
+    int nruns = out->runs;
+    double sum = 0, sum2 = 0;
+    for (int i = 0; i < nruns; i++) sum += out->times[i];
+    out->mean = sum / nruns;
+    for (int i = 0; i < nruns; i++) {
+        double d = out->times[i] - out->mean;
+        sum2 += d * d;
+    }
+    out->stddev = (nruns > 1) ? sqrt(sum2 / (nruns - 1)) : 0.0;
+
+    out->trimmed = summarize_times(out->times, nruns, &out->median, &out->mad,
+                                   &out->ci_lo, &out->ci_hi);
+    if (bench->cycles) {
+        double cyc[MAX_RUNS], scratch[MAX_RUNS];
+        for (int i = 0; i < nruns; i++) cyc[i] = (double)out->cycles[i];
+        out->median_cycles = sample_median(cyc, nruns, scratch);
+    }
+    for (int k = 0; k < PERF_COUNT; k++) {
+        if (!(out->perf_valid & (1u << k))) continue;
+        double v[MAX_RUNS], scratch[MAX_RUNS];
+        for (int i = 0; i < nruns; i++) v[i] = (double)out->perf[i][k];
+        out->perf_median[k] = sample_median(v, nruns, scratch);
+    }
+
+    return 0;
+}
+
+/*
+ * Parallel condition runner (--parallel).
+ *
+ * One thread per condition, each with its own MIR context (run_condition()
+ * shares only read-only state: the profile and the IR template). Each
+ * thread pins itself to its own core and, where cpufreq allows it, locks
+ * that core's frequency (performance governor, min = max) for the
+ * duration, restoring the previous settings afterwards. Frequency locking
+ * needs write access to /sys/devices/system/cpu/cpuN/cpufreq; without it
+ * the run continues with a warning.
+ *
+ * For clean numbers the cores should be isolated (isolcpus= / nohz_full=)
+ * and must not be SMT siblings of each other.
+ */
+typedef struct {
+    char governor[64];
+    char min_freq[32];
+    int  saved;
+} cpu_freq_state_t;
+
+#ifdef __linux__
+static int cpufreq_read(int cpu, const char *file, char *buf, size_t len) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/%s", cpu, file);
+    FILE *f = fopen(path, "r");
+    if (f == NULL) return -1;
+    int ok = fgets(buf, (int)len, f) != NULL;
+    fclose(f);
+    if (!ok) return -1;
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+static int cpufreq_write(int cpu, const char *file, const char *val) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/%s", cpu, file);
+    FILE *f = fopen(path, "w");
+    if (f == NULL) return -1;
+    int ok = fputs(val, f) >= 0;
+    ok = (fclose(f) == 0) && ok;
+    return ok ? 0 : -1;
+}
+#endif
+
+/* Returns 0 if the core now runs at a fixed frequency, -1 otherwise. */
+static int cpu_freq_lock(int cpu, cpu_freq_state_t *st) {
+    memset(st, 0, sizeof(*st));
+#ifdef __linux__
+    char max_freq[32];
+    if (cpufreq_read(cpu, "scaling_governor", st->governor, sizeof(st->governor)) != 0 ||
+        cpufreq_read(cpu, "scaling_min_freq", st->min_freq, sizeof(st->min_freq)) != 0 ||
+        cpufreq_read(cpu, "scaling_max_freq", max_freq, sizeof(max_freq)) != 0)
+        return -1;
+    st->saved = 1;
+    if (cpufreq_write(cpu, "scaling_governor", "performance") != 0 ||
+        cpufreq_write(cpu, "scaling_min_freq", max_freq) != 0)
+        return -1;
+    return 0;
+#else
+    (void)cpu;
+    return -1;
+#endif
+}
+
+static void cpu_freq_restore(int cpu, const cpu_freq_state_t *st) {
+#ifdef __linux__
+    if (!st->saved) return;
+    cpufreq_write(cpu, "scaling_min_freq", st->min_freq);
+    cpufreq_write(cpu, "scaling_governor", st->governor);
+#else
+    (void)cpu;
+    (void)st;
+#endif
+}
+
+/* Pin the calling thread to `cpu`. Returns 0 on success. */
+static int pin_to_cpu(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 ? 0 : -1;
+#else
+    (void)cpu;
+    return -1;
+#endif
+}
+
+typedef struct {
+    experiment_condition_t condition;
+    const profile_map_t   *profile;
+    const bench_config_t  *bench;
+    int                    growth_budget;
+    int                    reuse_code;
+    int                    cpu;
+    int                    pinned;     /* Out: affinity applied */
+    int                    freq_locked; /* Out: frequency fixed */
+    int                    status;     /* Out: run_condition() return */
+    condition_result_t     result;
+} condition_job_t;
+
+static void *condition_job_run(void *arg) {
+    condition_job_t *job = arg;
+    cpu_freq_state_t freq;
+    job->pinned = pin_to_cpu(job->cpu) == 0;
+    job->freq_locked = cpu_freq_lock(job->cpu, &freq) == 0;
+    job->status = run_condition(job->condition, job->profile, job->growth_budget,
+                                job->bench, job->reuse_code, &job->result);
+    cpu_freq_restore(job->cpu, &freq);
+    return NULL;
+}
+
+/*
+ * run_conditions_parallel: Run every condition concurrently, condition c
+ * on cores[c]. Results land in results[c]. Returns 0 if all succeeded.
+ */
+static int run_conditions_parallel(const profile_map_t *profile, int growth_budget,
+                                   const bench_config_t *bench,
+                                   int reuse_code, const int *cores,
+                                   condition_result_t *results) {
+    condition_job_t jobs[COND_COUNT];
+    pthread_t threads[COND_COUNT];
+
+    for (int c = 0; c < COND_COUNT; c++)
+        for (int k = 0; k < c; k++)
+            if (cores[k] == cores[c])
+                fprintf(stderr, "WARNING: conditions %d and %d share cpu %d; timings will interfere\n",
+                        k + 1, c + 1, cores[c]);
+
+    for (int c = 0; c < COND_COUNT; c++) {
+        memset(&jobs[c], 0, sizeof(jobs[c]));
+        jobs[c].condition = (experiment_condition_t)c;
+        jobs[c].profile = profile;
+        jobs[c].bench = bench;
+        jobs[c].growth_budget = growth_budget;
+        jobs[c].reuse_code = reuse_code;
+        jobs[c].cpu = cores[c];
+        jobs[c].status = -1;
+        if (pthread_create(&threads[c], NULL, condition_job_run, &jobs[c]) != 0) {
+            for (int k = 0; k < c; k++) pthread_join(threads[k], NULL);
+            return -1;
+        }
+    }
+
+    int rc = 0;
+    for (int c = 0; c < COND_COUNT; c++) {
+        pthread_join(threads[c], NULL);
+        results[c] = jobs[c].result;
+        if (jobs[c].status != 0) rc = -1;
+        printf("    [cpu %d] %s%s%s\n", jobs[c].cpu, condition_names[c], jobs[c].pinned ? "" : " (NOT pinned)",
+               jobs[c].freq_locked ? ", freq locked" : "");
+    }
+    return rc;
+}
+
+/* ========================================================================
+ * SECTION 7: ITERATIVE PRICE UPDATES (dual ascent, --iterative)
+ *
+ * The one-shot formula fixes lambda = call_count / max_count once. Here
+ * prices are adjusted over rounds of mutate -> measure, like a NUM solver:
+ *
+ *   p_f = clamp(lambda_f * beta_f - mu * w_f / MIR_INLINE_THRESHOLD, 0, 1)
+ *
+ * and each call site into f is priced the same way from its own profiled
+ * lambda, with f's beta_f and w_f.
+ *
+ *   mu      price of code growth. Subgradient step on demand vs supply:
+ *           mu <- max(0, mu + ITER_STEP * (G - B) / B), where G is the
+ *           growth the promoted set asks for and B = min(budget, sum of
+ *           MIR caller caps) is what MIR will actually grant.
+ *   beta_f  per-function benefit multiplier, learned from the measured
+ *           speedup of the rounds in which f's promotion flipped: a flip
+ *           that paid off (or a demotion that hurt) raises beta_f, one
+ *           that made no measurable difference lowers it.
+ *
+ * Round 0 (mu = 0, beta = 1) is exactly the one-shot COND_SHADOW_PRICE
+ * formula. Stops once the promoted set and mu are stable, or after
+ * ITER_MAX_ROUNDS.
+ * ======================================================================== */
+
+/*
+ * dry_run_promotions: Mutate a scratch copy of the benchmark under
+ * COND_SHADOW_PRICE with `prices` and report, per profile entry, whether
+ * any call site of it was promoted. Also returns the requested growth
+ * (sum of promoted callee sizes) and total MIR cap over callers that have
+ * candidate sites. Returns the number of promotions.
+ */
+static int dry_run_promotions(const profile_map_t *prices, unsigned char *promoted,
+                              int *growth, int *supply) {
+    MIR_context_t ctx = MIR_init();
+    MIR_module_t m = benchmark_module(ctx);
+    workload_load(ctx, m);
+    func_cache_t fc;
+    func_cache_build(ctx, m, &fc);
+
+    unsigned int rng_state = RANDOM_SEED;
+    int muts = mutate_module(COND_SHADOW_PRICE, prices, &fc, 0, &rng_state);
+
+    memset(promoted, 0, (size_t)prices->count);
+    *growth = 0;
+    *supply = 0;
+    for (int c = 0; c < fc.count; c++) {
+        int has_sites = 0;
+        MIR_func_t func = fc.funcs[c].item->u.func;
+        for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, func->insns);
+             insn != NULL;
+             insn = DLIST_NEXT(MIR_insn_t, insn)) {
+            if (insn->code != MIR_CALL && insn->code != MIR_INLINE) continue;
+            const func_info_t *callee = func_cache_get(&fc, insn->ops[1].u.ref);
+            if (callee == NULL) continue;
+            has_sites = 1;
+            if (insn->code != MIR_INLINE) continue;
+            *growth += callee->insns;
+            const profile_entry_t *pe = profile_map_get(prices, callee->name);
+            if (pe) promoted[pe - prices->entries] = 1;
+        }
+        if (has_sites) *supply += knapsack_caller_cap(&fc.funcs[c]);
+    }
+
+    func_cache_free(&fc);
+    MIR_finish(ctx);
+    return muts;
+}
+
+/*
+ * run_iterative: Dual-ascent loop. Prints a per-round trace of mu, prices,
+ * mutations, growth and timing, then the one-shot vs settled comparison.
+ * Returns 0 on success, -1 on failure.
+ */
+static int run_iterative(const profile_map_t *profile, int growth_budget,
+                         int max_rounds, int reuse_code) {
+    int n = profile->count;
+    profile_map_t prices;
+    profile_map_init(&prices);
+    int copied = profile_map_copy(&prices, profile);
+
+    double *beta = malloc((size_t)n * sizeof(double));
+    int *weight = calloc((size_t)n, sizeof(int));
+    unsigned char *promoted = calloc((size_t)n, 1);
+    unsigned char *prev = calloc((size_t)n, 1);
+    int *site_callee = malloc(((size_t)prices.nsites + 1) * sizeof(int));  /* Entry, -1 = none */
+    if (copied != 0 || beta == NULL || weight == NULL || promoted == NULL || prev == NULL ||
+        site_callee == NULL) {
+        free(beta); free(weight); free(promoted); free(prev); free(site_callee);
+        profile_map_free(&prices);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) beta[i] = 1.0;
+    for (int j = 0; j < prices.nsites; j++) {
+        const profile_entry_t *pe = profile_map_get(&prices, prices.sites[j].callee);
+        site_callee[j] = pe ? (int)(pe - prices.entries) : -1;
+    }
+
+    /* Callee sizes by profile entry */
+    {
+        MIR_context_t ctx = MIR_init();
+        MIR_module_t m = benchmark_module(ctx);
+        workload_load(ctx, m);
+        func_cache_t fc;
+        func_cache_build(ctx, m, &fc);
+        for (int k = 0; k < fc.count; k++) {
+            const profile_entry_t *pe = profile_map_get(&prices, fc.funcs[k].name);
+            if (pe) weight[pe - prices.entries] = fc.funcs[k].insns;
+        }
+        func_cache_free(&fc);
+        MIR_finish(ctx);
+    }
+
+    printf("\n================================================================\n");
+    printf("ITERATIVE DUAL ASCENT (max %d rounds, %d runs/round, budget=%d)\n",
+           max_rounds, ITER_RUNS, growth_budget);
+    printf("================================================================\n");
+    printf("round,mu,mutations,growth,supply,mean_sec,sd_sec\n");
+
+    bench_config_t iter_bench = bench_fixed(ITER_RUNS);
+    double mu = 0.0, prev_mean = 0.0;
+    int oneshot_muts = 0, best_round = 0, best_muts = 0;
+    double oneshot_mean = 0.0, best_mean = 0.0;
+    int rc = 0;
+
+    for (int round = 0; round < max_rounds; round++) {
+        for (int i = 0; i < n; i++) {
+            double p = profile->entries[i].shadow_price * beta[i]
+                     - mu * weight[i] / (double)MIR_INLINE_THRESHOLD;
+            if (p < 0.0) p = 0.0;
+            if (p > 1.0) p = 1.0;
+            prices.entries[i].shadow_price = p;
+        }
+        for (int j = 0; j < prices.nsites; j++) {
+            int i = site_callee[j];
+            if (i < 0) continue;
+            double p = profile->sites[j].shadow_price * beta[i]
+                     - mu * weight[i] / (double)MIR_INLINE_THRESHOLD;
+            if (p < 0.0) p = 0.0;
+            if (p > 1.0) p = 1.0;
+            prices.sites[j].shadow_price = p;
+        }
+
+        int growth, supply;
+        dry_run_promotions(&prices, promoted, &growth, &supply);
+
+        condition_result_t res;
+        if (run_condition(COND_SHADOW_PRICE, &prices, growth_budget, &iter_bench,
+                          reuse_code, &res) != 0) {
+            rc = -1;
+            break;
+        }
+
+        printf("%d,%.4f,%d,%d,%d,%.6f,%.6f\n",
+               round, mu, res.mutations, growth, supply, res.mean, res.stddev);
+        for (int i = 0; i < n; i++) {
+            printf("  price,%d,%s,%.4f,%s\n", round, prices.entries[i].func_name,
+                   prices.entries[i].shadow_price, promoted[i] ? "inline" : "call");
+        }
+
+        if (round == 0) {
+            oneshot_muts = best_muts = res.mutations;
+            oneshot_mean = best_mean = res.mean;
+        } else if (res.mean <= oneshot_mean * (1.0 + ITER_NOISE) &&
+                   res.mutations < best_muts) {
+            best_round = round;
+            best_muts = res.mutations;
+            best_mean = res.mean;
+        }
+
+        /* Benefit update from flips (needs a previous round to compare) */
+        int changed = (round == 0);
+        if (round > 0) {
+            double speedup = (prev_mean - res.mean) / prev_mean;
+            for (int i = 0; i < n; i++) {
+                if (promoted[i] == prev[i]) continue;
+                changed = 1;
+                int paid_off = promoted[i] ? (speedup > ITER_NOISE)
+                                           : (speedup < -ITER_NOISE);
+                beta[i] *= paid_off ? (1.0 + ITER_STEP) : (1.0 - ITER_STEP);
+            }
+        }
+
+        /* Subgradient step on the growth price */
+        double capacity = growth_budget < supply ? growth_budget : supply;
+        if (capacity < 1.0) capacity = 1.0;
+        double new_mu = mu + ITER_STEP * (growth - capacity) / capacity;
+        if (new_mu < 0.0) new_mu = 0.0;
+
+        memcpy(prev, promoted, (size_t)n);
+        prev_mean = res.mean;
+        if (!changed && fabs(new_mu - mu) < ITER_MU_TOL) {
+            printf("Converged after %d rounds\n", round + 1);
+            break;
+        }
+        mu = new_mu;
+    }
+
+    if (rc == 0) {
+        printf("\n  One-shot (round 0): %d mutations, mean=%.4f s\n",
+               oneshot_muts, oneshot_mean);
+        printf("  Settled  (round %d): %d mutations, mean=%.4f s (%+.1f%%)\n",
+               best_round, best_muts, best_mean,
+               100.0 * (best_mean - oneshot_mean) / oneshot_mean);
+    }
+
+    free(beta); free(weight); free(promoted); free(prev); free(site_callee);
+    profile_map_free(&prices);
+    return rc;
+}
+
+/* ========================================================================
+ * SECTION 8: TIERED JIT (--tiered)
  *
- * Total callee insns if all inlined: 55+75+100+60+80+120+150+180 = 820
- * Driver starts at ~40 insns. Growth to ~860 = 2150% >> 150% budget.
- * MIR growth check: caller > 150% original AND > 200 insns -> stop inlining.
- * So blind-all will inline the first few and then hit the ceiling.
- * Shadow-price should inline hot functions first (highest value per budget).
+ * Tier 0: every function starts lazily compiled at O0 (compiled on first
+ * call, so cold code that never runs is never compiled) with the
+ * call-count probe from instrument_module(). After TIER_TRIGGER_N driver
+ * iterations the counts are normalised into shadow prices; the entry and
+ * every function at or above TIER_UP_PRICE are hot.
+ *
+ * Tier 1: call sites in hot callers are promoted by the shadow-price rule,
+ * hot functions are compiled at O2 and everything else is left to lazy
+ * O0. The entry point then swaps from the tier-0 to the tier-1 driver.
+ *
+ * MIR expands MIR_INLINE during MIR_link() and cannot relink a function
+ * that is already linked, so tier 1 is a second context built from the IR
+ * template rather than an in-place recompile. The swap happens between
+ * driver calls; there is no on-stack replacement.
+ * ======================================================================== */
+
+/*
+ * tier_func_count: Tier-0 probe counters (and dispatch slots) to allocate
+ * for `m`: one per function, capped at TIER_MAX_FUNCS with a warning, in
+ * which case functions past the cap go unprobed and stay cold.
  */
-"  driver: func i64, i64:n\n"
-"    local i64:i, i64:sum, i64:tmp, i64:mod\n"
-"    mov i, 0\n"
-"    mov sum, 0\n"
-"  loop:\n"
-"    bge done, i, n\n"
-/* Hot: every iteration */
-"    call p_f_hot1, f_hot1, sum, 1, sum\n"
-"    call p_f_hot2, f_hot2, tmp, 1, sum\n"
-"    add sum, sum, tmp\n"
-"    call p_f_hot3, f_hot3, tmp, 1, sum\n"
-"    add sum, sum, tmp\n"
-"    call p_f_hot4, f_hot4, tmp, 1, sum\n"
-"    add sum, sum, tmp\n"
-/* Warm: every 10th iteration */
-"    mod mod, i, 10\n"
-"    bne skip_warm, mod, 0\n"
-"    call p_f_warm1, f_warm1, tmp, 1, sum\n"
-"    add sum, sum, tmp\n"
-"    call p_f_warm2, f_warm2, tmp, 1, sum\n"
-"    add sum, sum, tmp\n"
-"  skip_warm:\n"
-/* Cold: every 1000th iteration */
-"    mod mod, i, 1000\n"
-"    bne skip_cold, mod, 0\n"
-"    call p_f_cold1, f_cold1, tmp, 1, sum\n"
-"    add sum, sum, tmp\n"
-"    call p_f_cold2, f_cold2, tmp, 1, sum\n"
-"    add sum, sum, tmp\n"
-"  skip_cold:\n"
-"    add i, i, 1\n"
-"    jmp loop\n"
-"  done:\n"
-"    ret sum\n"
-"  endfunc\n"
-"endmodule\n";
+static int tier_func_count(MIR_module_t m) {
+    int n = 0;
+    for (MIR_item_t item = workload_first_item(m);
+         item != NULL;
+         item = workload_next_item(m, item)) {
+        if (item->item_type == MIR_func_item) n++;
+    }
+    if (n > TIER_MAX_FUNCS) {
+        fprintf(stderr, "WARNING: %d functions exceed TIER_MAX_FUNCS (%d); "
+                "tier 0 probes only the first %d\n", n, TIER_MAX_FUNCS, TIER_MAX_FUNCS);
+        n = TIER_MAX_FUNCS;
+    }
+    return n;
+}
+
+static int tier_is_hot(const profile_map_t *prices, const char *name) {
+    return strcmp(name, "driver") == 0 ||
+           profile_map_lambda(prices, name) >= TIER_UP_PRICE;
+}
+
+static int tier_decide(const func_info_t *caller, int index, MIR_insn_t call,
+                       const func_info_t *callee, int callee_size, void *arg) {
+    const profile_map_t *prices = arg;
+    if (!tier_is_hot(prices, caller->name)) return 0;
+    double lambda = profile_site_lambda(prices, caller->name, index, callee->name);
+    return price_promotes(lambda, 0, call, callee, callee_size);
+}
+
+/*
+ * Promote call sites of hot callers; the COND_SHADOW_PRICE rule per site.
+ * Returns the number of promotions, or -1 (after printing an error).
+ */
+static int tier_promote(const profile_map_t *prices, const func_cache_t *fc) {
+    int mutations = plan_inlining(fc, tier_decide, (void *)prices);
+    if (mutations < 0) {
+        fprintf(stderr, "ERROR: out of memory planning tier-up\n");
+        return -1;
+    }
+    metrics_add(&metrics->tier_promotions, (uint64_t)mutations);
+    return mutations;
+}
+
+typedef struct {
+    double tier0_setup;  /* Context + O0 lazy link */
+    double tier0_run;    /* TIER_TRIGGER_N iterations, incl. lazy O0 compiles */
+    double tier1_setup;  /* Promote + link + O2 for hot functions */
+    int    hot;
+    int    mutations;
+    double time;         /* Timed driver(bench_iters) run on tier-1 code */
+    int64_t result;
+} tier_run_t;
+
+/*
+ * tier_run: One tiered lifecycle, tier 0 through a timed tier-1 run. If
+ * `prices_out` is not NULL it receives the tier-0 prices on success
+ * (caller frees); on failure it is left unset. Returns 0 on success.
+ */
+static int tier_run(tier_run_t *tr, profile_map_t *prices_out) {
+    typedef int64_t (*driver_fn_t)(int64_t);
+    struct timespec t0, t1, t2, t3;
+    memset(tr, 0, sizeof(*tr));
+
+    /* Tier 0: O0, lazy, probed */
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    MIR_context_t ctx0 = MIR_init();
+    MIR_gen_init(ctx0);
+    MIR_gen_set_optimize_level(ctx0, 0);
+    MIR_module_t m0 = benchmark_module(ctx0);
+    workload_load(ctx0, m0);
+    int nprobe = tier_func_count(m0);
+    _Atomic uint64_t *counters = calloc((size_t)nprobe + 1, sizeof(*counters));
+    const char **names = calloc((size_t)nprobe + 1, sizeof(const char *));
+    int n = 0;
+    if (counters != NULL && names != NULL) {
+        for (int i = 0; i < nprobe; i++) atomic_init(&counters[i], 0);
+        n = instrument_module(ctx0, m0, counters, names, nprobe);
+    }
+    MIR_link(ctx0, MIR_set_lazy_gen_interface, NULL);
+    MIR_item_t driver0 = find_func_item(m0, "driver");
+    if (counters == NULL || names == NULL || driver0 == NULL || driver0->addr == NULL) {
+        free(counters);
+        free(names);
+        MIR_gen_finish(ctx0);
+        MIR_finish(ctx0);
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    (void)((driver_fn_t)driver0->addr)(TIER_TRIGGER_N);
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    profile_map_t prices;
+    profile_map_init(&prices);
+    for (int i = 0; i < n; i++) {
+        if (strcmp(names[i], "driver") == 0) continue;
+        profile_map_add(&prices, names[i],
+                        atomic_load_explicit(&counters[i], memory_order_relaxed));
+    }
+    profile_map_normalize(&prices);
+
+    /* Tier 1: promote hot call sites, O2 for hot functions, lazy O0 for the rest */
+    MIR_context_t ctx1 = MIR_init();
+    MIR_gen_init(ctx1);
+    MIR_module_t m1 = benchmark_module(ctx1);
+    workload_load(ctx1, m1);
+    func_cache_t fc;
+    func_cache_build(ctx1, m1, &fc);
+    tr->mutations = tier_promote(&prices, &fc);
+    func_cache_free(&fc);
+    if (tr->mutations < 0) {
+        MIR_gen_finish(ctx1);
+        MIR_finish(ctx1);
+        MIR_gen_finish(ctx0);
+        MIR_finish(ctx0);
+        free(counters);
+        free(names);
+        profile_map_free(&prices);
+        return -1;
+    }
+    MIR_link(ctx1, MIR_set_lazy_gen_interface, NULL);
+    MIR_gen_set_optimize_level(ctx1, 2);
+    for (MIR_item_t item = DLIST_HEAD(MIR_item_t, m1->items); item != NULL;
+         item = DLIST_NEXT(MIR_item_t, item)) {
+        if (item->item_type != MIR_func_item) continue;
+        if (!tier_is_hot(&prices, item->u.func->name)) continue;
+        struct timespec g0, g1;
+        clock_gettime(CLOCK_MONOTONIC, &g0);
+        MIR_gen(ctx1, item);
+        clock_gettime(CLOCK_MONOTONIC, &g1);
+        metrics_compile(item->u.func->name, elapsed_sec(&g0, &g1), -1);
+        tr->hot++;
+    }
+    metrics_add(&metrics->tier_ups, 1);
+    MIR_gen_set_optimize_level(ctx1, 0);  /* Cold code compiles lazily at O0 */
+    MIR_item_t driver1 = find_func_item(m1, "driver");
+    clock_gettime(CLOCK_MONOTONIC, &t3);
+
+    /* Swap the entry point: tier 0 is done */
+    MIR_gen_finish(ctx0);
+    MIR_finish(ctx0);
+    free(counters);
+    free(names);
+
+    tr->tier0_setup = elapsed_sec(&t0, &t1);
+    tr->tier0_run = elapsed_sec(&t1, &t2);
+    tr->tier1_setup = elapsed_sec(&t2, &t3);
+
+    int rc = -1;
+    if (driver1 != NULL && driver1->addr != NULL) {
+        driver_fn_t driver_fn = (driver_fn_t)driver1->addr;
+        (void)driver_fn(WARMUP_ITERS);
+        struct timespec r0, r1;
+        clock_gettime(CLOCK_MONOTONIC, &r0);
+        tr->result = driver_fn(bench_iters);
+        clock_gettime(CLOCK_MONOTONIC, &r1);
+        tr->time = elapsed_sec(&r0, &r1);
+        rc = 0;
+    }
+
+    if (prices_out != NULL && rc == 0)
+        *prices_out = prices;  /* Entries own their names; safe past ctx0 */
+    else
+        profile_map_free(&prices);
+    MIR_gen_finish(ctx1);
+    MIR_finish(ctx1);
+    return rc;
+}
+
+/*
+ * Background tier-up (--tiered --compile-threads N).
+ *
+ * Tier-up on the executing thread stalls it for the whole O2 compile. The
+ * pool moves that work to N compile workers. Each worker owns its own
+ * MIR context and generator; MIR contexts are not thread-safe, so no
+ * context is ever touched by two threads. Every non-inlined MIR_CALL,
+ * in tier 0 and in the worker modules alike, is rewritten into an
+ * indirect call through a per-function dispatch slot, slots[id], where id
+ * is the dense func_cache_t ID. A slot starts at the tier-0 thunk. A worker
+ * publishes a tier-1 function by storing its machine_code into the slot
+ * (release store; the generated code reads it with a plain aligned
+ * 64-bit load). Tier-1 code calls through the same slots, so it never
+ * enters a worker context's lazy thunks from the executing thread.
+ *
+ * Jobs come from one queue sorted by tier-0 shadow price, hottest first.
+ * A shared queue, not per-worker deques with stealing, because the
+ * global hottest-first order is the point.
+ */
+typedef struct {
+    char   name[32];
+    int    id;      /* Dispatch slot */
+    double price;
+} compile_job_t;
+
+typedef struct {
+    pthread_mutex_t       lock;
+    compile_job_t        *jobs;     /* Sorted by price, descending */
+    int                   njobs;
+    int                   next;     /* Next job to hand out (under lock) */
+    const profile_map_t  *prices;
+    _Atomic(void *)      *slots;
+    _Atomic int           published;
+} compile_pool_t;
+
+typedef struct {
+    compile_pool_t *pool;
+    MIR_context_t   ctx;     /* Owned; outlives the thread (its code is live) */
+    MIR_module_t    m;
+} compile_worker_t;
+
+/* Rewrite remaining MIR_CALLs as indirect calls through slots[callee id]. */
+static int dispatch_rewrite(MIR_context_t ctx, const func_cache_t *fc,
+                            _Atomic(void *) *slots) {
+    int sites = 0;
+    for (int f = 0; f < fc->count; f++) {
+        MIR_item_t item = fc->funcs[f].item;
+        MIR_reg_t a = 0;
+        for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, item->u.func->insns);
+             insn != NULL;
+             insn = DLIST_NEXT(MIR_insn_t, insn)) {
+            if (insn->code != MIR_CALL) continue;
+            MIR_item_t callee = insn->ops[1].u.ref;
+            const func_info_t *fi = callee ? func_cache_get(fc, callee) : NULL;
+            if (fi == NULL) continue;
+            if (a == 0) a = MIR_new_func_reg(ctx, item->u.func, MIR_T_I64, "num_disp");
+            MIR_op_t a_op = MIR_new_reg_op(ctx, a);
+            MIR_insert_insn_before(ctx, item, insn, MIR_new_insn(ctx, MIR_MOV, a_op,
+                MIR_new_int_op(ctx, (int64_t)(intptr_t)&slots[fi - fc->funcs])));
+            MIR_insert_insn_before(ctx, item, insn, MIR_new_insn(ctx, MIR_MOV, a_op,
+                MIR_new_mem_op(ctx, MIR_T_I64, 0, a, 0, 1)));
+            insn->ops[1] = a_op;
+            sites++;
+        }
+    }
+    return sites;
+}
+
+static int compile_job_by_price(const void *a, const void *b) {
+    double pa = ((const compile_job_t *)a)->price, pb = ((const compile_job_t *)b)->price;
+    return (pa < pb) - (pa > pb);
+}
+
+static void *compile_worker_run(void *arg) {
+    compile_worker_t *w = arg;
+    compile_pool_t *pool = w->pool;
+
+    /* Build this worker's tier-1 module once, off the executing thread */
+    w->ctx = MIR_init();
+    MIR_gen_init(w->ctx);
+    MIR_gen_set_optimize_level(w->ctx, 2);
+    w->m = benchmark_module(w->ctx);
+    workload_load(w->ctx, w->m);
+    func_cache_t fc;
+    func_cache_build(w->ctx, w->m, &fc);
+    (void)tier_promote(pool->prices, &fc);  /* On error the jobs still publish, uninlined */
+    dispatch_rewrite(w->ctx, &fc, pool->slots);
+    MIR_link(w->ctx, MIR_set_lazy_gen_interface, NULL);
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        int j = pool->next < pool->njobs ? pool->next++ : -1;
+        pthread_mutex_unlock(&pool->lock);
+        if (j < 0) break;
+
+        const compile_job_t *job = &pool->jobs[j];
+        MIR_item_t item = fc.funcs[job->id].item;
+        struct timespec g0, g1;
+        clock_gettime(CLOCK_MONOTONIC, &g0);
+        MIR_gen(w->ctx, item);
+        clock_gettime(CLOCK_MONOTONIC, &g1);
+        atomic_store_explicit(&pool->slots[job->id], item->u.func->machine_code,
+                              memory_order_release);
+        atomic_fetch_add_explicit(&pool->published, 1, memory_order_relaxed);
+        metrics_compile(item->u.func->name, elapsed_sec(&g0, &g1), -1);
+        metrics_add(&metrics->tier_published, 1);
+    }
+    func_cache_free(&fc);
+    return NULL;
+}
+
+typedef struct {
+    double lat[TIER_CHUNKS];  /* Per-chunk latency, incl. any tier-up stall */
+    int    all_published;     /* First chunk that ran with every job published */
+    int    jobs;
+    double p50, p99, max;
+} tier_latency_t;
+
+/*
+ * tier_run_pool: Serve TIER_CHUNKS requests of TIER_CHUNK_N iterations
+ * each, tiering up after the first. With nthreads == 0 the jobs run
+ * synchronously on the executing thread (the stall the pool removes).
+ */
+static int tier_run_pool(int nthreads, tier_latency_t *out) {
+    typedef int64_t (*driver_fn_t)(int64_t);
+    memset(out, 0, sizeof(*out));
+
+    /* Tier 0, with calls dispatched through slots[] */
+    MIR_context_t ctx0 = MIR_init();
+    MIR_gen_init(ctx0);
+    MIR_gen_set_optimize_level(ctx0, 0);
+    MIR_module_t m0 = benchmark_module(ctx0);
+    workload_load(ctx0, m0);
+    func_cache_t fc0;
+    func_cache_build(ctx0, m0, &fc0);
+    /* Every function needs a dispatch slot, so a capped count fails the run */
+    int nprobe = tier_func_count(m0);
+    _Atomic uint64_t *counters = calloc((size_t)nprobe + 1, sizeof(*counters));
+    _Atomic(void *) *slots = calloc((size_t)nprobe + 1, sizeof(*slots));
+    const char **names = calloc((size_t)nprobe + 1, sizeof(const char *));
+    int n = -1;
+    if (counters != NULL && slots != NULL && names != NULL && nprobe == fc0.count) {
+        for (int i = 0; i < nprobe; i++) {
+            atomic_init(&counters[i], 0);
+            atomic_init(&slots[i], NULL);
+        }
+        n = instrument_module(ctx0, m0, counters, names, nprobe);
+    }
+    if (n > 0) dispatch_rewrite(ctx0, &fc0, slots);
+    MIR_link(ctx0, MIR_set_lazy_gen_interface, NULL);
+    MIR_item_t driver0 = find_func_item(m0, "driver");
+    if (n <= 0 || driver0 == NULL) {
+        free(counters);
+        free(slots);
+        free(names);
+        func_cache_free(&fc0);
+        MIR_gen_finish(ctx0);
+        MIR_finish(ctx0);
+        return -1;
+    }
+    int driver_id = (int)(func_cache_get(&fc0, driver0) - fc0.funcs);
+    for (int f = 0; f < fc0.count; f++)
+        atomic_store_explicit(&slots[f], fc0.funcs[f].item->addr, memory_order_relaxed);
+
+    compile_pool_t pool;
+    compile_worker_t workers[COMPILE_MAX_THREADS];
+    pthread_t threads[COMPILE_MAX_THREADS];
+    profile_map_t prices;
+    profile_map_init(&prices);
+    memset(&pool, 0, sizeof(pool));
+    pthread_mutex_init(&pool.lock, NULL);
+    pool.slots = slots;
+    pool.prices = &prices;
+    atomic_init(&pool.published, 0);
+    if (nthreads > COMPILE_MAX_THREADS) nthreads = COMPILE_MAX_THREADS;
+    int started = 0;
+
+    out->all_published = -1;
+    for (int c = 0; c < TIER_CHUNKS; c++) {
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+
+        if (c == 1) {
+            /* Tier-up: price the tier-0 counts, queue hot functions */
+            for (int i = 0; i < n; i++)
+                if (strcmp(names[i], "driver") != 0)
+                    profile_map_add(&prices, names[i],
+                                    atomic_load_explicit(&counters[i], memory_order_relaxed));
+            profile_map_normalize(&prices);
+            pool.jobs = calloc((size_t)fc0.count, sizeof(*pool.jobs));
+            for (int f = 0; pool.jobs != NULL && f < fc0.count; f++) {
+                if (!tier_is_hot(&prices, fc0.funcs[f].name)) continue;
+                compile_job_t *job = &pool.jobs[pool.njobs++];
+                snprintf(job->name, sizeof(job->name), "%s", fc0.funcs[f].name);
+                job->id = f;
+                job->price = (f == driver_id) ? 1.0 : profile_map_lambda(&prices, job->name);
+            }
+            qsort(pool.jobs, (size_t)pool.njobs, sizeof(*pool.jobs), compile_job_by_price);
+            out->jobs = pool.njobs;
+            metrics_add(&metrics->tier_ups, 1);
+
+            int nw = nthreads > 0 ? nthreads : 1;
+            for (int k = 0; k < nw; k++) {
+                memset(&workers[k], 0, sizeof(workers[k]));
+                workers[k].pool = &pool;
+            }
+            if (nthreads == 0) {
+                compile_worker_run(&workers[0]);  /* Synchronous: stalls this chunk */
+                started = 1;
+            } else {
+                for (; started < nthreads; started++)
+                    if (pthread_create(&threads[started], NULL, compile_worker_run,
+                                       &workers[started]) != 0)
+                        break;
+            }
+        }
+
+        driver_fn_t driver_fn = (driver_fn_t)atomic_load_explicit(&slots[driver_id],
+                                                                 memory_order_acquire);
+        int ready = c >= 1 && atomic_load_explicit(&pool.published, memory_order_relaxed)
+                              == pool.njobs;
+        (void)driver_fn(TIER_CHUNK_N);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        out->lat[c] = elapsed_sec(&t0, &t1);
+        if (ready && out->all_published < 0) out->all_published = c;
+    }
+
+    if (nthreads > 0)
+        for (int k = 0; k < started; k++) pthread_join(threads[k], NULL);
+
+    double scratch[TIER_CHUNKS];
+    out->p50 = sample_median(out->lat, TIER_CHUNKS, scratch);  /* Leaves scratch sorted */
+    out->p99 = scratch[(int)ceil(0.99 * TIER_CHUNKS) - 1];
+    out->max = scratch[TIER_CHUNKS - 1];
+
+    /* Tier-1 code is live until here: tear down workers, then tier 0 */
+    for (int k = 0; k < (nthreads > 0 ? started : 1); k++) {
+        if (workers[k].ctx == NULL) continue;
+        MIR_gen_finish(workers[k].ctx);
+        MIR_finish(workers[k].ctx);
+    }
+    free(pool.jobs);
+    pthread_mutex_destroy(&pool.lock);
+    profile_map_free(&prices);
+    func_cache_free(&fc0);
+    MIR_gen_finish(ctx0);
+    MIR_finish(ctx0);
+    free(counters);
+    free(slots);
+    free(names);
+    return 0;
+}
+
+/*
+ * run_tiered: `nruns` tiered lifecycles against eager O2 shadow-price
+ * (COND_SHADOW_PRICE from the Phase 1 profile). Startup is everything up
+ * to tier-1 code being ready; steady state is the timed driver(bench_iters) run.
+ */
+static int run_tiered(const profile_map_t *profile, int growth_budget, int nruns,
+                      int compile_threads) {
+    tier_run_t runs[NUM_RUNS];
+    profile_map_t prices;
+    if (nruns > NUM_RUNS) nruns = NUM_RUNS;
+
+    printf("\n================================================================\n");
+    printf("TIERED JIT (tier 0: O0 lazy + probes for %lld iters; hot: lambda >= %.2f)\n",
+           (long long)TIER_TRIGGER_N, TIER_UP_PRICE);
+    printf("================================================================\n");
+
+    for (int r = 0; r < nruns; r++) {
+        if (tier_run(&runs[r], r == 0 ? &prices : NULL) != 0) {
+            fprintf(stderr, "ERROR: tiered run %d failed\n", r + 1);
+            if (r > 0) profile_map_free(&prices);  /* Set only by a successful run 1 */
+            return -1;
+        }
+    }
+
+    printf("Tier-0 prices (run 1):\n");
+    for (int i = 0; i < prices.count; i++)
+        printf("  %-12s  lambda=%.4f  %s\n", prices.entries[i].func_name,
+               prices.entries[i].shadow_price,
+               tier_is_hot(&prices, prices.entries[i].func_name) ? "HOT -> O2" : "cold (lazy O0)");
+    profile_map_free(&prices);
+
+    bench_config_t eager_bench = bench_fixed(nruns);
+    condition_result_t eager;
+    if (run_condition(COND_SHADOW_PRICE, profile, growth_budget, &eager_bench, 0,
+                      &eager) != 0)
+        return -1;
+
+    double t0s = 0, t0r = 0, t1s = 0, sum = 0, sum2 = 0;
+    for (int r = 0; r < nruns; r++) {
+        t0s += runs[r].tier0_setup;
+        t0r += runs[r].tier0_run;
+        t1s += runs[r].tier1_setup;
+        sum += runs[r].time;
+    }
+    double mean = sum / nruns;
+    for (int r = 0; r < nruns; r++) sum2 += (runs[r].time - mean) * (runs[r].time - mean);
+    double sd = nruns > 1 ? sqrt(sum2 / (nruns - 1)) : 0.0;
+    double eager_compile = (eager.link_sec + eager.gen_sec) / (eager.compiles ? eager.compiles : 1);
+
+    printf("\n%-34s  %12s  %12s\n", "", "Tiered", "Eager O2");
+    printf("%-34s  %12d  %12d\n", "Functions compiled at O2", runs[0].hot, eager.ncode);
+    printf("%-34s  %12d  %12d\n", "Mutations", runs[0].mutations, eager.mutations);
+    printf("%-34s  %12.3f  %12s\n", "Tier-0 setup (ms)", 1e3 * t0s / nruns, "-");
+    printf("%-34s  %12.3f  %12s\n", "Tier-0 run (ms)", 1e3 * t0r / nruns, "-");
+    printf("%-34s  %12.3f  %12.3f\n", "O2 link + compile (ms)", 1e3 * t1s / nruns,
+           1e3 * eager_compile);
+    printf("%-34s  %12.4f  %12.4f\n", "Steady-state mean (s)", mean, eager.mean);
+    printf("%-34s  %12.4f  %12.4f\n", "Steady-state SD (s)", sd, eager.stddev);
+    printf("%-34s  %12ld  %12ld\n", "Result", (long)runs[0].result, (long)eager.result);
+    if (runs[0].result != eager.result)
+        printf("WARNING: tiered result differs from eager\n");
+
+    printf("\nrun,tier0_setup_sec,tier0_run_sec,tier1_setup_sec,time_sec\n");
+    for (int r = 0; r < nruns; r++)
+        printf("%d,%.6f,%.6f,%.6f,%.6f\n", r + 1, runs[r].tier0_setup,
+               runs[r].tier0_run, runs[r].tier1_setup, runs[r].time);
+
+    if (compile_threads <= 0) return 0;
+
+    tier_latency_t sync_lat, bg_lat;
+    if (tier_run_pool(0, &sync_lat) != 0 || tier_run_pool(compile_threads, &bg_lat) != 0) {
+        fprintf(stderr, "ERROR: background tier-up run failed\n");
+        return -1;
+    }
+    printf("\nTier-up latency (%d requests x %lld iters; tier-up after request 1):\n",
+           TIER_CHUNKS, (long long)TIER_CHUNK_N);
+    printf("%-34s  %12s  %12s\n", "", "Synchronous", "Pool");
+    printf("%-34s  %12d  %12d\n", "Compile workers", 0, compile_threads);
+    printf("%-34s  %12d  %12d\n", "Hot functions (jobs)", sync_lat.jobs, bg_lat.jobs);
+    printf("%-34s  %12.3f  %12.3f\n", "p50 request (ms)", 1e3 * sync_lat.p50, 1e3 * bg_lat.p50);
+    printf("%-34s  %12.3f  %12.3f\n", "p99 request (ms)", 1e3 * sync_lat.p99, 1e3 * bg_lat.p99);
+    printf("%-34s  %12.3f  %12.3f\n", "max request (ms)", 1e3 * sync_lat.max, 1e3 * bg_lat.max);
+    printf("%-34s  %12d  %12d\n", "First request fully on tier 1",
+           sync_lat.all_published, bg_lat.all_published);
+
+    printf("\nrequest,sync_sec,pool_sec\n");
+    for (int c = 0; c < TIER_CHUNKS; c++)
+        printf("%d,%.6f,%.6f\n", c + 1, sync_lat.lat[c], bg_lat.lat[c]);
+    return 0;
+}
+
+/* ========================================================================
+ * SECTION 9: PARAMETER SWEEP (--sweep)
+ *
+ * Evaluates the shadow-price condition over a grid of formula constants
+ * instead of one #define setting per build. Axes:
+ *
+ *   floor   SCALE_FLOOR                ceil   SCALE_CEIL
+ *   tfloor  THRESHOLD_FLOOR            base   MIR_CALL_INLINE_THRESHOLD
+ *
+ * Each axis is "lo", "lo:hi" or "lo:hi:step" (default: the #define). The
+ * grid is their cross product; with --sweep-samples N, N points are drawn
+ * uniformly from the same box instead (ints rounded). Every point
+ * reads the one binary IR template, is compiled once (as --reuse-ctx) and
+ * timed SWEEP_RUNS times. Points are pulled by a pool of workers, one
+ * per core, each with its own num_params. Workers time concurrently, so
+ * for final numbers rerun the frontier with --sweep-threads 1.
+ *
+ * Output: one CSV row per point, then the Pareto frontier over (median
+ * runtime, mutations, compile time), all three minimised. base only
+ * moves the formula; MIR's own MIR_CALL auto-inline threshold is fixed.
+ * ======================================================================== */
+
+typedef enum { AXIS_FLOOR, AXIS_CEIL, AXIS_TFLOOR, AXIS_BASE, AXIS_COUNT } sweep_axis_t;
+
+static const char *sweep_axis_names[AXIS_COUNT] = {"floor", "ceil", "tfloor", "base"};
+
+typedef struct {
+    double lo[AXIS_COUNT], hi[AXIS_COUNT], step[AXIS_COUNT];
+    int    samples;  /* 0 = full grid */
+    int    threads;  /* 0 = SWEEP_THREADS default */
+} sweep_spec_t;
+
+typedef struct {
+    num_params_t params;
+    int    status;      /* run_condition() return; -1 until evaluated */
+    int    mutations;
+    double median;
+    double mad;
+    double compile_ms;  /* Link + gen of the point's one compile */
+    int    pareto;      /* Not dominated by any other point */
+} sweep_point_t;
+
+typedef struct {
+    sweep_point_t         *points;
+    int                    npoints;
+    _Atomic int            next;
+    const profile_map_t   *profile;
+    int                    growth_budget;
+    const bench_config_t  *bench;
+    _Atomic int            done;
+} sweep_t;
+
+typedef struct {
+    sweep_t *sweep;
+    int      cpu;
+} sweep_worker_t;
+
+static void sweep_spec_default(sweep_spec_t *spec) {
+    const num_params_t def = NUM_PARAMS_DEFAULT;
+    double v[AXIS_COUNT] = {def.scale_floor, def.scale_ceil,
+                            def.threshold_floor, def.call_threshold};
+    for (int a = 0; a < AXIS_COUNT; a++) {
+        spec->lo[a] = spec->hi[a] = v[a];
+        spec->step[a] = 1.0;
+    }
+    spec->samples = 0;
+    spec->threads = SWEEP_THREADS;
+}
+
+/* Parse "floor=0.05:0.2:0.05,base=30:70:10" into spec. Returns 0 on success. */
+static int sweep_spec_parse(const char *text, sweep_spec_t *spec) {
+    const char *p = text;
+    while (*p) {
+        int a = 0;
+        size_t len;
+        while (a < AXIS_COUNT) {
+            len = strlen(sweep_axis_names[a]);
+            if (strncmp(p, sweep_axis_names[a], len) == 0 && p[len] == '=') break;
+            a++;
+        }
+        if (a == AXIS_COUNT) return -1;
+        p += len + 1;
+
+        double v[3];
+        int n = 0;
+        for (;;) {
+            char *end;
+            v[n++] = strtod(p, &end);
+            if (end == p) return -1;
+            p = end;
+            if (*p != ':' || n == 3) break;
+            p++;
+        }
+        spec->lo[a] = v[0];
+        spec->hi[a] = n > 1 ? v[1] : v[0];
+        spec->step[a] = n > 2 ? v[2] : (n > 1 ? (v[1] - v[0]) : 1.0);
+        if (spec->lo[a] <= 0.0 || spec->hi[a] < spec->lo[a] ||
+            (spec->hi[a] > spec->lo[a] && spec->step[a] <= 0.0)) return -1;
+        if (*p == ',') p++;
+        else if (*p != '\0') return -1;
+    }
+    return 0;
+}
+
+static int sweep_axis_count(const sweep_spec_t *spec, int a) {
+    if (spec->hi[a] <= spec->lo[a]) return 1;
+    /* Tolerate rounding in the step so that hi itself is included */
+    return (int)floor((spec->hi[a] - spec->lo[a]) / spec->step[a] + 1e-9) + 1;
+}
+
+static num_params_t sweep_params(const double *v) {
+    num_params_t np;
+    np.scale_floor = v[AXIS_FLOOR];
+    np.scale_ceil = v[AXIS_CEIL];
+    np.threshold_floor = (int)lround(v[AXIS_TFLOOR]);
+    np.call_threshold = (int)lround(v[AXIS_BASE]);
+    return np;
+}
+
+/*
+ * sweep_points: Expand the grid (or draw the samples) into *out, dropping
+ * points with floor > ceil. Returns the number of points, -1 if the grid
+ * exceeds SWEEP_MAX_POINTS or memory runs out.
+ */
+static int sweep_points(const sweep_spec_t *spec, sweep_point_t **out) {
+    long total = 1;
+    int count[AXIS_COUNT];
+    if (spec->samples > 0) {
+        total = spec->samples;  /* Random sampling: the grid size is irrelevant */
+    } else {
+        for (int a = 0; a < AXIS_COUNT; a++) {
+            count[a] = sweep_axis_count(spec, a);
+            total *= count[a];
+            if (total > SWEEP_MAX_POINTS) return -1;
+        }
+    }
+    if (total > SWEEP_MAX_POINTS) return -1;
+
+    sweep_point_t *pts = calloc((size_t)total, sizeof(sweep_point_t));
+    if (pts == NULL) return -1;
+    unsigned int rng_state = RANDOM_SEED;
+    int n = 0;
+    for (long i = 0; i < total; i++) {
+        double v[AXIS_COUNT];
+        long rest = i;
+        for (int a = 0; a < AXIS_COUNT; a++) {
+            if (spec->samples > 0) {
+                double u = synth_rand(&rng_state) / 4294967296.0;
+                v[a] = spec->lo[a] + u * (spec->hi[a] - spec->lo[a]);
+            } else {
+                v[a] = spec->lo[a] + (double)(rest % count[a]) * spec->step[a];
+                rest /= count[a];
+            }
+        }
+        if (v[AXIS_FLOOR] > v[AXIS_CEIL]) continue;
+        pts[n].params = sweep_params(v);
+        pts[n].status = -1;
+        n++;
+    }
+    *out = pts;
+    return n;
+}
+
+static void *sweep_worker_run(void *arg) {
+    sweep_worker_t *w = arg;
+    sweep_t *s = w->sweep;
+    (void)pin_to_cpu(w->cpu);
+    condition_result_t *res = malloc(sizeof(*res));
+    if (res == NULL) return NULL;
+    for (;;) {
+        int i = atomic_fetch_add(&s->next, 1);
+        if (i >= s->npoints) break;
+        sweep_point_t *pt = &s->points[i];
+        num_params = pt->params;
+        pt->status = run_condition(COND_SHADOW_PRICE, s->profile, s->growth_budget,
+                                   s->bench, 1, res);
+        if (pt->status == 0) {
+            pt->mutations = res->mutations;
+            pt->median = res->median;
+            pt->mad = res->mad;
+            pt->compile_ms = 1e3 * (res->link_sec + res->gen_sec);
+        }
+        int done = atomic_fetch_add(&s->done, 1) + 1;
+        if (done % 16 == 0 || done == s->npoints)
+            fprintf(stderr, "  sweep: %d/%d points\n", done, s->npoints);
+    }
+    free(res);
+    return NULL;
+}
+
+static int sweep_dominates(const sweep_point_t *a, const sweep_point_t *b) {
+    return a->median <= b->median && a->mutations <= b->mutations &&
+           a->compile_ms <= b->compile_ms &&
+           (a->median < b->median || a->mutations < b->mutations ||
+            a->compile_ms < b->compile_ms);
+}
+
+static int sweep_by_median(const void *a, const void *b) {
+    const sweep_point_t *pa = *(const sweep_point_t *const *)a;
+    const sweep_point_t *pb = *(const sweep_point_t *const *)b;
+    return (pa->median > pb->median) - (pa->median < pb->median);
+}
+
+/*
+ * run_sweep: Evaluate every point of `spec` and print the CSV and the
+ * frontier. Returns 0 on success, -1 on failure.
+ */
+static int run_sweep(const profile_map_t *profile, int growth_budget,
+                     const sweep_spec_t *spec) {
+    sweep_point_t *points;
+    int n = sweep_points(spec, &points);
+    if (n < 0) {
+        fprintf(stderr, "ERROR: sweep grid is empty or larger than %d points\n",
+                SWEEP_MAX_POINTS);
+        return -1;
+    }
+
+    int nthreads = spec->threads;
+    if (nthreads <= 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+        nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN) - 1;  /* Leave cpu0 to the OS */
+#endif
+        if (nthreads < 1) nthreads = 1;
+    }
+    if (nthreads > n) nthreads = n > 0 ? n : 1;
+
+    printf("\n================================================================\n");
+    printf("PARAMETER SWEEP (%d points, %d runs each, %d workers, budget=%d)\n",
+           n, SWEEP_RUNS, nthreads, growth_budget);
+    printf("================================================================\n");
+    for (int a = 0; a < AXIS_COUNT; a++) {
+        if (spec->hi[a] <= spec->lo[a])
+            printf("  %-6s  %g\n", sweep_axis_names[a], spec->lo[a]);
+        else if (spec->samples > 0)
+            printf("  %-6s  %g..%g (sampled)\n", sweep_axis_names[a], spec->lo[a], spec->hi[a]);
+        else
+            printf("  %-6s  %g..%g step %g (%d values)\n", sweep_axis_names[a], spec->lo[a],
+                   spec->hi[a], spec->step[a], sweep_axis_count(spec, a));
+    }
+
+    bench_config_t bench = bench_fixed(SWEEP_RUNS);
+    sweep_t s;
+    s.points = points;
+    s.npoints = n;
+    atomic_init(&s.next, 0);
+    atomic_init(&s.done, 0);
+    s.profile = profile;
+    s.growth_budget = growth_budget;
+    s.bench = &bench;
+
+    pthread_t *threads = malloc((size_t)nthreads * sizeof(pthread_t));
+    sweep_worker_t *workers = malloc((size_t)nthreads * sizeof(sweep_worker_t));
+    if (threads == NULL || workers == NULL) {
+        free(threads); free(workers); free(points);
+        return -1;
+    }
+    int started = 0;
+    for (int w = 0; w < nthreads; w++) {
+        workers[w].sweep = &s;
+        workers[w].cpu = w + 1;
+        if (pthread_create(&threads[w], NULL, sweep_worker_run, &workers[w]) != 0) break;
+        started++;
+    }
+    if (started == 0) sweep_worker_run(&workers[0]);  /* No threads: run inline */
+    for (int w = 0; w < started; w++) pthread_join(threads[w], NULL);
+    free(threads);
+    free(workers);
+
+    /* Pareto frontier over the points that ran */
+    int nfront = 0;
+    for (int i = 0; i < n; i++) {
+        if (points[i].status != 0) continue;
+        points[i].pareto = 1;
+        for (int j = 0; j < n && points[i].pareto; j++)
+            if (j != i && points[j].status == 0 && sweep_dominates(&points[j], &points[i]))
+                points[i].pareto = 0;
+        nfront += points[i].pareto;
+    }
+
+    printf("point,scale_floor,scale_ceil,threshold_floor,call_threshold,"
+           "mutations,median_sec,mad_sec,compile_ms,pareto\n");
+    int failed = 0;
+    for (int i = 0; i < n; i++) {
+        const sweep_point_t *pt = &points[i];
+        if (pt->status != 0) {
+            failed++;
+            continue;
+        }
+        printf("%d,%.4f,%.4f,%d,%d,%d,%.6f,%.6f,%.3f,%d\n", i,
+               pt->params.scale_floor, pt->params.scale_ceil,
+               pt->params.threshold_floor, pt->params.call_threshold,
+               pt->mutations, pt->median, pt->mad, pt->compile_ms, pt->pareto);
+    }
+
+    const sweep_point_t **front = malloc((size_t)(nfront > 0 ? nfront : 1) * sizeof(*front));
+    if (front != NULL) {
+        int k = 0;
+        for (int i = 0; i < n; i++)
+            if (points[i].status == 0 && points[i].pareto) front[k++] = &points[i];
+        qsort(front, (size_t)k, sizeof(*front), sweep_by_median);
+        printf("\n  Pareto frontier (%d of %d points; runtime, mutations, compile time):\n",
+               nfront, n - failed);
+        printf("    %7s  %7s  %7s  %5s  %10s  %9s  %10s\n",
+               "floor", "ceil", "tfloor", "base", "Median (s)", "Mutations", "Compile ms");
+        for (int i = 0; i < k && i < PRINT_MAX_ROWS; i++)
+            printf("    %7.4f  %7.4f  %7d  %5d  %10.4f  %9d  %10.3f\n",
+                   front[i]->params.scale_floor, front[i]->params.scale_ceil,
+                   front[i]->params.threshold_floor, front[i]->params.call_threshold,
+                   front[i]->median, front[i]->mutations, front[i]->compile_ms);
+        if (k > PRINT_MAX_ROWS)
+            printf("    ... %d more (pareto=1 in the CSV)\n", k - PRINT_MAX_ROWS);
+        free(front);
+    }
+    if (failed > 0) fprintf(stderr, "WARNING: %d sweep points failed\n", failed);
+
+    free(points);
+    return failed == n ? -1 : 0;
+}
 
 /* ========================================================================
- * SECTION 6: EXPERIMENT RUNNER (Phase 3)
+ * SECTION 10: INCREMENTAL RE-OPTIMIZATION (--reopt)
  *
- * For each condition:
- *   1. Fresh MIR context (clean state)
- *   2. Scan IR string
- *   3. Profile module (Phase 1)
- *   4. Apply mutation (Phase 2)
- *   5. Link + JIT compile
- *   6. Execute with timing (Phase 3)
- *   7. Tear down context
+ * A long-running process keeps its compiled code when the profile drifts.
+ * The deployed code was built under prices P0; a new profile P1 arrives.
  *
- * Lifecycle anchored to PoC v2's confirmed working pattern.
+ *   1. Hysteresis: a function's new price is used only if it moved more
+ *      than REOPT_BAND from P0; smaller moves keep the P0 price, so noise
+ *      in the counts does not trigger recompiles.
+ *   2. Both price maps are planned on scratch copies (planning only, no
+ *      code). A function is stale if any of its call-site decisions
+ *      differ, or if it inlines a stale function under the new plan.
+ *   3. A new context is built under P1, every non-inlined call dispatched
+ *      through the same per-function slots as the deployed code (the
+ *      background tier-up mechanism of Section 8). Only stale functions
+ *      are compiled; each is published by a release store to its slot.
+ *      Everything else keeps running the P0 code.
+ *
+ * Only O2 generation is incremental. MIR cannot relink a linked function,
+ * so the new context still re-plans (mutates) and links the whole module;
+ * link time is resolution plus MIR_INLINE expansion, and the O2
+ * generation being skipped is the bulk of a full rebuild. Both maps keep
+ * the profile's call-site prices; a drifted callee's sites move by its
+ * price ratio (reopt_drift_sites).
  * ======================================================================== */
 
+/* Call-site decisions of one plan, per dense func_cache_t ID */
 typedef struct {
-    double times[NUM_RUNS];
-    double mean;
-    double stddev;
-    int    mutations;
-    int64_t result;  /* Correctness check: all conditions should produce same result */
-} condition_result_t;
+    int nfuncs;
+    int nsites;
+    int *first;            /* Sites of function f: [first[f], first[f + 1]) */
+    int *callee;           /* Dense callee ID per site */
+    int *index;            /* Call ordinal in the caller (profile site key) */
+    unsigned char *inl;    /* 1 = promoted to MIR_INLINE */
+} site_plan_t;
 
-static int run_condition(experiment_condition_t condition,
-                         const profile_map_t *profile,
-                         condition_result_t *out) {
-    memset(out, 0, sizeof(*out));
-    unsigned int rng_state = RANDOM_SEED;
+static void site_plan_free(site_plan_t *p) {
+    free(p->first);
+    free(p->callee);
+    free(p->index);
+    free(p->inl);
+    memset(p, 0, sizeof(*p));
+}
 
-    for (int run = 0; run < NUM_RUNS; run++) {
-        /* Step 1: Fresh context */
-        MIR_context_t ctx = MIR_init();
-        MIR_gen_init(ctx);
-        MIR_gen_set_optimize_level(ctx, 2);  /* O2 for full optimization */
+/*
+ * site_plan_build: Mutate a scratch copy under `condition` with `prices`
+ * and record every call-site decision. Returns 0 on success.
+ */
+static int site_plan_build(experiment_condition_t condition, const profile_map_t *prices,
+                           int growth_budget, site_plan_t *p) {
+    memset(p, 0, sizeof(*p));
+    MIR_context_t ctx = MIR_init();
+    MIR_module_t m = benchmark_module(ctx);
+    workload_load(ctx, m);
+    func_cache_t fc;
+    func_cache_build(ctx, m, &fc);
+    unsigned int rng_state = RANDOM_SEED;
+    if (mutate_module(condition, prices, &fc, growth_budget, &rng_state) < 0) {
+        func_cache_free(&fc);
+        MIR_finish(ctx);
+        return -1;
+    }
 
-        /* Step 2: Scan IR */
-        MIR_scan_string(ctx, benchmark_ir);
-        MIR_module_t m = DLIST_TAIL(MIR_module_t, *MIR_get_module_list(ctx));
+    int cap = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        int s = 0;
+        for (int f = 0; f < fc.count; f++) {
+            if (pass == 1) p->first[f] = s;
+            MIR_func_t func = fc.funcs[f].item->u.func;
+            int k = -1;
+            for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, func->insns);
+                 insn != NULL;
+                 insn = DLIST_NEXT(MIR_insn_t, insn)) {
+                if (insn->code != MIR_CALL && insn->code != MIR_INLINE) continue;
+                k++;
+                const func_info_t *callee = func_cache_get(&fc, insn->ops[1].u.ref);
+                if (callee == NULL) continue;
+                if (pass == 1) {
+                    p->callee[s] = (int)(callee - fc.funcs);
+                    p->index[s] = k;
+                    p->inl[s] = insn->code == MIR_INLINE;
+                }
+                s++;
+            }
+        }
+        if (pass == 1) {
+            p->first[fc.count] = s;
+            break;
+        }
+        cap = s > 0 ? s : 1;
+        p->nfuncs = fc.count;
+        p->nsites = s;
+        p->first = malloc((size_t)(fc.count + 1) * sizeof(int));
+        p->callee = malloc((size_t)cap * sizeof(int));
+        p->index = malloc((size_t)cap * sizeof(int));
+        p->inl = malloc((size_t)cap);
+        if (p->first == NULL || p->callee == NULL || p->index == NULL || p->inl == NULL)
+            break;
+    }
 
-        /* Step 3: Load module (makes items traversable) */
-        MIR_load_module(ctx, m);
+    func_cache_free(&fc);
+    MIR_finish(ctx);
+    if (p->first == NULL || p->callee == NULL || p->index == NULL || p->inl == NULL) {
+        site_plan_free(p);
+        return -1;
+    }
+    return 0;
+}
 
-        /* Step 4: Mutate (between load and link) */
-        rng_state = RANDOM_SEED;  /* Reset RNG per run for reproducibility */
-        int muts = mutate_module(m, condition, profile, &rng_state);
-        if (run == 0) out->mutations = muts;
-
-        /* Step 5: Link + JIT compile */
-        MIR_link(ctx, MIR_set_gen_interface, NULL);
-
-        /* Step 6: Find driver function */
-        MIR_item_t driver_item = NULL;
-        for (MIR_item_t item = DLIST_HEAD(MIR_item_t, m->items);
-             item != NULL;
-             item = DLIST_NEXT(MIR_item_t, item)) {
-            if (item->item_type == MIR_func_item &&
-                strcmp(item->u.func->name, "driver") == 0) {
-                driver_item = item;
+/*
+ * reopt_stale: Mark functions whose code differs between the plans:
+ * changed site decisions, then closed over the new plan's inline edges.
+ * Returns the number of stale functions.
+ */
+static int reopt_stale(const site_plan_t *old, const site_plan_t *cur,
+                       unsigned char *stale) {
+    int n = 0;
+    for (int f = 0; f < cur->nfuncs; f++) {
+        int s0 = old->first[f], s1 = cur->first[f];
+        int len = cur->first[f + 1] - s1;
+        stale[f] = len != old->first[f + 1] - s0 ||
+                   memcmp(&old->inl[s0], &cur->inl[s1], (size_t)len) != 0;
+        n += stale[f];
+    }
+    for (int again = 1; again;) {
+        again = 0;
+        for (int f = 0; f < cur->nfuncs; f++) {
+            if (stale[f]) continue;
+            for (int s = cur->first[f]; s < cur->first[f + 1]; s++) {
+                if (!cur->inl[s] || !stale[cur->callee[s]]) continue;
+                stale[f] = 1;
+                n++;
+                again = 1;
                 break;
             }
         }
+    }
+    return n;
+}
 
-        if (driver_item == NULL || driver_item->addr == NULL) {
-            fprintf(stderr, "ERROR: Could not find/compile 'driver'\n");
-            MIR_gen_finish(ctx);
-            MIR_finish(ctx);
+/*
+ * reopt_drift: Apply "name=lambda,..." to `prices`. NULL swaps the prices
+ * of the hottest and the coldest function. Returns 0 on success.
+ */
+static int reopt_drift(profile_map_t *prices, const char *spec) {
+    if (spec == NULL) {
+        if (prices->count < 2) return 0;
+        int hi = 0, lo = 0;
+        for (int i = 1; i < prices->count; i++) {
+            if (prices->entries[i].shadow_price > prices->entries[hi].shadow_price) hi = i;
+            if (prices->entries[i].shadow_price < prices->entries[lo].shadow_price) lo = i;
+        }
+        double t = prices->entries[hi].shadow_price;
+        prices->entries[hi].shadow_price = prices->entries[lo].shadow_price;
+        prices->entries[lo].shadow_price = t;
+        return 0;
+    }
+    for (const char *p = spec; *p;) {
+        const char *eq = strchr(p, '=');
+        if (eq == NULL || eq == p || eq - p >= 64) return -1;
+        char name[64];
+        memcpy(name, p, (size_t)(eq - p));
+        name[eq - p] = '\0';
+        char *end;
+        double lambda = strtod(eq + 1, &end);
+        if (end == eq + 1 || lambda < 0.0 || lambda > 1.0) return -1;
+        profile_entry_t *e = profile_map_get(prices, name);
+        if (e == NULL) {
+            fprintf(stderr, "ERROR: --drift: no profile entry '%s'\n", name);
             return -1;
         }
+        e->shadow_price = lambda;
+        if (*end != ',' && *end != '\0') return -1;
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return 0;
+}
 
-        typedef int64_t (*driver_fn_t)(int64_t);
-        driver_fn_t driver_fn = (driver_fn_t)driver_item->addr;
+/*
+ * reopt_drift_sites: Move P1's call-site prices with their callees. A site
+ * whose callee's price changed from P0 to P1 (past the band) is scaled by
+ * the same ratio, clamped to 1; a callee drifted up from 0 sets its sites
+ * to the new price. Sites of unchanged callees keep their P0 prices.
+ */
+static void reopt_drift_sites(const profile_map_t *p0, profile_map_t *p1) {
+    for (int i = 0; i < p1->nsites; i++) {
+        site_entry_t *e = &p1->sites[i];
+        const profile_entry_t *was = profile_map_get(p0, e->callee);
+        const profile_entry_t *now = profile_map_get(p1, e->callee);
+        if (was == NULL || now == NULL || now->shadow_price == was->shadow_price) continue;
+        double lambda = was->shadow_price > 0.0
+            ? e->shadow_price * now->shadow_price / was->shadow_price
+            : now->shadow_price;
+        e->shadow_price = lambda < 1.0 ? lambda : 1.0;
+    }
+}
 
-        /* Warmup */
-        (void)driver_fn(WARMUP_ITERS);
+typedef struct {
+    MIR_context_t ctx;
+    func_cache_t  fc;
+    int           driver;     /* Dense ID of the entry point */
+    int           mutations;
+    int           compiled;
+    double        link_sec;
+    double        gen_sec;
+    double        pause_sec;  /* Build + link + compile + publish */
+} reopt_ctx_t;
 
-        /* Timed execution */
-        struct timespec t0, t1;
+/*
+ * reopt_ctx_build: Context under `prices` with calls dispatched through
+ * `slots`; compiles and publishes the functions set in `mask` (NULL: all).
+ * The context must outlive any use of the published code. Returns 0 on
+ * success.
+ */
+static int reopt_ctx_build(reopt_ctx_t *rc, const profile_map_t *prices,
+                           _Atomic(void *) *slots, const unsigned char *mask) {
+    struct timespec t0, t1, t2, t3;
+    memset(rc, 0, sizeof(*rc));
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    rc->ctx = MIR_init();
+    MIR_gen_init(rc->ctx);
+    MIR_gen_set_optimize_level(rc->ctx, 2);
+    MIR_module_t m = benchmark_module(rc->ctx);
+    workload_load(rc->ctx, m);
+    func_cache_build(rc->ctx, m, &rc->fc);
+    unsigned int rng_state = RANDOM_SEED;
+    rc->mutations = mutate_module(COND_SHADOW_PRICE, prices, &rc->fc, 0, &rng_state);
+    if (rc->mutations < 0) return -1;
+    dispatch_rewrite(rc->ctx, &rc->fc, slots);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    MIR_link(rc->ctx, MIR_set_lazy_gen_interface, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    for (int f = 0; f < rc->fc.count; f++) {
+        if (mask != NULL && !mask[f]) continue;
+        MIR_item_t item = rc->fc.funcs[f].item;
+        struct timespec g0, g1;
+        clock_gettime(CLOCK_MONOTONIC, &g0);
+        MIR_gen(rc->ctx, item);
+        clock_gettime(CLOCK_MONOTONIC, &g1);
+        atomic_store_explicit(&slots[f], item->u.func->machine_code, memory_order_release);
+        metrics_compile(rc->fc.funcs[f].name, elapsed_sec(&g0, &g1), -1);
+        rc->compiled++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t3);
+    metrics_link(elapsed_sec(&t1, &t2));
+    if (mask != NULL) {
+        metrics_add(&metrics->reopt_recompiles, (uint64_t)rc->compiled);
+        metrics_add(&metrics->tier_published, (uint64_t)rc->compiled);
+    }
+    rc->link_sec = elapsed_sec(&t1, &t2);
+    rc->gen_sec = elapsed_sec(&t2, &t3);
+    rc->pause_sec = elapsed_sec(&t0, &t3);
+
+    MIR_item_t driver = find_func_item(m, "driver");
+    const func_info_t *fi = driver ? func_cache_get(&rc->fc, driver) : NULL;
+    rc->driver = fi ? (int)(fi - rc->fc.funcs) : -1;
+    return rc->driver >= 0 ? 0 : -1;
+}
+
+static void reopt_ctx_free(reopt_ctx_t *rc) {
+    if (rc->ctx == NULL) return;
+    func_cache_free(&rc->fc);
+    MIR_gen_finish(rc->ctx);
+    MIR_finish(rc->ctx);
+    rc->ctx = NULL;
+}
+
+/* Warm up, then time driver(bench_iters) through its dispatch slot. */
+static double reopt_time(_Atomic(void *) *slots, int driver, int64_t *result) {
+    typedef int64_t (*driver_fn_t)(int64_t);
+    driver_fn_t driver_fn = (driver_fn_t)atomic_load_explicit(&slots[driver],
+                                                             memory_order_acquire);
+    (void)driver_fn(WARMUP_ITERS);
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    *result = driver_fn(bench_iters);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return elapsed_sec(&t0, &t1);
+}
+
+/*
+ * reopt_measure: Deploy P0 code, re-optimize the `stale` functions under
+ * P1 into its live slots, then time a full P1 rebuild for reference.
+ */
+static int reopt_measure(const profile_map_t *p0, const profile_map_t *p1,
+                         const unsigned char *stale, int nstale, int n) {
+    _Atomic(void *) *slots = malloc((size_t)n * sizeof(*slots));
+    _Atomic(void *) *full_slots = malloc((size_t)n * sizeof(*full_slots));
+    reopt_ctx_t base, inc, full;
+    memset(&base, 0, sizeof(base));
+    memset(&inc, 0, sizeof(inc));
+    memset(&full, 0, sizeof(full));
+    int ok = slots != NULL && full_slots != NULL;
+    for (int f = 0; ok && f < n; f++) {
+        atomic_init(&slots[f], NULL);
+        atomic_init(&full_slots[f], NULL);
+    }
+
+    /* Deployed code: P0 plan, every function at O2 */
+    int64_t r_before = 0, r_after = 0, r_full = 0;
+    double t_before = 0, t_after = 0, t_full = 0;
+    if (ok) ok = reopt_ctx_build(&base, p0, slots, NULL) == 0;
+    if (ok) t_before = reopt_time(slots, base.driver, &r_before);
+
+    /* Incremental: only stale functions, published into the live slots */
+    if (ok && nstale > 0) ok = reopt_ctx_build(&inc, p1, slots, stale) == 0;
+    if (ok) t_after = reopt_time(slots, base.driver, &r_after);
+
+    /* Reference: full rebuild under P1 */
+    if (ok) ok = reopt_ctx_build(&full, p1, full_slots, NULL) == 0;
+    if (ok) t_full = reopt_time(full_slots, full.driver, &r_full);
+
+    if (ok) {
+        int shown = 0;
+        for (int f = 0; f < n; f++)
+            if (stale[f] && shown++ < PRINT_MAX_ROWS)
+                printf("  recompile  %s\n", full.fc.funcs[f].name);
+        if (shown > PRINT_MAX_ROWS) printf("  ... %d more\n", shown - PRINT_MAX_ROWS);
+
+        printf("\n%-34s  %12s  %12s\n", "", "Incremental", "Full rebuild");
+        printf("%-34s  %12d  %12d\n", "Functions compiled at O2", inc.compiled, full.compiled);
+        printf("%-34s  %12.3f  %12.3f\n", "Link (ms)", 1e3 * inc.link_sec, 1e3 * full.link_sec);
+        printf("%-34s  %12.3f  %12.3f\n", "O2 compile (ms)", 1e3 * inc.gen_sec,
+               1e3 * full.gen_sec);
+        printf("%-34s  %12.3f  %12.3f\n", "Pause (ms)", 1e3 * inc.pause_sec,
+               1e3 * full.pause_sec);
+        printf("%-34s  %12.4f  %12.4f\n", "Steady-state (s)", t_after, t_full);
+        printf("%-34s  %12ld  %12ld\n", "Result", (long)r_after, (long)r_full);
+        printf("  Deployed P0 code: %d mutations, %.4f s; P1 plan: %d mutations\n",
+               base.mutations, t_before, full.mutations);
+        if (r_after != r_full || r_after != r_before)
+            printf("WARNING: re-optimized result differs\n");
+    } else {
+        fprintf(stderr, "ERROR: re-optimization could not compile 'driver'\n");
+    }
+
+    /* Incremental code calls into the deployed context: tear it down last */
+    reopt_ctx_free(&full);
+    reopt_ctx_free(&inc);
+    reopt_ctx_free(&base);
+    free(slots);
+    free(full_slots);
+    return ok ? 0 : -1;
+}
+
+/*
+ * run_reopt: Drift the profile by `drift` (see reopt_drift), apply the
+ * hysteresis band, find the stale functions and measure the incremental
+ * update against a full rebuild. Returns 0 on success, -1 on failure.
+ */
+static int run_reopt(const profile_map_t *profile, const char *drift, double band) {
+    profile_map_t p0, p1;
+    profile_map_init(&p0);
+    profile_map_init(&p1);
+    if (profile_map_copy(&p0, profile) != 0 || profile_map_copy(&p1, profile) != 0) {
+        fprintf(stderr, "ERROR: out of memory copying the profile\n");
+        profile_map_free(&p0);
+        profile_map_free(&p1);
+        return -1;
+    }
+    if (reopt_drift(&p1, drift) != 0) {
+        fprintf(stderr, "ERROR: bad --drift '%s'\n", drift);
+        profile_map_free(&p0);
+        profile_map_free(&p1);
+        return -1;
+    }
+
+    printf("\n================================================================\n");
+    printf("INCREMENTAL RE-OPTIMIZATION (hysteresis band %.3f)\n", band);
+    printf("================================================================\n");
+    int moved = 0, shown = 0;
+    for (int i = 0; i < p1.count; i++) {
+        double was = p0.entries[i].shadow_price, now = p1.entries[i].shadow_price;
+        if (now == was) continue;
+        int past = fabs(now - was) > band;
+        if (!past) p1.entries[i].shadow_price = was;  /* Inside the band: keep P0 */
+        moved += past;
+        if (shown++ < PRINT_MAX_ROWS)
+            printf("  %-12s  lambda %.4f -> %.4f  %s\n", p1.entries[i].func_name,
+                   was, now, past ? "moved" : "within band, kept");
+    }
+    if (shown > PRINT_MAX_ROWS) printf("  ... %d more price changes\n", shown - PRINT_MAX_ROWS);
+    reopt_drift_sites(&p0, &p1);
+
+    site_plan_t plan0, plan1;
+    int rc = -1;
+    if (site_plan_build(COND_SHADOW_PRICE, &p0, 0, &plan0) == 0) {
+        if (site_plan_build(COND_SHADOW_PRICE, &p1, 0, &plan1) == 0) {
+            unsigned char *stale = calloc((size_t)plan1.nfuncs + 1, 1);
+            if (stale != NULL) {
+                int nstale = reopt_stale(&plan0, &plan1, stale);
+                printf("Prices moved past the band: %d; stale functions: %d of %d\n",
+                       moved, nstale, plan1.nfuncs);
+                rc = reopt_measure(&p0, &p1, stale, nstale, plan1.nfuncs);
+                free(stale);
+            }
+            site_plan_free(&plan1);
+        }
+        site_plan_free(&plan0);
+    }
+    profile_map_free(&p0);
+    profile_map_free(&p1);
+    return rc;
+}
+
+/* ========================================================================
+ * SECTION 11: DEOPTIMIZATION GUARD (--guard N)
+ *
+ * A mispriced promotion should not stay in place just because the profile
+ * said so. The guard takes condition N's plan and gives each promotion an
+ * A/B test: the current code against the same code with that one site set
+ * back to MIR_CALL. Both sides are compiled up front, then timed GUARD_RUNS
+ * times each, alternating A and B so that machine-state drift hits both
+ * the same way. If the reverted side's median is more than GUARD_NOISE
+ * faster, the promotion is reverted and that side becomes current.
+ *
+ * Promotions are tried lowest site price first, since the least justified
+ * promotion is the likeliest to be mispriced. Reverting a site does not
+ * replan the rest: like a production guard flipping insn->code, it leaves
+ * every other decision as planned. Every promotion gets one audit line
+ * saying whether it was kept or reverted, and why.
+ * ======================================================================== */
+
+typedef struct {
+    MIR_context_t ctx;
+    func_cache_t  fc;
+    int64_t     (*driver)(int64_t);
+    double        compile_sec;  /* Link + O2 for every function */
+} guard_code_t;
+
+/*
+ * guard_build: Compile condition `condition`'s plan with the sites set in
+ * `reverted` (plan site order) set back to MIR_CALL. Returns 0 on success.
+ */
+static int guard_build(experiment_condition_t condition, const profile_map_t *profile,
+                       int growth_budget, const unsigned char *reverted,
+                       guard_code_t *gc) {
+    memset(gc, 0, sizeof(*gc));
+    gc->ctx = MIR_init();
+    MIR_gen_init(gc->ctx);
+    MIR_gen_set_optimize_level(gc->ctx, 2);
+    MIR_module_t m = benchmark_module(gc->ctx);
+    workload_load(gc->ctx, m);
+    func_cache_build(gc->ctx, m, &gc->fc);
+    unsigned int rng_state = RANDOM_SEED;
+    if (mutate_module(condition, profile, &gc->fc, growth_budget, &rng_state) < 0) return -1;
+
+    /* Same walk as site_plan_build(), so site s is the plan's site s */
+    int s = 0;
+    for (int f = 0; f < gc->fc.count; f++) {
+        MIR_func_t func = gc->fc.funcs[f].item->u.func;
+        for (MIR_insn_t insn = DLIST_HEAD(MIR_insn_t, func->insns);
+             insn != NULL;
+             insn = DLIST_NEXT(MIR_insn_t, insn)) {
+            if (insn->code != MIR_CALL && insn->code != MIR_INLINE) continue;
+            if (func_cache_get(&gc->fc, insn->ops[1].u.ref) == NULL) continue;
+            if (reverted[s++] && insn->code == MIR_INLINE) insn->code = MIR_CALL;
+        }
+    }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    MIR_link(gc->ctx, MIR_set_lazy_gen_interface, NULL);
+    for (int f = 0; f < gc->fc.count; f++) MIR_gen(gc->ctx, gc->fc.funcs[f].item);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    gc->compile_sec = elapsed_sec(&t0, &t1);
+
+    MIR_item_t driver = find_func_item(m, "driver");
+    if (driver == NULL || driver->addr == NULL) return -1;
+    gc->driver = (int64_t (*)(int64_t))driver->addr;
+    return 0;
+}
+
+static void guard_free(guard_code_t *gc) {
+    if (gc->ctx == NULL) return;
+    func_cache_free(&gc->fc);
+    MIR_gen_finish(gc->ctx);
+    MIR_finish(gc->ctx);
+    gc->ctx = NULL;
+}
+
+/*
+ * guard_ab: Interleaved timing of `a` and `b`; medians in *ma and *mb.
+ * Returns 0 if both sides computed the same result.
+ */
+static int guard_ab(const guard_code_t *a, const guard_code_t *b, double *ma, double *mb) {
+    double ta[GUARD_RUNS], tb[GUARD_RUNS], scratch[GUARD_RUNS];
+    int64_t ra = 0, rb = 0;
+    (void)a->driver(WARMUP_ITERS);
+    (void)b->driver(WARMUP_ITERS);
+    for (int r = 0; r < GUARD_RUNS; r++) {
+        struct timespec t0, t1, t2;
         clock_gettime(CLOCK_MONOTONIC, &t0);
-        int64_t result = driver_fn(BENCH_N);
+        ra = a->driver(bench_iters);
         clock_gettime(CLOCK_MONOTONIC, &t1);
+        rb = b->driver(bench_iters);
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+        ta[r] = elapsed_sec(&t0, &t1);
+        tb[r] = elapsed_sec(&t1, &t2);
+    }
+    *ma = sample_median(ta, GUARD_RUNS, scratch);
+    *mb = sample_median(tb, GUARD_RUNS, scratch);
+    return ra == rb ? 0 : -1;
+}
 
-        double elapsed = (t1.tv_sec - t0.tv_sec) +
-                         (t1.tv_nsec - t0.tv_nsec) / 1e9;
-        out->times[run] = elapsed;
-        if (run == 0) out->result = result;
+/* Promotion order: lowest site price first */
+typedef struct {
+    int    site;
+    int    caller;  /* Dense caller ID */
+    double lambda;
+} guard_promo_t;
 
-        /* Step 7: Tear down */
-        MIR_gen_finish(ctx);
-        MIR_finish(ctx);
+static int guard_by_price(const void *a, const void *b) {
+    double la = ((const guard_promo_t *)a)->lambda, lb = ((const guard_promo_t *)b)->lambda;
+    return (la > lb) - (la < lb);
+}
+
+/*
+ * run_guard: A/B every promotion of `condition`, revert the ones that
+ * lose, and print the audit trail and the planned vs guarded comparison.
+ * Returns 0 on success, -1 on failure.
+ */
+static int run_guard(experiment_condition_t condition, const profile_map_t *profile,
+                     int growth_budget) {
+    site_plan_t plan;
+    if (site_plan_build(condition, profile, growth_budget, &plan) != 0) return -1;
+
+    printf("\n================================================================\n");
+    printf("DEOPTIMIZATION GUARD: %s (%d runs per side, noise %.1f%%)\n",
+           condition_names[condition], GUARD_RUNS, 100.0 * GUARD_NOISE);
+    printf("================================================================\n");
+
+    unsigned char *reverted = calloc((size_t)plan.nsites + 1, 1);
+    guard_promo_t *promos = malloc(((size_t)plan.nsites + 1) * sizeof(*promos));
+    guard_code_t planned, cur, trial;
+    memset(&planned, 0, sizeof(planned));
+    memset(&cur, 0, sizeof(cur));
+    int rc = -1;
+    if (reverted == NULL || promos == NULL ||
+        guard_build(condition, profile, growth_budget, reverted, &planned) != 0) {
+        fprintf(stderr, "ERROR: cannot compile the planned code\n");
+        guard_free(&planned);
+        free(reverted);
+        free(promos);
+        site_plan_free(&plan);
+        return -1;
     }
 
-    /* Compute statistics */
-    double sum = 0, sum2 = 0;
-    for (int i = 0; i < NUM_RUNS; i++) sum += out->times[i];
-    out->mean = sum / NUM_RUNS;
-    for (int i = 0; i < NUM_RUNS; i++) {
-        double d = out->times[i] - out->mean;
-        sum2 += d * d;
+    /* Names come from the planned context, which lives to the end */
+    int npromos = 0;
+    for (int f = 0; f < plan.nfuncs; f++)
+        for (int s = plan.first[f]; s < plan.first[f + 1]; s++) {
+            if (!plan.inl[s]) continue;
+            promos[npromos].site = s;
+            promos[npromos].caller = f;
+            promos[npromos++].lambda = profile_site_lambda(profile, planned.fc.funcs[f].name,
+                plan.index[s], planned.fc.funcs[plan.callee[s]].name);
+        }
+    qsort(promos, (size_t)npromos, sizeof(*promos), guard_by_price);
+    int checked = npromos < GUARD_MAX_SITES ? npromos : GUARD_MAX_SITES;
+    printf("Promotions: %d (A/B tested: %d)\n\n", npromos, checked);
+
+    printf("guard,caller,index,callee,lambda,kept_sec,reverted_sec,decision,reason\n");
+    int nreverted = 0, ok = 1;
+    cur = planned;  /* Aliases the planned code until the first revert */
+    for (int i = 0; i < npromos && ok; i++) {
+        int s = promos[i].site;
+        const char *cn = planned.fc.funcs[promos[i].caller].name;
+        const char *en = planned.fc.funcs[plan.callee[s]].name;
+        if (i >= checked) {
+            printf("%d,%s,%d,%s,%.4f,,,kept,not tested (limit %d)\n", i + 1, cn,
+                   plan.index[s], en, promos[i].lambda, GUARD_MAX_SITES);
+            continue;
+        }
+
+        reverted[s] = 1;
+        if (guard_build(condition, profile, growth_budget, reverted, &trial) != 0) {
+            guard_free(&trial);
+            ok = 0;
+            break;
+        }
+        double t_kept, t_rev;
+        int same = guard_ab(&cur, &trial, &t_kept, &t_rev) == 0;
+        int revert = same && t_rev < t_kept * (1.0 - GUARD_NOISE);
+        const char *reason = !same ? "result differs when reverted"
+                           : revert ? "reverting is faster"
+                           : t_rev > t_kept * (1.0 + GUARD_NOISE) ? "inlining is faster"
+                           : "within noise";
+        printf("%d,%s,%d,%s,%.4f,%.6f,%.6f,%s,%s\n", i + 1, cn, plan.index[s], en,
+               promos[i].lambda, t_kept, t_rev, revert ? "reverted" : "kept", reason);
+        if (revert) {
+            if (cur.ctx != planned.ctx) guard_free(&cur);
+            cur = trial;
+            nreverted++;
+            metrics_add(&metrics->guard_reverts, 1);
+        } else {
+            reverted[s] = 0;
+            guard_free(&trial);
+        }
     }
-    out->stddev = (NUM_RUNS > 1) ? sqrt(sum2 / (NUM_RUNS - 1)) : 0.0;
 
-    return 0;
+    if (ok) {
+        double t_planned, t_guarded;
+        int same = guard_ab(&planned, &cur, &t_planned, &t_guarded) == 0;
+        printf("\n%-34s  %12s  %12s\n", "", "Planned", "Guarded");
+        printf("%-34s  %12d  %12d\n", "Promotions", npromos, npromos - nreverted);
+        printf("%-34s  %12.4f  %12.4f\n", "Median (s)", t_planned, t_guarded);
+        printf("  Reverted %d of %d promotions (%+.1f%%)\n", nreverted, npromos,
+               100.0 * (t_guarded - t_planned) / t_planned);
+        if (!same) printf("WARNING: guarded result differs from planned\n");
+        rc = 0;
+    } else {
+        fprintf(stderr, "ERROR: cannot compile a guard trial\n");
+    }
+
+    if (cur.ctx != planned.ctx) guard_free(&cur);
+    guard_free(&planned);
+    free(reverted);
+    free(promos);
+    site_plan_free(&plan);
+    return rc;
 }
 
 /* ========================================================================
- * SECTION 7: MAIN - ORCHESTRATE THE FULL EXPERIMENT
+ * SECTION 12: MAIN - ORCHESTRATE THE FULL EXPERIMENT
  * ======================================================================== */
 
 /*
  * cohen_d: Effect size between two conditions.
- * d = (mean_a - mean_b) / pooled_sd
+ * d = (mean_a - mean_b) / pooled_sd, with the SDs weighted by their run
+ * counts, which differ between conditions under adaptive runs:
+ * pooled_var = ((n_a - 1) sd_a^2 + (n_b - 1) sd_b^2) / (n_a + n_b - 2)
  */
 static double cohen_d(const condition_result_t *a, const condition_result_t *b) {
-    double pooled_var = (a->stddev * a->stddev + b->stddev * b->stddev) / 2.0;
+    int df = a->runs + b->runs - 2;
+    if (df < 1) return 0.0;
+    double pooled_var = ((a->runs - 1) * a->stddev * a->stddev +
+                         (b->runs - 1) * b->stddev * b->stddev) / df;
     double pooled_sd = sqrt(pooled_var);
     if (pooled_sd < 1e-12) return 0.0;
     return (a->mean - b->mean) / pooled_sd;
 }
 
-int main(void) {
+/*
+ * print_median_delta: Robust companion to cohen_d. Reports the relative
+ * median difference of `b` against `a` and whether the two 95% bootstrap
+ * CIs are disjoint, which resolves shifts well under 1% once --adaptive
+ * has narrowed the CIs.
+ */
+static void print_median_delta(const char *an, const condition_result_t *a,
+                               const char *bn, const condition_result_t *b) {
+    double delta = (a->median > 0.0) ? 100.0 * (b->median - a->median) / a->median : 0.0;
+    int disjoint = a->ci_hi < b->ci_lo || b->ci_hi < a->ci_lo;
+    printf("      Median %s=%.4f [%.4f, %.4f], %s=%.4f [%.4f, %.4f], delta=%+.2f%%%s\n",
+           an, a->median, a->ci_lo, a->ci_hi, bn, b->median, b->ci_lo, b->ci_hi, delta,
+           disjoint ? " (95% CIs disjoint)" : " (CIs overlap)");
+}
+
+/*
+ * Command-line options. Defaults reproduce the published experiment.
+ */
+typedef struct {
+    int profile_threads;  /* Telemetry workers, one shard each */
+    int growth_budget;    /* COND_KNAPSACK module-wide growth budget, insns */
+    int iterative;        /* Run dual ascent instead of the condition sweep */
+    int tiered;           /* Run the tiered JIT comparison instead */
+    int compile_threads;  /* Background tier-up workers (--tiered) */
+    int rounds;           /* Dual-ascent round limit */
+    const char *save_profile;  /* Write the Phase 1 profile here */
+    const char *load_profile;  /* mmap this profile instead of profiling */
+    int reuse_code;       /* One context + one compile per condition */
+    int parallel;         /* One pinned thread per condition */
+    int cores[COND_COUNT];  /* Core for condition c (--cores) */
+    bench_config_t bench; /* Sampling plan per condition */
+    synth_config_t synth; /* Generated workload; funcs = 0 keeps benchmark_ir */
+    int64_t iters;        /* Timed driver(n) argument; 0 = workload default */
+    int sweep;            /* Run the parameter sweep instead */
+    sweep_spec_t sweep_spec;
+    int reopt;            /* Run incremental re-optimization instead */
+    const char *drift;    /* --drift SPEC; NULL swaps hottest and coldest */
+    double reopt_band;    /* Hysteresis band on price moves */
+    int guard;            /* Condition number to guard (1-based); 0 = off */
+    const char *metrics;       /* Shared metrics block (--metrics) */
+    const char *metrics_dump;  /* Print this block and exit */
+} experiment_options_t;
+
+/* Parse "2,3,5" into cores[]; a short list is repeated. Returns 0 on success. */
+static int parse_core_list(const char *list, int *cores) {
+    int n = 0;
+    for (const char *p = list; *p && n < COND_COUNT;) {
+        char *end;
+        long cpu = strtol(p, &end, 10);
+        if (end == p || cpu < 0) return -1;
+        cores[n++] = (int)cpu;
+        p = (*end == ',') ? end + 1 : end;
+        if (*end != ',' && *end != '\0') return -1;
+    }
+    if (n == 0) return -1;
+    for (int c = n; c < COND_COUNT; c++) cores[c] = cores[c % n];
+    return 0;
+}
+
+static void print_usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --profile-threads N   Telemetry worker threads (default %d)\n"
+            "  --budget N            Growth budget in insns (default %d)\n"
+            "  --iterative           Iterative dual-ascent price updates\n"
+            "  --tiered              Tiered JIT (O0 + probes, hot code to O2) vs eager\n"
+            "  --compile-threads N   With --tiered: also tier up on N background\n"
+            "                        compile workers and compare request latency\n"
+            "  --rounds N            Dual-ascent round limit (default %d)\n"
+            "  --save-profile PATH   Write the profile database after Phase 1\n"
+            "  --load-profile PATH   Map a saved profile instead of profiling\n"
+            "  --reuse-ctx           Compile once per condition, time that code\n"
+            "  --parallel            Run conditions concurrently on pinned cores\n"
+            "  --cores LIST          Cores for --parallel, e.g. 2,3,4,5,6,7\n"
+            "                        (default: 1..%d)\n"
+            "  --adaptive            Sample until the median's 95%% CI is narrow\n"
+            "  --ci PCT              Target CI width, %% of median (default %.1f)\n"
+            "  --max-runs N          Adaptive run cap (default %d, max %d)\n"
+            "  --cycles              Also count rdtscp cycles per run\n"
+            "  --perf                Read hardware counters per run (Linux)\n"
+            "  --synthetic N         Generate an N-function workload instead\n"
+            "  --shape S             chain | tree | dag (default %s)\n"
+            "  --fanout N            Children per function, tree/dag (default %d)\n"
+            "  --zipf S              Hotness exponent (default %.1f)\n"
+            "  --seed N              Sizes and dag edges (default %d)\n"
+            "  --modules K           Split the synthetic workload over K modules\n"
+            "                        (s_c in module c %% K, imports/exports between)\n"
+            "  --iters N             Timed driver(n) (default %lld, synthetic %lld)\n"
+            "  --sweep SPEC          Sweep formula constants over a grid, e.g.\n"
+            "                        floor=0.05:0.2:0.05,ceil=2:8:2,tfloor=5,base=30:70:10\n"
+            "  --sweep-samples N     Draw N random points from the SPEC box instead\n"
+            "  --sweep-threads N     Sweep workers (default: online cores - 1)\n"
+            "  --reopt               Drift the profile, recompile only stale functions\n"
+            "                        at O2 (the whole module is still re-planned and\n"
+            "                        relinked)\n"
+            "  --drift SPEC          New prices for --reopt, e.g. f_cold1=1.0,f_hot1=0.001\n"
+            "                        (default: swap the hottest and coldest)\n"
+            "  --reopt-band X        Ignore price moves up to X (default %.2f)\n"
+            "  --guard N             A/B every promotion of condition N (1-%d),\n"
+            "                        revert the ones that make it slower\n"
+            "  --metrics PATH        Keep live counters in a shared file mapping\n"
+            "  --metrics-dump PATH   Print a metrics block as Prometheus text, exit\n"
+            "  --pressure-cost N     Charge N insns per live register over the\n"
+            "                        allocatable set (pre-RA estimate, not generator\n"
+            "                        spills) when pricing a promotion (default %d = off;\n"
+            "                        %d registers)\n"
+            "  --layout              Compile hot functions first so their code is\n"
+            "                        contiguous (price >= %.2f), cold code after\n"
+            "  --huge-code           Back code regions with huge pages (Linux THP)\n",
+            prog, PROFILE_THREADS, KNAPSACK_BUDGET, ITER_MAX_ROUNDS, COND_COUNT,
+            ADAPT_CI_TARGET * 100.0, MAX_RUNS, MAX_RUNS, synth_shape_names[SYNTH_SHAPE],
+            SYNTH_FANOUT, SYNTH_ZIPF, RANDOM_SEED, (long long)BENCH_N,
+            (long long)SYNTH_BENCH_N, REOPT_BAND, COND_COUNT, PRESSURE_COST, PRESSURE_REGS,
+            LAYOUT_HOT_PRICE);
+}
+
+/* Returns 0 on success, -1 on a bad or unknown option. */
+static int parse_options(int argc, char *argv[], experiment_options_t *opts) {
+    opts->profile_threads = PROFILE_THREADS;
+    opts->growth_budget = KNAPSACK_BUDGET;
+    opts->iterative = 0;
+    opts->tiered = 0;
+    opts->compile_threads = COMPILE_THREADS;
+    opts->rounds = ITER_MAX_ROUNDS;
+    opts->save_profile = NULL;
+    opts->load_profile = NULL;
+    opts->reuse_code = 0;
+    opts->parallel = 0;
+    for (int c = 0; c < COND_COUNT; c++) opts->cores[c] = c + 1;  /* Leave cpu0 to the OS */
+    opts->bench = bench_fixed(NUM_RUNS);
+    opts->synth.funcs = 0;
+    opts->synth.shape = SYNTH_SHAPE;
+    opts->synth.fanout = SYNTH_FANOUT;
+    opts->synth.zipf = SYNTH_ZIPF;
+    opts->synth.seed = RANDOM_SEED;
+    opts->synth.modules = 1;
+    opts->iters = 0;
+    opts->sweep = 0;
+    sweep_spec_default(&opts->sweep_spec);
+    opts->reopt = 0;
+    opts->drift = NULL;
+    opts->reopt_band = REOPT_BAND;
+    opts->guard = 0;
+    opts->metrics = NULL;
+    opts->metrics_dump = NULL;
+    int adaptive = 0, max_runs = MAX_RUNS;
+    double ci_target = ADAPT_CI_TARGET;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--profile-threads") == 0 && i + 1 < argc) {
+            opts->profile_threads = atoi(argv[++i]);
+            if (opts->profile_threads < 1) return -1;
+        } else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            opts->growth_budget = atoi(argv[++i]);
+            if (opts->growth_budget < 0) return -1;
+        } else if (strcmp(argv[i], "--iterative") == 0) {
+            opts->iterative = 1;
+        } else if (strcmp(argv[i], "--tiered") == 0) {
+            opts->tiered = 1;
+        } else if (strcmp(argv[i], "--compile-threads") == 0 && i + 1 < argc) {
+            opts->compile_threads = atoi(argv[++i]);
+            if (opts->compile_threads < 0 || opts->compile_threads > COMPILE_MAX_THREADS) return -1;
+        } else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            opts->rounds = atoi(argv[++i]);
+            if (opts->rounds < 1) return -1;
+        } else if (strcmp(argv[i], "--save-profile") == 0 && i + 1 < argc) {
+            opts->save_profile = argv[++i];
+        } else if (strcmp(argv[i], "--load-profile") == 0 && i + 1 < argc) {
+            opts->load_profile = argv[++i];
+        } else if (strcmp(argv[i], "--reuse-ctx") == 0) {
+            opts->reuse_code = 1;
+        } else if (strcmp(argv[i], "--parallel") == 0) {
+            opts->parallel = 1;
+        } else if (strcmp(argv[i], "--cores") == 0 && i + 1 < argc) {
+            if (parse_core_list(argv[++i], opts->cores) != 0) return -1;
+        } else if (strcmp(argv[i], "--adaptive") == 0) {
+            adaptive = 1;
+        } else if (strcmp(argv[i], "--ci") == 0 && i + 1 < argc) {
+            ci_target = atof(argv[++i]) / 100.0;
+            if (ci_target <= 0.0) return -1;
+        } else if (strcmp(argv[i], "--max-runs") == 0 && i + 1 < argc) {
+            max_runs = atoi(argv[++i]);
+            if (max_runs < ADAPT_MIN_RUNS || max_runs > MAX_RUNS) return -1;
+        } else if (strcmp(argv[i], "--cycles") == 0) {
+            opts->bench.cycles = 1;
+        } else if (strcmp(argv[i], "--perf") == 0) {
+            opts->bench.perf = 1;
+        } else if (strcmp(argv[i], "--synthetic") == 0 && i + 1 < argc) {
+            opts->synth.funcs = atoi(argv[++i]);
+            if (opts->synth.funcs < 1) return -1;
+        } else if (strcmp(argv[i], "--shape") == 0 && i + 1 < argc) {
+            const char *shape = argv[++i];
+            int k = 0;
+            while (k < SHAPE_COUNT && strcmp(shape, synth_shape_names[k]) != 0) k++;
+            if (k == SHAPE_COUNT) return -1;
+            opts->synth.shape = (synth_shape_t)k;
+        } else if (strcmp(argv[i], "--fanout") == 0 && i + 1 < argc) {
+            opts->synth.fanout = atoi(argv[++i]);
+            if (opts->synth.fanout < 1) return -1;
+        } else if (strcmp(argv[i], "--zipf") == 0 && i + 1 < argc) {
+            opts->synth.zipf = atof(argv[++i]);
+            if (opts->synth.zipf < 0.0) return -1;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            opts->synth.seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--modules") == 0 && i + 1 < argc) {
+            opts->synth.modules = atoi(argv[++i]);
+            if (opts->synth.modules < 1) return -1;
+        } else if (strcmp(argv[i], "--iters") == 0 && i + 1 < argc) {
+            opts->iters = atoll(argv[++i]);
+            if (opts->iters < 1) return -1;
+        } else if (strcmp(argv[i], "--sweep") == 0 && i + 1 < argc) {
+            opts->sweep = 1;
+            if (sweep_spec_parse(argv[++i], &opts->sweep_spec) != 0) return -1;
+        } else if (strcmp(argv[i], "--sweep-samples") == 0 && i + 1 < argc) {
+            opts->sweep_spec.samples = atoi(argv[++i]);
+            if (opts->sweep_spec.samples < 1) return -1;
+        } else if (strcmp(argv[i], "--sweep-threads") == 0 && i + 1 < argc) {
+            opts->sweep_spec.threads = atoi(argv[++i]);
+            if (opts->sweep_spec.threads < 1) return -1;
+        } else if (strcmp(argv[i], "--reopt") == 0) {
+            opts->reopt = 1;
+        } else if (strcmp(argv[i], "--drift") == 0 && i + 1 < argc) {
+            opts->drift = argv[++i];
+        } else if (strcmp(argv[i], "--reopt-band") == 0 && i + 1 < argc) {
+            opts->reopt_band = atof(argv[++i]);
+            if (opts->reopt_band < 0.0) return -1;
+        } else if (strcmp(argv[i], "--guard") == 0 && i + 1 < argc) {
+            opts->guard = atoi(argv[++i]);
+            if (opts->guard < 1 || opts->guard > COND_COUNT) return -1;
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            opts->metrics = argv[++i];
+        } else if (strcmp(argv[i], "--metrics-dump") == 0 && i + 1 < argc) {
+            opts->metrics_dump = argv[++i];
+        } else if (strcmp(argv[i], "--pressure-cost") == 0 && i + 1 < argc) {
+            pressure_cost = atoi(argv[++i]);
+            if (pressure_cost < 0) return -1;
+        } else if (strcmp(argv[i], "--layout") == 0) {
+            code_layout = 1;
+#ifdef __linux__
+        } else if (strcmp(argv[i], "--huge-code") == 0) {
+            huge_code = 1;
+#endif
+        } else {
+            return -1;
+        }
+    }
+    /* The tier-up pool needs a dispatch slot for every function */
+    if (opts->tiered && opts->compile_threads > 0 && opts->synth.funcs + 1 > TIER_MAX_FUNCS)
+        return -1;
+    /* Modules split the synthetic workload; tier 0 patches one module only */
+    if (opts->synth.modules > 1 &&
+        (opts->synth.modules > opts->synth.funcs || opts->tiered)) return -1;
+    if (adaptive) {
+        opts->bench.min_runs = ADAPT_MIN_RUNS;
+        opts->bench.max_runs = max_runs;
+        opts->bench.ci_target = ci_target;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    experiment_options_t opts;
+    if (parse_options(argc, argv, &opts) != 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (opts.metrics_dump != NULL) return metrics_dump(opts.metrics_dump) == 0 ? 0 : 1;
+
     printf("================================================================\n");
     printf("NUM Shadow-Price Inlining Experiment (Paper 2, Option A)\n");
     printf("================================================================\n");
-    printf("Benchmark: 8-function module (4 hot, 2 warm, 2 cold)\n");
-    printf("Iterations: %lld\n", (long long)BENCH_N);
-    printf("Runs per condition: %d\n", NUM_RUNS);
-    printf("Optimization level: O2\n\n");
-
-    /* ---- Phase 1: Profile the benchmark ---- */
-    printf("Phase 1: Profiling benchmark IR...\n");
+    if (opts.synth.funcs > 0) {
+        bench_iters = SYNTH_BENCH_N;
+        printf("Benchmark: synthetic %d-function %s (fanout %d, zipf %.2f, seed %u)\n",
+               opts.synth.funcs, synth_shape_names[opts.synth.shape], opts.synth.fanout,
+               opts.synth.zipf, opts.synth.seed);
+        if (opts.synth.modules > 1)
+            printf("Modules: %d (cross-module calls through import/export items)\n",
+                   opts.synth.modules);
+    } else {
+        printf("Benchmark: 8-function module (4 hot, 2 warm, 2 cold)\n");
+    }
+    if (opts.iters > 0) bench_iters = opts.iters;
+    printf("Iterations: %lld\n", (long long)bench_iters);
+    if (opts.bench.ci_target > 0.0)
+        printf("Run budget per condition: %d-%d (adaptive, 95%% CI < %.2f%% of median)\n",
+               opts.bench.min_runs, opts.bench.max_runs, opts.bench.ci_target * 100.0);
+    else
+        printf("Runs per condition: %d\n", NUM_RUNS);
+    printf("Optimization level: O2\n");
+    if (pressure_cost > 0)
+        printf("Pressure-aware pricing: %d insns per pre-RA live register over %d\n",
+               pressure_cost, PRESSURE_REGS);
+    if (code_layout)
+        printf("Code layout: hot first (price >= %.2f, driver first), cold after\n",
+               LAYOUT_HOT_PRICE);
+    if (huge_code)
+        printf("Code regions: %zu KB aligned blocks, MADV_HUGEPAGE\n", HUGE_CODE_PAGE >> 10);
+    if (opts.metrics != NULL) {
+        num_metrics_t *mb = metrics_map(opts.metrics, 1);
+        if (mb != NULL) {
+            metrics = mb;
+            printf("Metrics: %s (live; read with --metrics-dump)\n", opts.metrics);
+        } else {
+            fprintf(stderr, "  WARNING: cannot map metrics block '%s'\n", opts.metrics);
+        }
+    }
+    printf("\n");
 
-    /* We need a temporary context just to parse the IR and profile it */
-    MIR_context_t prof_ctx = MIR_init();
-    MIR_scan_string(prof_ctx, benchmark_ir);
-    MIR_module_t prof_m = DLIST_TAIL(MIR_module_t, *MIR_get_module_list(prof_ctx));
+    /* Build once; every later context reads the binary template */
+    if (benchmark_template_init(&opts.synth) != 0) {
+        if (opts.synth.funcs > 0) {
+            fprintf(stderr, "ERROR: cannot generate the synthetic workload\n");
+            return 1;
+        }
+        fprintf(stderr, "  WARNING: IR template unavailable, re-scanning per context\n");
+    }
 
+    /* ---- Phase 1: Profile the benchmark ---- */
     profile_map_t profile;
     profile_map_init(&profile);
+    profile_db_t db;
+    memset(&db, 0, sizeof(db));
 
-    /* Synthetic profiling based on known benchmark structure:
-     *   f_hot1..f_hot4:  called N times each    -> weight 1000 (lambda ~ 1.0)
-     *   f_warm1,f_warm2: called N/10 times each -> weight 100  (lambda ~ 0.1)
-     *   f_cold1,f_cold2: called N/1000 each     -> weight 1    (lambda ~ 0.001)
-     */
-    for (int i = 0; i < 1000; i++) profile_map_increment(&profile, "f_hot1");
-    for (int i = 0; i < 1000; i++) profile_map_increment(&profile, "f_hot2");
-    for (int i = 0; i < 1000; i++) profile_map_increment(&profile, "f_hot3");
-    for (int i = 0; i < 1000; i++) profile_map_increment(&profile, "f_hot4");
-    for (int i = 0; i < 100; i++) profile_map_increment(&profile, "f_warm1");
-    for (int i = 0; i < 100; i++) profile_map_increment(&profile, "f_warm2");
-    profile_map_increment(&profile, "f_cold1");
-    profile_map_increment(&profile, "f_cold2");
+    if (opts.load_profile != NULL) {
+        /* Warm start: prices come straight from the mapped file */
+        if (profile_db_open(opts.load_profile, &db) != 0) {
+            fprintf(stderr, "ERROR: cannot load profile database '%s'\n",
+                    opts.load_profile);
+            benchmark_template_free();
+            return 1;
+        }
+        profile.db = &db;
+        printf("Phase 1: Loaded profile database %s (%u entries, mmap)\n",
+               opts.load_profile, db.header->count);
+    } else {
+        printf("Phase 1: Profiling benchmark IR (interpreter, n=%lld, threads=%d)...\n",
+               (long long)PROFILE_N, opts.profile_threads);
+
+        /*
+         * Measured profile: run driver(PROFILE_N) under the interpreter with
+         * entry counters. Expected shape (per N iterations of the driver loop):
+         *   f_hot1..f_hot4:  N each      (lambda ~ 1.0)
+         *   f_warm1,f_warm2: N/10 each   (lambda ~ 0.1)
+         *   f_cold1,f_cold2: N/1000 each (lambda ~ 0.001)
+         */
+        if (profile_module_runtime(benchmark_module, "driver", PROFILE_N,
+                                   opts.profile_threads, &profile) != 0) {
+            fprintf(stderr, "  WARNING: telemetry run failed, "
+                            "falling back to static call-site counts\n");
+            MIR_context_t prof_ctx = MIR_init();
+            MIR_module_t prof_m = benchmark_module(prof_ctx);
+            profile_module(prof_ctx, prof_m, &profile);
+            MIR_finish(prof_ctx);
+        }
+        profile_map_print(&profile);
+    }
 
-    profile_map_normalize(&profile);
-    profile_map_print(&profile);
+    /* Modes that walk the map by name need the database copied in */
+    if (profile.db != NULL && (opts.iterative || opts.reopt || opts.save_profile != NULL)) {
+        MIR_context_t ctx = MIR_init();
+        profile_map_hydrate(&profile, &db, benchmark_module(ctx));
+        MIR_finish(ctx);
+    }
 
-    MIR_finish(prof_ctx);
+    /* The profile is final after Phase 1, so persist it now */
+    if (opts.save_profile != NULL) {
+        if (profile_db_write(opts.save_profile, &profile) == 0)
+            printf("  Saved profile database %s (%d entries)\n",
+                   opts.save_profile, profile.count);
+        else
+            fprintf(stderr, "  WARNING: cannot write profile database '%s'\n",
+                    opts.save_profile);
+    }
 
-    /* Print instruction counts for reference */
+    /* Print instruction counts and threshold decisions for reference */
     printf("\n  Function sizes (IR instruction count):\n");
     {
         MIR_context_t tmp_ctx = MIR_init();
-        MIR_scan_string(tmp_ctx, benchmark_ir);
-        MIR_module_t tmp_m = DLIST_TAIL(MIR_module_t, *MIR_get_module_list(tmp_ctx));
-        for (MIR_item_t item = DLIST_HEAD(MIR_item_t, tmp_m->items);
-             item != NULL;
-             item = DLIST_NEXT(MIR_item_t, item)) {
-            if (item->item_type == MIR_func_item) {
-                int n = count_func_insns(item->u.func);
-                printf("    %-20s  %d insns", item->u.func->name, n);
-                if (n > MIR_CALL_INLINE_THRESHOLD && n <= MIR_INLINE_THRESHOLD)
-                    printf("  [IN SWEET SPOT: 50 < n <= 200]");
-                else if (n <= MIR_CALL_INLINE_THRESHOLD)
-                    printf("  [AUTO-INLINED by MIR_CALL threshold]");
-                else
-                    printf("  [TOO LARGE for any inlining]");
-                printf("\n");
-            }
+        MIR_module_t tmp_m = benchmark_module(tmp_ctx);
+        workload_load(tmp_ctx, tmp_m);
+        func_cache_t fc;
+        func_cache_build(tmp_ctx, tmp_m, &fc);
+        int band[3] = {0, 0, 0};  /* auto-inlined, sweet spot, too large */
+        long total = 0;
+        for (int k = 0; k < fc.count; k++) {
+            int n = fc.funcs[k].insns;
+            int b = n <= MIR_CALL_INLINE_THRESHOLD ? 0 : n <= MIR_INLINE_THRESHOLD ? 1 : 2;
+            band[b]++;
+            total += n;
+            if (k >= PRINT_MAX_ROWS) continue;
+            printf("    %-20s  %d insns", fc.funcs[k].name, n);
+            if (b == 1)
+                printf("  [IN SWEET SPOT: 50 < n <= 200]");
+            else if (b == 0)
+                printf("  [AUTO-INLINED by MIR_CALL threshold]");
+            else
+                printf("  [TOO LARGE for any inlining]");
+            printf("\n");
         }
+        if (fc.count > PRINT_MAX_ROWS)
+            printf("    ... %d more; %d functions, %ld insns: %d auto-inlined, "
+                   "%d in sweet spot, %d too large\n", fc.count - PRINT_MAX_ROWS,
+                   fc.count, total, band[0], band[1], band[2]);
+        if (benchmark_nmodules > 1)
+            printf("    %d modules, %d imports resolved, %d cross-module call sites\n",
+                   benchmark_nmodules, fc.imports, count_cross_module_sites(&fc, 0));
+
+        /* Threshold decisions for shadow-price vs inverted */
+        printf("\n  Threshold decisions (shadow-price formula):\n");
+        for (int k = 0; k < fc.count && k < PRINT_MAX_ROWS; k++) {
+            double lambda;
+            if (!profile_map_lookup(&profile, fc.funcs[k].name, &lambda)) continue;
+            int t_normal = compute_adjusted_threshold(lambda, 0);
+            int t_invert = compute_adjusted_threshold(lambda, 1);
+            printf("    %-20s  lambda=%.4f  T_shadow=%3d  T_inverted=%3d\n",
+                   fc.funcs[k].name, lambda, t_normal, t_invert);
+        }
+        func_cache_free(&fc);
         MIR_finish(tmp_ctx);
     }
 
-    /* Print threshold decisions for shadow-price vs inverted */
-    printf("\n  Threshold decisions (shadow-price formula):\n");
-    for (int i = 0; i < profile.count; i++) {
-        int t_normal = compute_adjusted_threshold(profile.entries[i].shadow_price, 0);
-        int t_invert = compute_adjusted_threshold(profile.entries[i].shadow_price, 1);
-        printf("    %-20s  lambda=%.4f  T_shadow=%3d  T_inverted=%3d\n",
-               profile.entries[i].func_name,
-               profile.entries[i].shadow_price,
-               t_normal, t_invert);
+    if (opts.iterative) {
+        int rc = run_iterative(&profile, opts.growth_budget, opts.rounds,
+                               opts.reuse_code);
+        profile_map_free(&profile);
+        profile_db_close(&db);
+        benchmark_template_free();
+        return rc == 0 ? 0 : 1;
+    }
+
+    if (opts.sweep) {
+        int rc = run_sweep(&profile, opts.growth_budget, &opts.sweep_spec);
+        profile_map_free(&profile);
+        profile_db_close(&db);
+        benchmark_template_free();
+        return rc == 0 ? 0 : 1;
     }
 
-    /* ---- Phase 2+3: Run all 5 conditions ---- */
+    if (opts.guard > 0) {
+        int rc = run_guard((experiment_condition_t)(opts.guard - 1), &profile,
+                           opts.growth_budget);
+        profile_map_free(&profile);
+        profile_db_close(&db);
+        benchmark_template_free();
+        return rc == 0 ? 0 : 1;
+    }
+
+    if (opts.reopt) {
+        int rc = run_reopt(&profile, opts.drift, opts.reopt_band);
+        profile_map_free(&profile);
+        profile_db_close(&db);
+        benchmark_template_free();
+        return rc == 0 ? 0 : 1;
+    }
+
+    if (opts.tiered) {
+        int rc = run_tiered(&profile, opts.growth_budget, NUM_RUNS,
+                            opts.compile_threads);
+        profile_map_free(&profile);
+        profile_db_close(&db);
+        benchmark_template_free();
+        return rc == 0 ? 0 : 1;
+    }
+
+    /* ---- Phase 2+3: Run all conditions ---- */
     printf("\n================================================================\n");
-    printf("Phase 2+3: Running %d conditions x %d runs each...\n\n",
-           COND_COUNT, NUM_RUNS);
+    printf("Phase 2+3: Running %d conditions x %s%d runs each%s...\n\n",
+           COND_COUNT, opts.bench.ci_target > 0.0 ? "up to " : "",
+           opts.bench.max_runs, opts.parallel ? " (parallel, pinned)" : "");
 
     condition_result_t results[COND_COUNT];
 
+    if (opts.parallel) {
+        if (run_conditions_parallel(&profile, opts.growth_budget, &opts.bench,
+                                    opts.reuse_code, opts.cores, results) != 0) {
+            fprintf(stderr, "\n  FAILED!\n");
+            profile_map_free(&profile);
+            profile_db_close(&db);
+            benchmark_template_free();
+            return 1;
+        }
+    }
+
     for (int c = 0; c < COND_COUNT; c++) {
         printf("  Condition %d: %s ...", c + 1, condition_names[c]);
         fflush(stdout);
 
-        if (run_condition((experiment_condition_t)c, &profile, &results[c]) != 0) {
+        if (!opts.parallel &&
+            run_condition((experiment_condition_t)c, &profile, opts.growth_budget,
+                          &opts.bench, opts.reuse_code, &results[c]) != 0) {
             fprintf(stderr, "\n  FAILED!\n");
+            profile_map_free(&profile);
+            profile_db_close(&db);
+            benchmark_template_free();
             return 1;
         }
 
-        printf(" done (mutations=%d, mean=%.4f s, sd=%.4f s, result=%ld)\n",
-               results[c].mutations,
+        printf(" done (runs=%d, mutations=%d",
+               results[c].runs,
+               results[c].mutations);
+        if (benchmark_nmodules > 1) printf(" [%d cross-module]", results[c].cross_mutations);
+        printf(", mean=%.4f s, sd=%.4f s, setup=%.3f s, result=%ld)\n",
                results[c].mean,
                results[c].stddev,
+               results[c].setup_sec,
                (long)results[c].result);
     }
 
@@ -1556,16 +7248,108 @@ int main(void) {
     printf("RESULTS SUMMARY\n");
     printf("================================================================\n\n");
 
-    printf("%-30s  %10s  %10s  %10s\n",
-           "Condition", "Mean (s)", "SD (s)", "Mutations");
-    printf("%-30s  %10s  %10s  %10s\n",
-           "------------------------------", "----------", "----------", "----------");
+    printf("%-30s  %10s  %10s  %10s  %10s  %10s  %21s  %8s\n",
+           "Condition", "Mean (s)", "SD (s)", "Mutations",
+           "Median (s)", "MAD (s)", "95% CI (median)", "Runs");
+    printf("%-30s  %10s  %10s  %10s  %10s  %10s  %21s  %8s\n",
+           "------------------------------", "----------", "----------", "----------",
+           "----------", "----------", "---------------------", "--------");
     for (int c = 0; c < COND_COUNT; c++) {
-        printf("%-30s  %10.4f  %10.4f  %10d\n",
+        char runs[24];
+        snprintf(runs, sizeof(runs), "%d-%d", results[c].runs, results[c].trimmed);
+        printf("%-30s  %10.4f  %10.4f  %10d  %10.4f  %10.4f  [%9.4f, %9.4f]  %8s\n",
                condition_names[c],
                results[c].mean,
                results[c].stddev,
-               results[c].mutations);
+               results[c].mutations,
+               results[c].median,
+               results[c].mad,
+               results[c].ci_lo,
+               results[c].ci_hi,
+               runs);
+    }
+    printf("(Runs = timed-trimmed; median, MAD and CI exclude runs beyond %.1f MADs)\n",
+           OUTLIER_K);
+    if (opts.bench.ci_target > 0.0) {
+        int lo = results[0].runs, hi = results[0].runs;
+        for (int c = 1; c < COND_COUNT; c++) {
+            if (results[c].runs < lo) lo = results[c].runs;
+            if (results[c].runs > hi) hi = results[c].runs;
+        }
+        printf("Runs per condition: %d-%d (budget %d-%d)\n", lo, hi,
+               opts.bench.min_runs, opts.bench.max_runs);
+    }
+    if (opts.bench.cycles) {
+        printf("\nMedian cycles/run (rdtscp):\n");
+        for (int c = 0; c < COND_COUNT; c++)
+            printf("  %-30s  %.4g\n", condition_names[c], results[c].median_cycles);
+    }
+    printf("\nCompile cost (mean per compile; code = machine-code bytes):\n");
+    printf("%-30s  %10s  %10s  %10s  %12s\n",
+           "Condition", "Link (ms)", "Gen (ms)", "Code (B)", "Peak RSS (KB)");
+    for (int c = 0; c < COND_COUNT; c++) {
+        int n = results[c].compiles > 0 ? results[c].compiles : 1;
+        printf("%-30s  %10.3f  %10.3f  %10ld  %12ld\n", condition_names[c],
+               1e3 * results[c].link_sec / n, 1e3 * results[c].gen_sec / n,
+               results[c].code_bytes, results[c].peak_rss_kb);
+    }
+    printf("\nCode bytes per function, by condition number (-1 = unknown):\n");
+    printf("%-12s", "Function");
+    for (int c = 0; c < COND_COUNT; c++) printf("  %7s%d", "C", c + 1);
+    printf("\n");
+    for (int f = 0; f < results[0].ncode; f++) {
+        printf("%-12s", results[0].code_funcs[f].name);
+        for (int c = 0; c < COND_COUNT; c++)
+            printf("  %8ld", f < results[c].ncode ? results[c].code_funcs[f].bytes : -1L);
+        printf("\n");
+    }
+    printf("\nHot code footprint (price >= %.2f and driver; %s order; span -1 =\n"
+           "across code regions):\n", LAYOUT_HOT_PRICE, code_layout ? "hot-first" : "module");
+    printf("%-30s  %6s  %10s  %10s  %10s\n", "Condition", "Funcs", "Bytes", "Span (B)",
+           "4K pages");
+    for (int c = 0; c < COND_COUNT; c++)
+        printf("%-30s  %6d  %10ld  %10ld  %10ld\n", condition_names[c], results[c].hot_funcs,
+               results[c].hot_bytes, results[c].hot_span, results[c].hot_pages);
+    printf("\nGenerator input per function, by condition number: post-link insns before\n"
+           "MIR_gen() / excess live registers (pre-RA peak - %d, not RA spills):\n",
+           PRESSURE_REGS);
+    printf("%-12s", "Function");
+    for (int c = 0; c < COND_COUNT; c++) printf("  %9s%d", "C", c + 1);
+    printf("\n");
+    for (int f = 0; f < results[0].ncode; f++) {
+        printf("%-12s", results[0].code_funcs[f].name);
+        for (int c = 0; c < COND_COUNT; c++) {
+            if (f >= results[c].ncode) {
+                printf("  %10s", "-");
+                continue;
+            }
+            const code_func_t *cf = &results[c].code_funcs[f];
+            if (cf->live < 0)
+                printf("  %6d/%3s", cf->insns, "?");
+            else
+                printf("  %6d/%3d", cf->insns, pressure_excess(cf->live));
+        }
+        printf("\n");
+    }
+
+    if (opts.bench.perf) {
+        printf("\nHardware counters (median per run, user space; n/a = not exposed):\n");
+        printf("%-30s", "Condition");
+        for (int k = 0; k < PERF_COUNT; k++) printf("  %13s", perf_names[k]);
+        printf("  %6s\n", "IPC");
+        for (int c = 0; c < COND_COUNT; c++) {
+            printf("%-30s", condition_names[c]);
+            for (int k = 0; k < PERF_COUNT; k++) {
+                if (results[c].perf_valid & (1u << k))
+                    printf("  %13.4g", results[c].perf_median[k]);
+                else
+                    printf("  %13s", "n/a");
+            }
+            if ((results[c].perf_valid & 3u) == 3u && results[c].perf_median[0] > 0.0)
+                printf("  %6.2f\n", results[c].perf_median[1] / results[c].perf_median[0]);
+            else
+                printf("  %6s\n", "n/a");
+        }
     }
 
     /* Pairwise comparisons (predictions from dossier Section 4.5) */
@@ -1577,6 +7361,8 @@ int main(void) {
     printf("      Shadow=%.4f s, Random=%.4f s, Cohen's d=%.2f\n",
            results[COND_SHADOW_PRICE].mean,
            results[COND_RANDOM_50].mean, d1);
+    print_median_delta("Shadow", &results[COND_SHADOW_PRICE],
+                       "Random", &results[COND_RANDOM_50]);
     printf("      %s\n\n",
            results[COND_SHADOW_PRICE].mean < results[COND_RANDOM_50].mean
            ? "CONFIRMED: Shadow-price outperforms random"
@@ -1588,6 +7374,8 @@ int main(void) {
     printf("      Shadow=%.4f s, None=%.4f s, Cohen's d=%.2f\n",
            results[COND_SHADOW_PRICE].mean,
            results[COND_NO_INLINE].mean, d2);
+    print_median_delta("Shadow", &results[COND_SHADOW_PRICE],
+                       "None", &results[COND_NO_INLINE]);
     printf("      %s\n\n",
            results[COND_SHADOW_PRICE].mean < results[COND_NO_INLINE].mean
            ? "CONFIRMED: Shadow-price outperforms no inlining"
@@ -1599,6 +7387,8 @@ int main(void) {
     printf("      Shadow=%.4f s, Inverted=%.4f s, Cohen's d=%.2f\n",
            results[COND_SHADOW_PRICE].mean,
            results[COND_INVERTED_PRICE].mean, d3);
+    print_median_delta("Shadow", &results[COND_SHADOW_PRICE],
+                       "Inverted", &results[COND_INVERTED_PRICE]);
     printf("      %s\n\n",
            results[COND_SHADOW_PRICE].mean < results[COND_INVERTED_PRICE].mean
            ? "CONFIRMED: Price signal carries information"
@@ -1610,6 +7400,8 @@ int main(void) {
     printf("      Shadow=%.4f s, Blind=%.4f s, Cohen's d=%.2f\n",
            results[COND_SHADOW_PRICE].mean,
            results[COND_BLIND_ALL].mean, d4);
+    print_median_delta("Shadow", &results[COND_SHADOW_PRICE],
+                       "Blind", &results[COND_BLIND_ALL]);
     if (results[COND_SHADOW_PRICE].mean < results[COND_BLIND_ALL].mean) {
         printf("      Shadow-price outperforms blind (discrimination helps)\n\n");
     } else {
@@ -1617,16 +7409,45 @@ int main(void) {
                "(inlining everything is fine here)\n\n");
     }
 
+    /* P5: Knapsack vs Shadow-price (global budget vs per-site greedy) */
+    double d5 = cohen_d(&results[COND_SHADOW_PRICE], &results[COND_KNAPSACK]);
+    printf("  P5: Knapsack (budget=%d insns) vs Shadow-price\n", opts.growth_budget);
+    printf("      Knapsack=%.4f s (%d mutations), Shadow=%.4f s (%d mutations), "
+           "Cohen's d=%.2f\n",
+           results[COND_KNAPSACK].mean, results[COND_KNAPSACK].mutations,
+           results[COND_SHADOW_PRICE].mean, results[COND_SHADOW_PRICE].mutations, d5);
+    print_median_delta("Shadow", &results[COND_SHADOW_PRICE],
+                       "Knapsack", &results[COND_KNAPSACK]);
+    if (results[COND_KNAPSACK].mutations <= results[COND_SHADOW_PRICE].mutations &&
+        fabs(d5) < 0.2) {
+        printf("      Knapsack matches shadow-price within its budget\n\n");
+    } else if (results[COND_KNAPSACK].mean < results[COND_SHADOW_PRICE].mean) {
+        printf("      Knapsack outperforms per-site shadow-price\n\n");
+    } else {
+        printf("      Per-site shadow-price beats knapsack at this budget\n\n");
+    }
+
     /* Raw timing data for external analysis */
     printf("================================================================\n");
     printf("RAW TIMING DATA (for external statistical analysis)\n");
     printf("================================================================\n");
-    printf("condition,run,time_sec\n");
+    printf("condition,run,time_sec%s", opts.bench.cycles ? ",cycles" : "");
+    if (opts.bench.perf)
+        for (int k = 0; k < PERF_COUNT; k++) printf(",%s", perf_names[k]);
+    printf("\n");
     for (int c = 0; c < COND_COUNT; c++) {
-        for (int r = 0; r < NUM_RUNS; r++) {
-            printf("%s,%d,%.6f\n", condition_names[c], r + 1, results[c].times[r]);
+        for (int r = 0; r < results[c].runs; r++) {
+            printf("%s,%d,%.6f", condition_names[c], r + 1, results[c].times[r]);
+            if (opts.bench.cycles) printf(",%llu", (unsigned long long)results[c].cycles[r]);
+            if (opts.bench.perf)
+                for (int k = 0; k < PERF_COUNT; k++)
+                    printf(",%llu", (unsigned long long)results[c].perf[r][k]);
+            printf("\n");
         }
     }
 
+    profile_map_free(&profile);
+    profile_db_close(&db);
+    benchmark_template_free();
     return 0;
 }
@@ -5,7 +5,8 @@
     Executes test_baseline.exe for each of 4 conditions:
     baseline, uniform, skewed, perturbed
     
-    Each run produces a CSV in results/ directory.
+    Each run writes a binary decision log to results/, which is then
+    converted to CSV by src/decisions-to-csv.py.
 .NOTES
     Generated: 2026-02-19
     Requires: test_baseline.exe (from build.ps1)
@@ -52,7 +53,15 @@ foreach ($cond in $Conditions) {
         continue
     }
     
+    $binPath = Join-Path $ResultsDir "${cond}_decisions.bin"
     $csvPath = Join-Path $ResultsDir "${cond}_decisions.csv"
+    python (Join-Path $ProjectRoot 'src' 'decisions-to-csv.py') $binPath $csvPath
+    if ($LASTEXITCODE -ne 0) {
+        Write-Host "  ERROR: Converting $binPath failed" -ForegroundColor Red
+        $failed++
+        continue
+    }
+
     if (Test-Path $csvPath) {
         $lineCount = (Get-Content $csvPath | Measure-Object -Line).Lines
         Write-Host "  OK: $csvPath ($lineCount lines)" -ForegroundColor Green
@@ -13,6 +13,13 @@ New stratified analyses:
   5. Inlining rate by function size bucket
   6. Interaction: size × shadow_price heatmap
 
+Inputs:
+  - results/<condition>_decisions.parquet (preferred, needs pyarrow) or
+    results/<condition>_decisions.csv; see src/decisions-to-csv.py
+  - Only the columns the tests use are read, with compact dtypes
+    (func_name categorical). Each condition is still held in memory
+    whole: the rank, median and merge tests need every row
+
 Outputs:
   - Console: all test results + stratified tables + verdict
   - results/num-analysis.png (3×3 grid)
@@ -39,6 +46,10 @@ COHENS_D_THRESHOLD = 0.5
 MCNEMAR_P_THRESHOLD = 0.05
 ALPHA = 0.05
 
+# Columns the analyses use, with compact dtypes; opt_level is optional
+COLUMNS = {'func_name': 'category', 'shadow_price': 'float64', 'ir_count': 'int32',
+           'opt_level': 'int8', 'inlined': 'int8', 'threshold_baseline': 'int32'}
+
 SIZE_LABELS = {10: 'Tiny (10)', 50: 'Small (50)', 100: 'Medium (100)',
                200: 'Large (200)', 500: 'Huge (500)'}
 OPT_LABELS = {0: 'O0 (thresh=20)', 1: 'O1 (thresh=50)', 2: 'O2 (thresh=100)'}
@@ -89,13 +100,38 @@ def spearman_with_ci(x, y, confidence=0.95):
 
 # ---- Load Data ----
 
+def read_parquet_columns(path):
+    """Read the COLUMNS present in a Parquet file."""
+    import pyarrow.parquet as pq
+    pf = pq.ParquetFile(path)
+    cols = [c for c in COLUMNS if c in pf.schema_arrow.names]
+    return pf.read(columns=cols).to_pandas()  # Dictionary columns arrive as categoricals
+
+
+def read_csv_columns(path):
+    """Read the COLUMNS present in a CSV."""
+    header = pd.read_csv(path, nrows=0).columns
+    cols = [c for c in COLUMNS if c in header]
+    return pd.read_csv(path, usecols=cols, dtype={c: COLUMNS[c] for c in cols})
+
+
 def load_data():
     data = {}
-    print("Loading CSV data from", RESULTS_DIR)
+    print("Loading decision data from", RESULTS_DIR)
+    try:
+        import pyarrow.parquet  # noqa: F401
+        have_parquet = True
+    except ImportError:
+        have_parquet = False
     for cond in CONDITIONS:
-        path = os.path.join(RESULTS_DIR, f'{cond}_decisions.csv')
+        path = os.path.join(RESULTS_DIR, f'{cond}_decisions.parquet')
+        if not (have_parquet and os.path.exists(path)):
+            path = os.path.join(RESULTS_DIR, f'{cond}_decisions.csv')
         try:
-            df = pd.read_csv(path)
+            if path.endswith('.parquet'):
+                df = read_parquet_columns(path)
+            else:
+                df = read_csv_columns(path)
             data[cond] = df
             n_opts = df['opt_level'].nunique() if 'opt_level' in df.columns else 1
             print(f"  Loaded {path}: {len(df)} rows, {n_opts} opt level(s)")
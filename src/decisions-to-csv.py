@@ -0,0 +1,198 @@
+#!/usr/bin/env python3
+"""
+decisions-to-csv.py
+MIR NUM Experiment: Binary Decision Log -> CSV / Parquet
+
+Converts the buffered binary decision logs written by test-num-experiment.c
+(results/<condition>_decisions.bin) and by the patched mir-gen.c into the
+layout analyze-num.py reads:
+
+  func_name,shadow_price,ir_count,opt_level,inlined,threshold_baseline,threshold_adjusted
+
+opt_level is omitted when no record carries one (the mir-gen.c log).
+
+With --parquet the output is <condition>_decisions.parquet instead:
+typed columns (f64 price, i32 counts and thresholds, i8 opt_level and
+inlined) and func_name dictionary-encoded, so each name is stored once.
+analyze-num.py prefers it over the CSV and reads only the columns it uses.
+Needs pyarrow. Either output is streamed CHUNK_RECORDS at a time, so
+memory stays flat however long the log is.
+
+Log format (native endian):
+  header   "NUMDLOG1", u32 version, u32 record size
+  records  u32 func_id, i32 ir_count, i32 threshold_baseline,
+           i32 threshold_adjusted, f64 shadow_price, u8 opt_level (255 = none),
+           u8 inlined, 6 pad bytes
+  <log>.names  "<func_id>\\t<func_name>" lines; func_id = FNV-1a 32 of the name.
+               A func_id listed with two names is a hash collision: it is
+               reported, and its records keep the first name.
+
+Usage:
+  python src/decisions-to-csv.py [--parquet]               # every results/*_decisions.bin
+  python src/decisions-to-csv.py [--parquet] LOG [OUT]     # one log
+"""
+
+import glob
+import os
+import struct
+import sys
+
+RESULTS_DIR = os.path.join('.', 'results')
+MAGIC = b'NUMDLOG1'
+VERSION = 1
+OPT_NONE = 255
+CHUNK_RECORDS = 1 << 20  # Records per read, and per Parquet row group
+
+HEADER = struct.Struct('=8sII')
+RECORD = struct.Struct('=IiiidBB6x')  # 32 bytes, matches decision_record_t
+
+
+def read_names(path):
+    names = {}
+    collisions = {}  # func_id -> every name logged under it
+    try:
+        with open(path, encoding='utf-8') as f:
+            for line in f:
+                fid, _, name = line.rstrip('\n').partition('\t')
+                fid = int(fid)
+                if fid not in names:
+                    names[fid] = name
+                elif names[fid] != name:
+                    collisions.setdefault(fid, [names[fid]]).append(name)
+    except FileNotFoundError:
+        print(f"  WARNING: {path} not found, names will be func ids")
+    for fid, clash in collisions.items():
+        print(f"  WARNING: func_id {fid} is shared by {', '.join(clash)}; "
+              f"its records are attributed to {clash[0]}")
+    return names
+
+
+def iter_log(path):
+    """Yields lists of (func_id, ir_count, thr_base, thr_adj, price, opt, inlined)."""
+    with open(path, 'rb') as f:
+        header = f.read(HEADER.size)
+        if len(header) < HEADER.size:
+            raise ValueError(f"{path}: not a NUM decision log")
+        magic, version, size = HEADER.unpack(header)
+        if magic != MAGIC:
+            raise ValueError(f"{path}: not a NUM decision log")
+        if version != VERSION or size != RECORD.size:
+            raise ValueError(f"{path}: version {version}, record size {size} "
+                             f"(expected {VERSION}, {RECORD.size})")
+        while True:
+            buf = f.read(RECORD.size * CHUNK_RECORDS)
+            if not buf:
+                return
+            whole = len(buf) - len(buf) % RECORD.size
+            if whole != len(buf):
+                print(f"  WARNING: {path}: trailing partial record dropped")
+            yield list(RECORD.iter_unpack(buf[:whole]))
+
+
+def convert_csv(log_path, csv_path):
+    names = read_names(log_path + '.names')
+    rows = 0
+    with_opt = None
+    with open(csv_path, 'w', encoding='utf-8', newline='') as out:
+        for chunk in iter_log(log_path):
+            if with_opt is None:
+                # One writer per log, so the first chunk decides the layout
+                with_opt = any(r[5] != OPT_NONE for r in chunk)
+                out.write("func_name,shadow_price,ir_count,"
+                          + ("opt_level," if with_opt else "")
+                          + "inlined,threshold_baseline,threshold_adjusted\n")
+            for fid, ir_count, thr_base, thr_adj, price, opt, inlined in chunk:
+                row = [names.get(fid, str(fid)), f"{price:.2f}", str(ir_count)]
+                if with_opt:
+                    row.append(str(opt))
+                row += [str(inlined), str(thr_base), str(thr_adj)]
+                out.write(','.join(row) + '\n')
+            rows += len(chunk)
+        if with_opt is None:
+            out.write("func_name,shadow_price,ir_count,opt_level,"
+                      "inlined,threshold_baseline,threshold_adjusted\n")
+    print(f"  {log_path} -> {csv_path} ({rows} rows)")
+
+
+def convert_parquet(log_path, pq_path):
+    import pyarrow as pa
+    import pyarrow.parquet as pq
+
+    names = read_names(log_path + '.names')
+    index = {}       # func_id -> dictionary index
+    dictionary = []  # func_name per index
+    writer = None
+    rows = 0
+    with_opt = None
+    try:
+        for chunk in iter_log(log_path):
+            fid, ir_count, thr_base, thr_adj, price, opt, inlined = zip(*chunk)
+            if with_opt is None:
+                with_opt = any(o != OPT_NONE for o in opt)
+            codes = []
+            for f in fid:
+                i = index.get(f)
+                if i is None:
+                    i = index[f] = len(dictionary)
+                    dictionary.append(names.get(f, str(f)))
+                codes.append(i)
+            cols = {
+                'func_name': pa.DictionaryArray.from_arrays(
+                    pa.array(codes, pa.int32()), pa.array(dictionary, pa.string())),
+                'shadow_price': pa.array(price, pa.float64()),
+                'ir_count': pa.array(ir_count, pa.int32()),
+            }
+            if with_opt:
+                cols['opt_level'] = pa.array(opt, pa.int8())
+            cols['inlined'] = pa.array(inlined, pa.int8())
+            cols['threshold_baseline'] = pa.array(thr_base, pa.int32())
+            cols['threshold_adjusted'] = pa.array(thr_adj, pa.int32())
+            table = pa.table(cols)
+            if writer is None:
+                writer = pq.ParquetWriter(pq_path, table.schema)
+            writer.write_table(table, row_group_size=CHUNK_RECORDS)
+            rows += len(chunk)
+    finally:
+        if writer is not None:
+            writer.close()
+    if writer is None:
+        raise ValueError(f"{log_path}: no records")
+    print(f"  {log_path} -> {pq_path} ({rows} rows, {len(dictionary)} names)")
+
+
+def main(argv):
+    args = argv[1:]
+    parquet = '--parquet' in args
+    args = [a for a in args if a != '--parquet']
+    ext = '.parquet' if parquet else '.csv'
+    if len(args) > 2 or any(a.startswith('--') for a in args):
+        print(__doc__)
+        return 1
+    if args:
+        log = args[0]
+        out = args[1] if len(args) == 2 else os.path.splitext(log)[0] + ext
+        jobs = [(log, out)]
+    else:
+        logs = sorted(glob.glob(os.path.join(RESULTS_DIR, '*_decisions.bin')))
+        if not logs:
+            print(f"  ERROR: no *_decisions.bin in {RESULTS_DIR}")
+            return 1
+        jobs = [(log, os.path.splitext(log)[0] + ext) for log in logs]
+
+    for log, out in jobs:
+        try:
+            if parquet:
+                convert_parquet(log, out)
+            else:
+                convert_csv(log, out)
+        except ImportError:
+            print("  ERROR: --parquet needs pyarrow (pip install pyarrow)")
+            return 1
+        except (OSError, ValueError) as e:
+            print(f"  ERROR: {e}")
+            return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
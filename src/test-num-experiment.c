@@ -3,7 +3,8 @@
  * MIR NUM Experiment: Test Harness (v2 — with opt-level stratification)
  *
  * Generates synthetic MIR IR functions with varying sizes and shadow prices,
- * then invokes the NUM-modified inlining decision logic and logs results to CSV.
+ * then invokes the NUM-modified inlining decision logic and logs the results
+ * (binary decision log, converted to CSV for analysis).
  *
  * v2 changes:
  *   - Runs each condition at 3 optimization levels (0, 1, 2)
@@ -13,17 +14,22 @@
  *       Level 2: threshold=100 (aggressive, inline larger functions)
  *   - CSV now includes opt_level column for stratified analysis
  *   - Total: 50 funcs x 5 sizes x 3 opt levels = 750 rows per condition
+ *   - MIR allocates from a bump arena (MIR_init2), reset after each level
+ *   - Decisions are evaluated per level in one batch (SIMD or table lookup)
  *
  * Usage: ./test_baseline <condition>
  *   condition: baseline | uniform | skewed | perturbed
  *
- * Output: results/<condition>_decisions.csv
+ * Output: results/<condition>_decisions.bin (+ .names); convert with
+ *         src/decisions-to-csv.py for analyze-num.py
  *
  * Generated: 2026-02-19, updated with stratification
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 #include <math.h>
 #include <time.h>
@@ -55,58 +61,402 @@ static const int sizes[NUM_SIZES] = {10, 50, 100, 200, 500};
  */
 static const int baseline_thresholds[NUM_OPT_LEVELS] = {20, 50, 100};
 
-/* ---- CSV Logging (extended with opt_level) ---- */
+/* ---- Bump Arena (MIR allocator hooks) ---- */
 
-static FILE *experiment_log_v2 = NULL;
+/*
+ * Every MIR allocation for one opt level comes out of this arena via
+ * MIR_init2(). Allocation is a pointer bump; free is a no-op, and the
+ * whole level is released at once by arena_reset() after MIR_finish().
+ * Each block carries its size in a header, so realloc does not depend on
+ * the caller's old_size and grows the newest block in place.
+ */
+#define ARENA_CHUNK (1u << 20)  /* Chunk payload, bytes; larger blocks get their own */
+
+typedef struct arena_chunk {
+    struct arena_chunk *next;
+    size_t size, used;
+    max_align_t data[];
+} arena_chunk_t;
+
+typedef struct {
+    arena_chunk_t *chunks;  /* Newest first; the last one survives resets */
+    size_t in_use;          /* Bytes handed out since the last reset */
+    size_t peak;            /* High-water mark of in_use */
+} arena_t;
+
+#define ARENA_ALIGN  sizeof(max_align_t)
+#define ARENA_HDR    ARENA_ALIGN  /* Block size is stored just before the block */
+#define ARENA_ROUND(n) (((n) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+static void *arena_malloc(size_t size, void *user_data) {
+    arena_t *a = user_data;
+    size_t need = ARENA_HDR + ARENA_ROUND(size);
+    arena_chunk_t *c = a->chunks;
+    if (c == NULL || c->size - c->used < need) {
+        size_t cap = need > ARENA_CHUNK ? need : ARENA_CHUNK;
+        c = malloc(sizeof(arena_chunk_t) + cap);
+        if (c == NULL) return NULL;
+        c->size = cap;
+        c->used = 0;
+        c->next = a->chunks;
+        a->chunks = c;
+    }
+    char *block = (char *)c->data + c->used + ARENA_HDR;
+    *(size_t *)(block - ARENA_HDR) = size;
+    c->used += need;
+    a->in_use += need;
+    if (a->in_use > a->peak) a->peak = a->in_use;
+    return block;
+}
+
+static void *arena_calloc(size_t num, size_t size, void *user_data) {
+    void *p = arena_malloc(num * size, user_data);
+    if (p != NULL) memset(p, 0, num * size);
+    return p;
+}
+
+static void *arena_realloc(void *ptr, size_t old_size, size_t new_size, void *user_data) {
+    (void)old_size;
+    arena_t *a = user_data;
+    if (ptr == NULL) return arena_malloc(new_size, user_data);
+    size_t *hdr = (size_t *)((char *)ptr - ARENA_HDR);
+    size_t old = ARENA_ROUND(*hdr), need = ARENA_ROUND(new_size);
+    arena_chunk_t *c = a->chunks;
+
+    /* Newest block of the current chunk: grow or shrink in place */
+    if ((char *)ptr + old == (char *)c->data + c->used && c->used - old + need <= c->size) {
+        c->used = c->used - old + need;
+        a->in_use = a->in_use - old + need;
+        if (a->in_use > a->peak) a->peak = a->in_use;
+        *hdr = new_size;
+        return ptr;
+    }
+    void *p = arena_malloc(new_size, user_data);
+    if (p != NULL) memcpy(p, ptr, *hdr < new_size ? *hdr : new_size);
+    return p;
+}
+
+static void arena_free(void *ptr, void *user_data) {
+    (void)ptr;
+    (void)user_data;
+}
+
+/* Release everything allocated since the last reset; keep one chunk. */
+static void arena_reset(arena_t *a) {
+    while (a->chunks != NULL && a->chunks->next != NULL) {
+        arena_chunk_t *next = a->chunks->next;
+        free(a->chunks);
+        a->chunks = next;
+    }
+    if (a->chunks != NULL) a->chunks->used = 0;
+    a->in_use = 0;
+}
+
+static void arena_destroy(arena_t *a) {
+    arena_reset(a);
+    free(a->chunks);
+    a->chunks = NULL;
+}
+
+/* ---- Binary Decision Logging (extended with opt_level) ---- */
+
+/*
+ * A decision is one fixed-size record appended to an in-memory buffer.
+ * The buffer goes to disk in a single fwrite() every DLOG_BATCH records
+ * and at close, so logging no longer costs a syscall per decision.
+ *
+ *   <file>        "NUMDLOG1", u32 version, u32 record size, then records
+ *   <file>.names  "<func_id>\t<func_name>" once per distinct name
+ *
+ * func_id is the 32-bit FNV-1a hash of the name. The seen set also keeps
+ * a check hash (FNV-1a from another basis), so a different name with the
+ * same func_id still gets its own .names line. Same layout as the log of
+ * patches/02-mir-gen-c-logging.patch; src/decisions-to-csv.py turns
+ * either one back into the CSV that analyze-num.py reads, and reports
+ * func_id collisions.
+ */
+#define DLOG_MAGIC      "NUMDLOG1"
+#define DLOG_VERSION    1
+#define DLOG_BATCH      4096       /* Records per fwrite() */
+#define DLOG_NAME_SLOTS (1 << 16)  /* Seen-name set; past 3/4 full, names repeat */
+
+typedef struct {
+    uint32_t func_id;
+    int32_t  ir_count;
+    int32_t  threshold_baseline;
+    int32_t  threshold_adjusted;
+    double   shadow_price;
+    uint8_t  opt_level;            /* 255 = not recorded */
+    uint8_t  inlined;
+    uint8_t  pad[6];
+} decision_record_t;               /* 32 bytes, native endian */
+
+typedef struct {
+    FILE *out, *names;
+    decision_record_t buf[DLOG_BATCH];
+    int n;
+    uint32_t seen[DLOG_NAME_SLOTS][2];  /* func_id (0 = empty), check hash */
+    int nseen;
+} decision_log_t;
+
+static decision_log_t *experiment_log_v2 = NULL;
+
+static uint32_t dlog_hash(const char *name, uint32_t basis) {
+    uint32_t h = basis;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static uint32_t dlog_func_id(const char *name) {
+    return dlog_hash(name, 2166136261u);
+}
+
+static void dlog_flush(decision_log_t *log) {
+    if (log->n > 0) fwrite(log->buf, sizeof(log->buf[0]), (size_t)log->n, log->out);
+    log->n = 0;
+}
+
+/* Write `name` to the sidecar unless its (func_id, check) pair has been. */
+static void dlog_note_name(decision_log_t *log, uint32_t id, const char *name) {
+    uint32_t check = dlog_hash(name, 0x01000193u);
+    if (id != 0 && log->nseen < DLOG_NAME_SLOTS / 4 * 3) {
+        uint32_t i = id & (DLOG_NAME_SLOTS - 1);
+        while (log->seen[i][0] != 0) {
+            if (log->seen[i][0] == id && log->seen[i][1] == check) return;
+            i = (i + 1) & (DLOG_NAME_SLOTS - 1);
+        }
+        log->seen[i][0] = id;
+        log->seen[i][1] = check;
+        log->nseen++;
+    }
+    fprintf(log->names, "%u\t%s\n", (unsigned)id, name);
+}
 
 static void init_logging_v2(const char *filename) {
-    experiment_log_v2 = fopen(filename, "w");
-    if (experiment_log_v2) {
-        fprintf(experiment_log_v2,
-            "func_name,shadow_price,ir_count,opt_level,"
-            "inlined,threshold_baseline,threshold_adjusted\n");
+    char names_path[600];
+    snprintf(names_path, sizeof(names_path), "%s.names", filename);
+    decision_log_t *log = calloc(1, sizeof(*log));
+    if (log == NULL) return;
+    log->out = fopen(filename, "wb");
+    log->names = fopen(names_path, "w");
+    if (log->out == NULL || log->names == NULL) {
+        if (log->out) fclose(log->out);
+        if (log->names) fclose(log->names);
+        free(log);
+        return;
     }
+    uint32_t header[2] = {DLOG_VERSION, sizeof(decision_record_t)};
+    fwrite(DLOG_MAGIC, 1, 8, log->out);
+    fwrite(header, sizeof(header), 1, log->out);
+    experiment_log_v2 = log;
 }
 
 static void close_logging_v2(void) {
     if (experiment_log_v2) {
-        fclose(experiment_log_v2);
+        dlog_flush(experiment_log_v2);
+        fclose(experiment_log_v2->out);
+        fclose(experiment_log_v2->names);
+        free(experiment_log_v2);
         experiment_log_v2 = NULL;
     }
 }
 
+/* Append one decision to the log, if logging is on. */
+static void dlog_append(const char *func_name, int ir_count, int base_thresh,
+                        int adjusted_threshold, double shadow_price,
+                        int opt_level, int inlined) {
+    decision_log_t *log = experiment_log_v2;
+    if (log == NULL) return;
+    decision_record_t *r = &log->buf[log->n];
+    memset(r, 0, sizeof(*r));
+    r->func_id = dlog_func_id(func_name);
+    r->ir_count = ir_count;
+    r->threshold_baseline = base_thresh;
+    r->threshold_adjusted = adjusted_threshold;
+    r->shadow_price = shadow_price;
+    r->opt_level = (uint8_t)opt_level;
+    r->inlined = (uint8_t)inlined;
+    dlog_note_name(log, r->func_id, func_name);
+    if (++log->n == DLOG_BATCH) dlog_flush(log);
+}
+
+/* ---- Batch Threshold Evaluation ---- */
+
 /*
- * should_inline_with_num_v2:
- *   NUM-aware inlining decision with per-opt-level baseline threshold.
+ * NUM-aware inlining decisions with per-opt-level baseline threshold,
+ * evaluated over arrays (SoA: ir_count[], shadow_price[], opt_level[])
+ * instead of one call per function.
  *
  *   Formula: adjusted_threshold = baseline_threshold[opt_level] * (shadow_price / 100.0)
  *   Decision: inline if ir_count < adjusted_threshold
  *
  *   Lambda scaling clamped to [0.1, 5.0] to prevent degenerate decisions.
  *   Adjusted threshold clamped to [5, 1000].
+ *
+ * Every path computes exactly what the scalar formula does (same divide,
+ * same truncation), so the decision log does not depend on which one ran:
+ *   num_decide_batch      - AVX2 (4 lanes) or NEON (2 lanes), scalar tail;
+ *                           AVX2 is picked at run time, so -O2 builds use it
+ *   num_decide_batch_lut  - shadow prices quantized to whole units, read
+ *                           from a [opt_level][price] table; exact when
+ *                           every price is integral (all conditions here)
  */
-static int should_inline_with_num_v2(const char *func_name, int ir_count,
-                                      double shadow_price, int opt_level) {
-    int base_thresh = baseline_thresholds[opt_level];
+#define LAMBDA_SCALE_MIN  0.1
+#define LAMBDA_SCALE_MAX  5.0
+#define ADJ_THRESH_MIN    5
+#define ADJ_THRESH_MAX    1000
+#define NUM_LUT_PRICES    501   /* Prices 0..500; 500 = LAMBDA_SCALE_MAX * 100 */
+
+static double baseline_thresholds_f[NUM_OPT_LEVELS];  /* baseline_thresholds, as doubles */
+static int16_t num_threshold_lut[NUM_OPT_LEVELS][NUM_LUT_PRICES];
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define NUM_BATCH_AVX2 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define NUM_BATCH_NEON 1
+#include <arm_neon.h>
+#endif
+
+static const char *num_batch_path = "scalar";
+
+static void num_decide_batch_scalar(const int32_t *ir_count, const double *shadow_price,
+                                    const uint8_t *opt_level, size_t n,
+                                    int32_t *thr_adj, uint8_t *inlined) {
+    for (size_t i = 0; i < n; i++) {
+        double s = shadow_price[i] / 100.0;
+        s = s < LAMBDA_SCALE_MIN ? LAMBDA_SCALE_MIN : s;
+        s = s > LAMBDA_SCALE_MAX ? LAMBDA_SCALE_MAX : s;
+        int32_t t = (int32_t)(baseline_thresholds_f[opt_level[i]] * s);
+        t = t < ADJ_THRESH_MIN ? ADJ_THRESH_MIN : t;
+        t = t > ADJ_THRESH_MAX ? ADJ_THRESH_MAX : t;
+        thr_adj[i] = t;
+        inlined[i] = (uint8_t)(ir_count[i] < t);
+    }
+}
 
-    double lambda_scale = shadow_price / 100.0;
-    if (lambda_scale < 0.1) lambda_scale = 0.1;
-    if (lambda_scale > 5.0) lambda_scale = 5.0;
+#ifdef NUM_BATCH_AVX2
+__attribute__((target("avx2")))
+static size_t num_decide_batch_avx2(const int32_t *ir_count, const double *shadow_price,
+                                    const uint8_t *opt_level, size_t n,
+                                    int32_t *thr_adj, uint8_t *inlined) {
+    const __m256d hundred = _mm256_set1_pd(100.0);
+    const __m256d smin = _mm256_set1_pd(LAMBDA_SCALE_MIN);
+    const __m256d smax = _mm256_set1_pd(LAMBDA_SCALE_MAX);
+    const __m128i tmin = _mm_set1_epi32(ADJ_THRESH_MIN);
+    const __m128i tmax = _mm_set1_epi32(ADJ_THRESH_MAX);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32_t levels;
+        memcpy(&levels, opt_level + i, 4);
+        __m128i idx = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(levels));
+        __m256d base = _mm256_i32gather_pd(baseline_thresholds_f, idx, 8);
+
+        __m256d s = _mm256_div_pd(_mm256_loadu_pd(shadow_price + i), hundred);
+        s = _mm256_min_pd(_mm256_max_pd(s, smin), smax);
+        __m128i t = _mm256_cvttpd_epi32(_mm256_mul_pd(base, s));
+        t = _mm_min_epi32(_mm_max_epi32(t, tmin), tmax);
+        _mm_storeu_si128((__m128i *)(thr_adj + i), t);
+
+        __m128i ir = _mm_loadu_si128((const __m128i *)(ir_count + i));
+        __m128i yes = _mm_srli_epi32(_mm_cmpgt_epi32(t, ir), 31);
+        int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(yes, yes), yes));
+        memcpy(inlined + i, &bytes, 4);
+    }
+    return i;
+}
+#endif
+
+#ifdef NUM_BATCH_NEON
+static size_t num_decide_batch_neon(const int32_t *ir_count, const double *shadow_price,
+                                    const uint8_t *opt_level, size_t n,
+                                    int32_t *thr_adj, uint8_t *inlined) {
+    const float64x2_t hundred = vdupq_n_f64(100.0);
+    const float64x2_t smin = vdupq_n_f64(LAMBDA_SCALE_MIN);
+    const float64x2_t smax = vdupq_n_f64(LAMBDA_SCALE_MAX);
+    const int32x2_t tmin = vdup_n_s32(ADJ_THRESH_MIN);
+    const int32x2_t tmax = vdup_n_s32(ADJ_THRESH_MAX);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        float64x2_t base = vcombine_f64(vld1_f64(&baseline_thresholds_f[opt_level[i]]),
+                                        vld1_f64(&baseline_thresholds_f[opt_level[i + 1]]));
+        float64x2_t s = vdivq_f64(vld1q_f64(shadow_price + i), hundred);
+        s = vminq_f64(vmaxq_f64(s, smin), smax);
+        int32x2_t t = vmovn_s64(vcvtq_s64_f64(vmulq_f64(base, s)));
+        t = vmin_s32(vmax_s32(t, tmin), tmax);
+        vst1_s32(thr_adj + i, t);
+        uint32x2_t yes = vshr_n_u32(vclt_s32(vld1_s32(ir_count + i), t), 31);
+        inlined[i] = (uint8_t)vget_lane_u32(yes, 0);
+        inlined[i + 1] = (uint8_t)vget_lane_u32(yes, 1);
+    }
+    return i;
+}
+#endif
 
-    int adjusted_threshold = (int)(base_thresh * lambda_scale);
-    if (adjusted_threshold < 5) adjusted_threshold = 5;
-    if (adjusted_threshold > 1000) adjusted_threshold = 1000;
+/*
+ * num_batch_init: choose the vector path and fill the quantized-price
+ * table. Entries come from the scalar formula, so a lookup equals the
+ * computed threshold for any integral price (prices above 500 clamp to
+ * the 500 entry, exactly as the scale does).
+ */
+static void num_batch_init(void) {
+#ifdef NUM_BATCH_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) num_batch_path = "avx2";
+#endif
+#ifdef NUM_BATCH_NEON
+    num_batch_path = "neon";
+#endif
+    for (int opt = 0; opt < NUM_OPT_LEVELS; opt++)
+        baseline_thresholds_f[opt] = baseline_thresholds[opt];
+    for (int opt = 0; opt < NUM_OPT_LEVELS; opt++) {
+        for (int q = 0; q < NUM_LUT_PRICES; q++) {
+            double price = q;
+            uint8_t level = (uint8_t)opt;
+            int32_t ir = 0, t;
+            uint8_t unused;
+            num_decide_batch_scalar(&ir, &price, &level, 1, &t, &unused);
+            num_threshold_lut[opt][q] = (int16_t)t;
+        }
+    }
+}
 
-    int inlined = (ir_count < adjusted_threshold) ? 1 : 0;
+static void num_decide_batch(const int32_t *ir_count, const double *shadow_price,
+                             const uint8_t *opt_level, size_t n,
+                             int32_t *thr_adj, uint8_t *inlined) {
+    size_t done = 0;
+#ifdef NUM_BATCH_AVX2
+    if (num_batch_path[0] == 'a')
+        done = num_decide_batch_avx2(ir_count, shadow_price, opt_level, n, thr_adj, inlined);
+#endif
+#ifdef NUM_BATCH_NEON
+    done = num_decide_batch_neon(ir_count, shadow_price, opt_level, n, thr_adj, inlined);
+#endif
+    num_decide_batch_scalar(ir_count + done, shadow_price + done, opt_level + done,
+                            n - done, thr_adj + done, inlined + done);
+}
 
-    if (experiment_log_v2) {
-        fprintf(experiment_log_v2, "%s,%.2f,%d,%d,%d,%d,%d\n",
-                func_name, shadow_price, ir_count, opt_level,
-                inlined, base_thresh, adjusted_threshold);
-        fflush(experiment_log_v2);
+/* Quantize prices to table indices; returns 0 if any price is fractional or negative. */
+static int num_quantize_prices(const double *shadow_price, size_t n, uint16_t *q) {
+    for (size_t i = 0; i < n; i++) {
+        double p = shadow_price[i];
+        if (!(p >= 0.0) || p != floor(p)) return 0;
+        q[i] = (uint16_t)(p < NUM_LUT_PRICES - 1 ? p : NUM_LUT_PRICES - 1);
     }
+    return 1;
+}
 
-    return inlined;
+static void num_decide_batch_lut(const int32_t *ir_count, const uint16_t *price_q,
+                                 const uint8_t *opt_level, size_t n,
+                                 int32_t *thr_adj, uint8_t *inlined) {
+    for (size_t i = 0; i < n; i++) {
+        int32_t t = num_threshold_lut[opt_level[i]][price_q[i]];
+        thr_adj[i] = t;
+        inlined[i] = (uint8_t)(ir_count[i] < t);
+    }
 }
 
 /* ---- Shadow Price Assignment per Condition ---- */
@@ -173,13 +523,18 @@ static MIR_item_t create_synthetic_func(MIR_context_t ctx, MIR_module_t mod,
  *     For each of NUM_FUNCS functions at each of NUM_SIZES sizes:
  *       1. Generate synthetic MIR function
  *       2. Assign shadow_price based on condition
- *       3. Call should_inline_with_num_v2() which logs the decision
+ *       3. Record (ir_count, shadow_price, opt_level) for the batch
+ *     Decide the whole level with one batch call, then log each decision
  *
  *   Total rows per condition: NUM_FUNCS x NUM_SIZES x NUM_OPT_LEVELS = 750
+ *
+ *   Each opt level gets its own MIR context allocating from one bump
+ *   arena, which is reset once the context is finished, so peak memory
+ *   is that of a single level however many levels or functions run.
  */
 static int run_experiment(const char *condition) {
     char logfile[512];
-    snprintf(logfile, sizeof(logfile), "results/%s_decisions.csv", condition);
+    snprintf(logfile, sizeof(logfile), "results/%s_decisions.bin", condition);
 
     init_logging_v2(logfile);
 
@@ -189,41 +544,75 @@ static int run_experiment(const char *condition) {
     printf("  Functions:  %d funcs x %d sizes x %d opt levels = %d total\n",
            NUM_FUNCS, NUM_SIZES, NUM_OPT_LEVELS, total_per_condition);
 
-    MIR_context_t ctx = MIR_init();
-    if (!ctx) {
-        fprintf(stderr, "ERROR: MIR_init() failed\n");
-        return 1;
-    }
+    arena_t arena = {NULL, 0, 0};
+    struct MIR_alloc alloc = {arena_malloc, arena_calloc, arena_realloc,
+                              arena_free, &arena};
 
-    MIR_module_t mod = MIR_new_module(ctx, "num_experiment");
+    enum { PER_LEVEL = NUM_FUNCS * NUM_SIZES };
+    static char names[PER_LEVEL][128];
+    int32_t ir[PER_LEVEL], thr[PER_LEVEL];
+    double price[PER_LEVEL];
+    uint8_t level[PER_LEVEL], inl[PER_LEVEL];
+    uint16_t price_q[PER_LEVEL];
+    const char *batch_path[NUM_OPT_LEVELS];
 
     int counts[NUM_OPT_LEVELS][2]; /* [level][0=not_inlined, 1=inlined] */
+    size_t arena_peak[NUM_OPT_LEVELS];
+    double gen_sec[NUM_OPT_LEVELS];
     memset(counts, 0, sizeof(counts));
 
     for (int opt = 0; opt < NUM_OPT_LEVELS; opt++) {
+        clock_t start = clock();
+        arena.peak = 0;
+        MIR_context_t ctx = MIR_init2(&alloc, NULL);
+        if (!ctx) {
+            fprintf(stderr, "ERROR: MIR_init2() failed\n");
+            arena_destroy(&arena);
+            close_logging_v2();
+            return 1;
+        }
+
+        MIR_module_t mod = MIR_new_module(ctx, "num_experiment");
+
+        int n = 0;
         for (int fi = 0; fi < NUM_FUNCS; fi++) {
-            for (int si = 0; si < NUM_SIZES; si++) {
+            for (int si = 0; si < NUM_SIZES; si++, n++) {
                 int ir_count = sizes[si];
                 double shadow_price = get_shadow_price(condition, fi, si);
 
-                char func_name[128];
-                snprintf(func_name, sizeof(func_name),
+                snprintf(names[n], sizeof(names[n]),
                          "func_%d_size_%d_opt_%d", fi, ir_count, opt);
 
                 MIR_item_t func_item = create_synthetic_func(
-                    ctx, mod, func_name, ir_count);
+                    ctx, mod, names[n], ir_count);
                 func_item->u.func->shadow_price = shadow_price;
 
-                int inlined = should_inline_with_num_v2(
-                    func_name, ir_count, shadow_price, opt);
-
-                counts[opt][inlined ? 1 : 0]++;
+                ir[n] = ir_count;
+                price[n] = shadow_price;
+                level[n] = (uint8_t)opt;
             }
         }
-    }
 
-    MIR_finish_module(ctx);
-    MIR_finish(ctx);
+        if (num_quantize_prices(price, PER_LEVEL, price_q)) {
+            num_decide_batch_lut(ir, price_q, level, PER_LEVEL, thr, inl);
+            batch_path[opt] = "lut";
+        } else {
+            num_decide_batch(ir, price, level, PER_LEVEL, thr, inl);
+            batch_path[opt] = num_batch_path;
+        }
+        for (int i = 0; i < PER_LEVEL; i++) {
+            dlog_append(names[i], ir[i], baseline_thresholds[opt], thr[i],
+                        price[i], opt, inl[i]);
+            counts[opt][inl[i]]++;
+        }
+
+        MIR_finish_module(ctx);
+        MIR_finish(ctx);
+        arena_peak[opt] = arena.peak;
+        arena_reset(&arena);
+        gen_sec[opt] = (double)(clock() - start) / CLOCKS_PER_SEC;
+    }
+    arena_destroy(&arena);
     close_logging_v2();
 
     /* Per-level summary */
@@ -233,9 +622,11 @@ static int run_experiment(const char *condition) {
         int no  = counts[opt][0];
         total_inlined += yes;
         total_not += no;
-        printf("    Opt %d (thresh=%3d): %3d inlined, %3d not (%.1f%%)\n",
+        printf("    Opt %d (thresh=%3d): %3d inlined, %3d not (%.1f%%)"
+               "  [arena peak %.1f MiB, %.3f s, %s]\n",
                opt, baseline_thresholds[opt], yes, no,
-               100.0 * yes / (yes + no));
+               100.0 * yes / (yes + no),
+               arena_peak[opt] / (1024.0 * 1024.0), gen_sec[opt], batch_path[opt]);
     }
     printf("  Total:      %d inlined, %d not inlined (%.1f%% rate)\n",
            total_inlined, total_not,
@@ -272,6 +663,7 @@ int main(int argc, char *argv[]) {
 
     /* Fixed seed for reproducible perturbed noise */
     srand(42);
+    num_batch_init();
 
     int rc = run_experiment(condition);
 